@@ -8,6 +8,9 @@ QMAKE_INFO_PLIST = res/Info.plist
 
 win32:RC_FILE = res/AmoebotSim.rc
 
+# shm_open lives in librt on older glibc versions.
+linux:LIBS += -lrt
+
 HEADERS += \
     alg/demo/ballroomdemo.h \
     alg/demo/discodemo.h \
@@ -21,18 +24,42 @@ HEADERS += \
     alg/shapeformation.h \
     core/amoebotparticle.h \
     core/amoebotsystem.h \
+    core/analysis.h \
+    core/convergencedetector.h \
+    core/convexhull.h \
+    core/frameencoder.h \
+    core/freesiteindex.h \
+    core/history.h \
+    core/hullmeasures.h \
+    core/jsonformat.h \
+    core/lattice.h \
+    core/latticelayout.h \
+    core/latticerenderer.h \
+    core/latticeruns.h \
     core/localparticle.h \
     core/metric.h \
+    core/metricsarchive.h \
+    core/metricssocket.h \
+    core/metricsstream.h \
     core/node.h \
     core/object.h \
+    core/onlinestats.h \
     core/particle.h \
+    core/replaysystem.h \
     core/simulator.h \
+    core/snapshot.h \
+    core/snapshotexporter.h \
     core/system.h \
+    core/systemobserver.h \
+    core/telemetrypublisher.h \
+    core/trajectory.h \
     helper/randomnumbergenerator.h \
     main/application.h \
     script/scriptengine.h \
+    script/scriptfiles.h \
     script/scriptinterface.h \
     ui/algorithm.h \
+    ui/framecapture.h \
     ui/glitem.h \
     ui/parameterlistmodel.h \
     ui/view.h \
@@ -52,18 +79,39 @@ SOURCES += \
     alg/shapeformation.cpp \
     core/amoebotparticle.cpp \
     core/amoebotsystem.cpp \
+    core/analysis.cpp \
+    core/convergencedetector.cpp \
+    core/convexhull.cpp \
+    core/frameencoder.cpp \
+    core/freesiteindex.cpp \
+    core/hullmeasures.cpp \
+    core/jsonformat.cpp \
+    core/latticelayout.cpp \
+    core/latticerenderer.cpp \
+    core/latticeruns.cpp \
     core/localparticle.cpp \
     core/metric.cpp \
+    core/metricsarchive.cpp \
+    core/metricssocket.cpp \
+    core/metricsstream.cpp \
     core/object.cpp \
+    core/onlinestats.cpp \
     core/particle.cpp \
+    core/replaysystem.cpp \
     core/simulator.cpp \
+    core/snapshotexporter.cpp \
     core/system.cpp \
+    core/systemobserver.cpp \
+    core/telemetrypublisher.cpp \
+    core/trajectory.cpp \
     helper/randomnumbergenerator.cpp \
     main/application.cpp \
     main/main.cpp\
     script/scriptengine.cpp \
+    script/scriptfiles.cpp \
     script/scriptinterface.cpp \
     ui/algorithm.cpp \
+    ui/framecapture.cpp \
     ui/glitem.cpp \
     ui/parameterlistmodel.cpp \
     ui/view.cpp \
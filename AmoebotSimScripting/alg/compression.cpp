@@ -3,6 +3,7 @@
  * notice can be found at the top of main/main.cpp. */
 
 #include "alg/compression.h"
+#include "core/hullmeasures.h"
 
 #include <algorithm> // For distance() and find().
 #include <set>
@@ -31,9 +32,32 @@ CompressionParticle::CompressionParticle(const Node head,
       numNbrsSameDirBefore(0),
       numRedNbrsSameDirBefore(0),
       flag(false),
-      _state(state)
+      _state(state),
+      _lineParent{nullptr, nullptr},
+      _lineSize{0, 0}
 {
-  _direction = rand() % 3;
+  _direction = randInt(0, 3);
+}
+
+void CompressionParticle::setState(State state)
+{
+  if (state == _state)
+  {
+    return;
+  }
+
+  BlackLineTracker &tracker = dynamic_cast<CompressionSystem &>(system).lineTracker;
+  if (_state == State::Black)
+  {
+    tracker.remove(this);
+  }
+  const State oldState = _state;
+  _state = state;
+  if (_state == State::Black)
+  {
+    tracker.add(this);
+  }
+  notifyStateChange(static_cast<int>(oldState), static_cast<int>(_state));
 }
 
 void CompressionParticle::activate()
@@ -69,33 +93,33 @@ void CompressionParticle::activate()
       {
         if (q < 0.000037135)
         {
-          _state = State::Blue;
+          setState(State::Blue);
         }
         else
         {
-          _state = State::Red;
+          setState(State::Red);
         }
       }
       else if (_state == State::Blue)
       {
         if (q < 0.999962865)
         {
-          _state = State::Red;
+          setState(State::Red);
         }
         else
         {
-          _state = State::Blue;
+          setState(State::Blue);
         }
       }
       if (_state == State::Black && !hasRBNbrInLine() && !stuckInRedLine())
       {
         if (q < 0.999962865)
         {
-          _state = State::Red;
+          setState(State::Red);
         }
         if (q > 0.999962865)
         {
-          _state = State::Blue;
+          setState(State::Blue);
         }
       }
     }
@@ -142,12 +166,12 @@ void CompressionParticle::activate()
 
     if (stuckInRedLine() && _state == State::Red)
     {
-      _state = State::Black;
+      setState(State::Black);
     }
 
     if (hasRBNbrInLine() && !stuckInRedLine() && _state == State::Red && q < a)
     { //If it is in a line with another particle, decide if it will turn black or not.
-      _state = State::Black;
+      setState(State::Black);
     }
 
     if (hasRBNbrInLine() && _state == State::Red)
@@ -158,7 +182,9 @@ void CompressionParticle::activate()
 
     if (!hasRBNbrInLine() && q < 1 && _state != State::Black)
     { //Left out "&& redNbrCount(uniqueLabels()) == 0"
-      _direction = rand() % 3;
+      const int oldDirection = headMarkGlobalDir();
+      _direction = randInt(0, 3);
+      notifyDirectionChange(oldDirection);
     }
 
     if (canExpand(expandDir) && !hasExpNbr())
@@ -288,13 +314,9 @@ void CompressionParticle::activate()
   if (system.getCount("# Activations")._value < 1000000000)
   {
       if (system.getCount("# Activations")._value % this->system.adsorptionRate == 0) {
-        int sideLen = static_cast<int>(50);
-        int x = randInt(-sideLen + 1, sideLen);
-        int y = randInt(1, 2 * sideLen);
-        Node node(x, y);
-        //std::set<Node> occupied;
-        // If the node satisfies (iii) and is unoccupied, place a particle there.
-        if (0 < x + y && x + y < 2 * sideLen && system.particleMap.find(node) == system.particleMap.end()) {
+        // Adsorb onto a uniformly random free node of the surface, if any.
+        if (!system.freeSites->empty()) {
+          Node node = system.freeSites->at(randInt(0, system.freeSites->size()));
           int randInteger = randInt(0, 100000);
           //std::cout <<randInteger << std::endl;
           if(randInteger < 99996) {
@@ -403,7 +425,7 @@ void CompressionParticle::activate()
         system.removeBool == true;
       }
       else {
-        double randDoubleZeroToOne = rand() / (RAND_MAX + 1.0);
+        double randDoubleZeroToOne = randDouble(0, 1);
         if(numNbrs == 0) {
           removeNow = true;
         }
@@ -443,6 +465,40 @@ void CompressionParticle::activate()
 }
 // end of activate
 
+int CompressionParticle::stateCode() const
+{
+  return static_cast<int>(_state);
+}
+
+void CompressionParticle::saveState(QDataStream &out) const
+{
+  out << q << static_cast<qint32>(numNbrsBefore)
+      << static_cast<qint32>(numRedNbrsBefore)
+      << static_cast<qint32>(numBlueNbrsBefore)
+      << static_cast<qint32>(numNbrsSameDirBefore)
+      << static_cast<qint32>(numRedNbrsSameDirBefore) << flag
+      << static_cast<qint32>(_direction) << static_cast<qint32>(_state);
+}
+
+void CompressionParticle::loadState(QDataStream &in)
+{
+  qint32 nbrs, redNbrs, blueNbrs, nbrsSameDir, redNbrsSameDir, direction, state;
+  in >> q >> nbrs >> redNbrs >> blueNbrs >> nbrsSameDir >> redNbrsSameDir
+     >> flag >> direction >> state;
+  numNbrsBefore = nbrs;
+  numRedNbrsBefore = redNbrs;
+  numBlueNbrsBefore = blueNbrs;
+  numNbrsSameDirBefore = nbrsSameDir;
+  numRedNbrsSameDirBefore = redNbrsSameDir;
+  const int oldDirection = headMarkGlobalDir();
+  _direction = direction;
+  notifyDirectionChange(oldDirection);
+
+  // The state is set last, since the line tracker reads the direction of
+  // particles turning Black.
+  setState(static_cast<State>(state));
+}
+
 int CompressionParticle::headMarkColor() const
 {
   if (_state == State::Red)
@@ -1112,409 +1168,317 @@ bool CompressionParticle::checkBlueProp2(std::vector<int> S) const
   }
 }
 
-CompressionSystem::CompressionSystem(unsigned int numRedParticles, unsigned int numBlueParticles,
- unsigned int numGreenParticles, double lambda, double diffusionRate,
- double bindingAffinity, double seperationAffinity, double convertToStable,
- double detachFromLine, unsigned int adsorptionRate, unsigned int desorptionRate)
-{
-  this->removeBool = false;
-  this->numRedParticles = numRedParticles;
-  this->numBlueParticles = numBlueParticles;
-  this->numGreenParticles = numGreenParticles;
-  this->diffusionRate = diffusionRate;
-  this->bindingAffinity = bindingAffinity;
-  this->seperationAffinity = seperationAffinity;
-  this->convertToStable = convertToStable;
-  this->detachFromLine = detachFromLine;
-  this->adsorptionRate = adsorptionRate;
-  this->desorptionRate = desorptionRate;
-
-  /*
-  std::cout << "lambda " << lambda << std::endl;
-  std::cout << "diffusionRate " << diffusionRate<< std::endl;
-  std::cout << "bindingAffinity " << bindingAffinity << std::endl;
-  std::cout << "seperationAffinity " << seperationAffinity  << std::endl;
-  std::cout << "convertToStable " << convertToStable << std::endl;
-  std::cout << "detachFromLine " << detachFromLine<< std::endl;
-  std::cout << std::endl;
-  */
+BlackLineTracker::BlackLineTracker(AmoebotSystem &system)
+    : _system(system),
+      _numBlack(0) {}
 
-  Q_ASSERT(lambda > 1);
-  //std::cout << "lambda " <<lambda <<std::endl;
-  //  int numParticles = numBlueParticles + numRedParticles;
-  //MichaelM added hexagon creation and random particle insertion similar to DiscoDemo but for CompressionParticles
+void BlackLineTracker::add(CompressionParticle *p)
+{
+  Q_ASSERT(p->_state == CompressionParticle::State::Black && p->isContracted());
 
-  // sideLen is now a var of the system
-  int sideLen = static_cast<int>(std::round(50));
-  //this->sideLen = static_cast<int>(std::round(50)); //MichaelM changed 1.4 to 3.0 (control hexagon size)
-  Node boundNode(0, 0);                             //perhaps make this a variable? to easily modify?
-  for (int dir = 0; dir < 6; ++dir)
+  ++_numBlack;
+  for (Kind kind : {Height, Width})
   {
-    for (int i = 0; i < sideLen; ++i)
+    p->_lineParent[kind] = p;
+    p->_lineSize[kind] = 1;
+    _hist[kind].add(1);
+
+    const int a = axis(p, kind);
+    for (int globalDir : {a, a + 3})
     {
-      insert(new Object(boundNode));
-      boundNode = boundNode.nodeInDir(dir);
+      CompressionParticle *nbr = lineNbr(p, globalDir);
+      if (nbr != nullptr)
+      {
+        unite(p, nbr, kind);
+      }
     }
   }
+}
 
-  // Let s be the bounding hexagon side length. When the hexagon is created as
-  // above, the nodes (x,y) strictly within the hexagon have (i) -s < x < s,
-  // (ii) 0 < y < 2s, and (iii) 0 < x+y < 2s. Choose interior nodes at random to
-  // place particles, ensuring at most one particle is placed at each node.
+void BlackLineTracker::remove(CompressionParticle *p)
+{
+  Q_ASSERT(p->_state == CompressionParticle::State::Black && p->isContracted());
 
-  std::set<Node> occupied;
-  //  unsigned int numParticlesAdded = 0;
-  unsigned int numRedAdded = 0;
-  while (numRedAdded < numRedParticles)
+  --_numBlack;
+  for (Kind kind : {Height, Width})
   {
-    // First, choose an x and y position at random from the (i) and (ii) bounds.
-    //std::cout << "lambda " <<lambda <<std::endl;
-    int x = randInt(-sideLen + 1, sideLen);
-    int y = randInt(1, 2 * sideLen);
-    Node node(x, y);
-
-    // If the node satisfies (iii) and is unoccupied, place a particle there.
-    if (0 < x + y && x + y < 2 * sideLen && occupied.find(node) == occupied.end())
-    {
-      insert(new CompressionParticle(node, -1, 0, *this, lambda, CompressionParticle::State::Red));
-      // this->nodesOccupied++;
-      occupied.insert(node);
-      numRedAdded++;
-    }
-  }
+    _hist[kind].remove(find(p, kind)->_lineSize[kind]);
 
-  unsigned int numBlueAdded = 0;
-  if (numBlueParticles > 0)
-  {
-    while (numBlueAdded < numBlueParticles)
+    // The rest of p's line splits into (at most) the two runs on either side of
+    // p. If the line was a ring, both sides are the same run.
+    const int a = axis(p, kind);
+    for (int globalDir : {a, a + 3})
     {
-      // First, choose an x and y position at random from the (i) and (ii) bounds.
-      int x = randInt(-sideLen + 1, sideLen);
-      int y = randInt(1, 2 * sideLen);
-      Node blueNode(x, y);
-
-      // If the node satisfies (iii) and is unoccupied, place a particle there.
-      if (0 < x + y && x + y < 2 * sideLen && occupied.find(blueNode) == occupied.end())
+      CompressionParticle *nbr = lineNbr(p, globalDir);
+      if (nbr != nullptr && !relabel(nbr, p, globalDir, kind))
       {
-        insert(new CompressionParticle(blueNode, -1, 0, *this, lambda, CompressionParticle::State::Blue));
-        // this->nodesOccupied++;
-        occupied.insert(blueNode);
-        numBlueAdded++;
+        break;
       }
     }
+    p->_lineParent[kind] = nullptr;
+    p->_lineSize[kind] = 0;
   }
+}
 
-  unsigned int numGreenAdded = 0;
-  if (numGreenParticles > 0)
-  {
-    while (numGreenAdded < numGreenParticles)
-    {
-      // First, choose an x and y position at random from the (i) and (ii) bounds.
-      int x = randInt(-sideLen + 1, sideLen);
-      int y = randInt(1, 2 * sideLen);
-      Node greenNode(x, y);
+void BlackLineTracker::clear()
+{
+  _numBlack = 0;
+  _hist[Height] = Histogram();
+  _hist[Width] = Histogram();
+}
 
-      // If the node satisfies (iii) and is unoccupied, place a particle there.
-      if (0 < x + y && x + y < 2 * sideLen && occupied.find(greenNode) == occupied.end())
-      {
-        insert(new CompressionParticle(greenNode, -1, 0, *this, lambda, CompressionParticle::State::Green));
-        // this->nodesOccupied++;
-        occupied.insert(greenNode);
-        numGreenAdded++;
-      }
-    }
-  }
-  _measures.push_back(new PerimeterMeasure("Perimeter", 1, *this));
-  _measures.push_back(new SurfaceArea("% SC Nodes/Nodes", 1, *this));
-  _measures.push_back(new SurfaceAreaNumeratorParticles("% SC Particles/Nodes", 1, *this));
-  _measures.push_back(new PercentOrdering("% Ordering", 1, *this));
-  _measures.push_back(new AvgHeight("Avg Height", 1, *this));
-  _measures.push_back(new AvgWidth("Avg Width", 1, *this));
-  _measures.push_back(new MaxHeight("Max Height", 1, *this));
-  _measures.push_back(new MaxWidth("Max Width", 1, *this));
-  _measures.push_back(new MovesOverActivations("Moves/Activations", 1, *this));
-  //_counts.push_back(new Count("Surface Coverage"));
+int BlackLineTracker::lineLength(CompressionParticle *p, Kind kind)
+{
+  return find(p, kind)->_lineSize[kind];
+}
 
-  //totalNodes = (3*sqrt(3) * pow(50, 2))/2;  // Hexagon area = (3*√3 *(sideLen)^2)/ 2
+double BlackLineTracker::averageLength(Kind kind) const
+{
+  return ((double)_numBlack) / ((double)_hist[kind].numLines);
 }
 
-void CompressionSystem::DFSCluster(CompressionParticle &p, std::vector<CompressionParticle> &cluster,
-                                   std::vector<std::vector<CompressionParticle>> &heights, std::vector<std::vector<CompressionParticle>> &widths)
+int BlackLineTracker::maxLength(Kind kind) const
 {
-  // have height cluster and width cluster? no new method for width.!!!!!!!!!!!!!!!
-  p.countedCluster = true;
-  cluster.push_back(p);
+  return _hist[kind].max;
+}
 
-  for (int j = 0; j < 6; j++)
-  {
-    if (p.hasNbrAtLabel(j) && !p.nbrAtLabel(j).countedCluster && (p._direction == p.nbrAtLabel(j)._direction) && (p.nbrAtLabel(j)._state == CompressionParticle::State::Black))
-    {
-      DFSCluster(p.nbrAtLabel(j), cluster, heights, widths);
-    }
+int BlackLineTracker::numLines(Kind kind) const
+{
+  return _hist[kind].numLines;
+}
 
-    if (!p.countedHeight && p._state == CompressionParticle::State::Black)
-    {
-      std::vector<CompressionParticle> oneHeight = {};
-      DFSHeight(p, oneHeight);
-      heights.push_back(oneHeight);
-    }
+const std::vector<int> &BlackLineTracker::lengthHistogram(Kind kind) const
+{
+  return _hist[kind].counts;
+}
 
-    if (!p.countedWidth && p._state == CompressionParticle::State::Black)
-    {
-      std::vector<CompressionParticle> oneWidth = {};
-      DFSWidth(p, oneWidth, -2);
-      widths.push_back(oneWidth);
-    }
+void BlackLineTracker::Histogram::add(int length)
+{
+  if ((int)counts.size() <= length)
+  {
+    counts.resize(length + 1, 0);
   }
+  ++counts[length];
+  ++numLines;
+  max = std::max(max, length);
 }
 
-void CompressionSystem::DFSWidth(CompressionParticle &p, std::vector<CompressionParticle> &cluster, int dir)
+void BlackLineTracker::Histogram::remove(int length)
 {
-  // have height cluster and width cluster? no new method for width.!!!!!!!!!!!!!!!
-  p.countedWidth = true;
-  cluster.push_back(p);
-  if (dir != -2)
+  Q_ASSERT(length < (int)counts.size() && counts[length] > 0);
+
+  --counts[length];
+  --numLines;
+  while (max > 0 && counts[max] == 0)
   {
-    //std::cout << "Dir: " << dir << std::endl;
-    //std::cout << "Direction: " << p._direction << std::endl;
+    --max;
   }
-  if (dir == -2)
+}
+
+int BlackLineTracker::axis(const CompressionParticle *p, Kind kind)
+{
+  return (p->_direction + kind) % 3;
+}
+
+CompressionParticle *BlackLineTracker::lineNbr(const CompressionParticle *p, int globalDir) const
+{
+  const Node node = _system.lattice.nodeInDir(p->head, globalDir);
+  auto it = _system.particleMap.find(node);
+  if (it == _system.particleMap.end())
   {
-    bool found = false;
-    for (int j = 0; j < 6; j++)
-    {
-      if (!found && (j != p._direction) && (j != (p._direction + 3)))
-      {
-        if (p.hasNbrAtLabel(j) && !p.nbrAtLabel(j).countedWidth && (p._direction == p.nbrAtLabel(j)._direction) && (p.nbrAtLabel(j)._state == CompressionParticle::State::Black))
-        {
-          int dirToPass;
-          if (j >= 3)
-          {
-            dirToPass = j - 3;
-          }
-          else
-          {
-            dirToPass = j;
-          }
-          found = true;
-          DFSWidth(p.nbrAtLabel(j), cluster, dirToPass);
-          break;
-        }
-      }
-    }
+    return nullptr;
   }
-  else
+
+  auto nbr = dynamic_cast<CompressionParticle *>(it->second);
+  if (nbr == nullptr || nbr == p || nbr->isExpanded() ||
+      nbr->_state != CompressionParticle::State::Black ||
+      nbr->_direction != p->_direction)
   {
-    //std::cout << "dir one " << dir << std::endl;
-    // this is a given
-    if (dir < 3 && dir >= 0)
-    {
-      //std::cout << "dir two " << dir << std::endl;
-      for (int j = dir; j < 6; j = j + 3)
-      {
-        if (p.hasNbrAtLabel(j) && !p.nbrAtLabel(j).countedWidth && (p._direction == p.nbrAtLabel(j)._direction) && (p.nbrAtLabel(j)._state == CompressionParticle::State::Black))
-        {
-          //std::cout << "dir three" << dir << std::endl;
-          DFSWidth(p.nbrAtLabel(j), cluster, dir);
-          //std::cout << "dir four" << dir << std::endl;
-        }
-      }
-    }
+    return nullptr;
   }
+
+  return nbr;
 }
 
-void CompressionSystem::DFSHeight(CompressionParticle &p, std::vector<CompressionParticle> &cluster)
+CompressionParticle *BlackLineTracker::find(CompressionParticle *p, Kind kind)
 {
-  // have height cluster and width cluster? no new method for width.!!!!!!!!!!!!!!!
-  p.countedHeight = true;
-  cluster.push_back(p);
+  CompressionParticle *root = p;
+  while (root->_lineParent[kind] != root)
+  {
+    root = root->_lineParent[kind];
+  }
 
-  // there are the only direction we need to check to get height
-  for (int j = p._direction; j < 6; j = j + 3)
+  // Path compression.
+  while (p != root)
   {
-    if (p.hasNbrAtLabel(j) && !p.nbrAtLabel(j).countedHeight && (p._direction == p.nbrAtLabel(j)._direction) && (p.nbrAtLabel(j)._state == CompressionParticle::State::Black))
-    {
-      DFSHeight(p.nbrAtLabel(j), cluster);
-    }
+    CompressionParticle *next = p->_lineParent[kind];
+    p->_lineParent[kind] = root;
+    p = next;
   }
+
+  return root;
 }
 
-std::vector<std::vector<CompressionParticle>> CompressionSystem::getClusters()
-//void CompressionSystem::getClusters()
+void BlackLineTracker::unite(CompressionParticle *p, CompressionParticle *q, Kind kind)
 {
-  std::vector<std::vector<CompressionParticle>> allHeights;
-  std::vector<std::vector<CompressionParticle>> allWidths;
-  std::vector<std::vector<CompressionParticle>> allClusters;
+  CompressionParticle *rootP = find(p, kind);
+  CompressionParticle *rootQ = find(q, kind);
+  if (rootP == rootQ)
+  {
+    return;
+  }
 
-  // Reset all visited flags.
-  for (auto &p : particles)
+  // Union by size.
+  if (rootP->_lineSize[kind] < rootQ->_lineSize[kind])
   {
-    auto disco_p = dynamic_cast<CompressionParticle *>(p);
-    disco_p->countedHeight = false;
-    disco_p->countedWidth = false;
-    disco_p->countedCluster = false;
+    std::swap(rootP, rootQ);
   }
+  _hist[kind].remove(rootP->_lineSize[kind]);
+  _hist[kind].remove(rootQ->_lineSize[kind]);
+  rootQ->_lineParent[kind] = rootP;
+  rootP->_lineSize[kind] += rootQ->_lineSize[kind];
+  _hist[kind].add(rootP->_lineSize[kind]);
+}
 
-  // Do DFS.
-  for (auto &p : particles)
+bool BlackLineTracker::relabel(CompressionParticle *start, CompressionParticle *stop,
+                               int globalDir, Kind kind)
+{
+  int length = 0;
+  CompressionParticle *cur = start;
+  while (cur != nullptr && cur != stop)
   {
-    auto disco_p = dynamic_cast<CompressionParticle *>(p);
-    if (!disco_p->countedHeight && disco_p->_state == CompressionParticle::State::Black)
-    {
-      std::vector<CompressionParticle> heights = {};
-      DFSHeight(*disco_p, heights);
-      allHeights.push_back(heights);
-    }
-    if (!disco_p->countedWidth && disco_p->_state == CompressionParticle::State::Black)
-    {
-      std::vector<CompressionParticle> width = {};
-      DFSWidth(*disco_p, width, -2);
-      allWidths.push_back(width);
-    }
+    cur->_lineParent[kind] = start;
+    ++length;
+    cur = lineNbr(cur, globalDir);
+  }
+  start->_lineSize[kind] = length;
+  _hist[kind].add(length);
+
+  return cur != stop;
+}
+
+CompressionSystem::CompressionSystem(unsigned int numRedParticles, unsigned int numBlueParticles,
+ unsigned int numGreenParticles, double lambda, double diffusionRate,
+ double bindingAffinity, double seperationAffinity, double convertToStable,
+ double detachFromLine, unsigned int adsorptionRate, unsigned int desorptionRate,
+ int sideLen, bool periodic)
+    : lineTracker(*this)
+{
+  this->removeBool = false;
+  this->numRedParticles = numRedParticles;
+  this->numBlueParticles = numBlueParticles;
+  this->numGreenParticles = numGreenParticles;
+  this->diffusionRate = diffusionRate;
+  this->bindingAffinity = bindingAffinity;
+  this->seperationAffinity = seperationAffinity;
+  this->convertToStable = convertToStable;
+  this->detachFromLine = detachFromLine;
+  this->adsorptionRate = adsorptionRate;
+  this->desorptionRate = desorptionRate;
+  this->lambda = lambda;
+  this->sideLen = sideLen;
+  this->periodic = periodic;
+
+  /*
+  std::cout << "lambda " << lambda << std::endl;
+  std::cout << "diffusionRate " << diffusionRate<< std::endl;
+  std::cout << "bindingAffinity " << bindingAffinity << std::endl;
+  std::cout << "seperationAffinity " << seperationAffinity  << std::endl;
+  std::cout << "convertToStable " << convertToStable << std::endl;
+  std::cout << "detachFromLine " << detachFromLine<< std::endl;
+  std::cout << std::endl;
+  */
+
+  Q_ASSERT(lambda > 1);
+  //std::cout << "lambda " <<lambda <<std::endl;
+  //  int numParticles = numBlueParticles + numRedParticles;
+  //MichaelM added hexagon creation and random particle insertion similar to DiscoDemo but for CompressionParticles
 
-    // To Find hieght and width for each cluster independently
-    /*if (!disco_p->countedCluster && disco_p->_state == CompressionParticle::State::Black)
+  if (periodic)
+  {
+    // The surface is a sideLen x sideLen rhombic torus, so there are no
+    // boundary objects and every node of the torus is a site.
+    lattice = Lattice(sideLen, sideLen);
+    freeSites.reset(new FreeSiteIndex(0, 0, sideLen - 1, sideLen - 1));
+    for (int x = 0; x < sideLen; ++x)
     {
-      std::vector<CompressionParticle> clusters = {};
-      std::vector<std::vector<CompressionParticle>> heights = {};
-      std::vector<std::vector<CompressionParticle>> widths = {};
-      DFSCluster(*disco_p, clusters, heights, widths);
-      allClusters.push_back(clusters);
-      if (clusters.size() > 1)
+      for (int y = 0; y < sideLen; ++y)
       {
-        std::cout << "cluster size " << clusters.size() << std::endl;
-        std::cout << "heights in this cluster: " << heights.size() << std::endl;
-        int sumHeights = 0;
-        for (auto vec1 : heights)
-        {
-          //if (vec1.size() > 1)
-          //{
-            //std::cout << vec1.size() << " ";
-            sumHeights+= vec1.size();
-          //}
-        }
-        double avgHeight = ((double)sumHeights)/((double)heights.size());
-        std::cout << "avg height for this cluster: " << avgHeight << std::endl;
-        //std::cout << std::endl;
-        std::cout << "widths in this cluster: " << widths.size() << std::endl;
-        int sumWidths = 0;
-        for (auto vec1 : widths)
-        {
-          //if (vec1.size() > 1)
-          //{
-            //std::cout << vec1.size() << " ";
-            sumWidths+= vec1.size();
-          //}
-        }
-        double avgWidth = ((double)sumWidths)/((double)widths.size());
-        std::cout << "avg width for this cluster: " << avgWidth << std::endl;
-        std::cout << std::endl;
+        freeSites->addSite(Node(x, y));
       }
-    }*/
-  }
-  int sumAllHeights = 0;
-  int sumAllWidths = 0;
-  this->maxHeight = 0;
-  this->maxWidth = 0;
-  //std::cout << "heights: " ;
-  for (auto h : allHeights)
-  {
-    // std::cout << h.size() << " ";
-    sumAllHeights += h.size();
-    if(h.size() > this->maxHeight) {
-
-      this->maxHeight = h.size();
     }
   }
-  //std::cout << std::endl << "widths: ";
-  for (auto w : allWidths)
+  else
   {
-    //std::cout << w.size() << " ";
-    sumAllWidths += w.size();
-
-     if(w.size() > this->maxWidth) {
-      this->maxWidth = w.size();
+    Node boundNode(0, 0);
+    for (int dir = 0; dir < 6; ++dir)
+    {
+      for (int i = 0; i < sideLen; ++i)
+      {
+        insert(new Object(boundNode));
+        boundNode = boundNode.nodeInDir(dir);
+      }
     }
-  }
-   //std::cout << std::endl;
-  this->averageHeight = ((double)sumAllHeights) / ((double)allHeights.size());
-  this->averageWidth = ((double)sumAllWidths) / ((double)allWidths.size());
-  //std::cout << averageHeight << "  " << averageWidth << std::endl;
-  /*  std::map<std::vector<int>, std::vector<int>> heightsWidthsByCluster;
-  // clustervec
-  for (auto cv : allClusters)
-  {
-    std::vector<int> widthsForCluster;
-    std::vector<int> heightsForCluster;
-    // for particle in cluster
-    for (auto &p : cv)
+
+    // Let s be the bounding hexagon side length. When the hexagon is created as
+    // above, the nodes (x,y) strictly within the hexagon have (i) -s < x < s,
+    // (ii) 0 < y < 2s, and (iii) 0 < x+y < 2s. Index all of these interior nodes
+    // so that particles (initially and on adsorption) are placed at uniformly
+    // random free nodes without rejection sampling.
+    freeSites.reset(new FreeSiteIndex(-sideLen + 1, 1, sideLen - 1, 2 * sideLen - 1));
+    for (int x = -sideLen + 1; x < sideLen; ++x)
     {
-      auto disco_p = dynamic_cast<CompressionParticle *>(p);
-      //vector = wv
-      for (auto wv : allWidths)
+      for (int y = 1; y < 2 * sideLen; ++y)
       {
-        if (std::find(wv.begin(), wv.end(), p) != wv.end())
+        if (0 < x + y && x + y < 2 * sideLen)
         {
-          // wv contains p
-          widthsForCluster.insert(wv.size());
-          allWidths.erase(wv);
+          freeSites->addSite(Node(x, y));
         }
       }
-      for (auto hv : allHeights)
-      {
-        if (std::find(hv.begin(), hv.end(), p) != hv.end())
-        int size = static_cast<int>(hv.size());
-        heightsForCluster.insert(size);
-        allHeights.erase(hv);
-      }
     }
+  }
 
-    //avg height of cluster
-    int heightSumForCluster = 0;
-    for(auto hei: heightsForCluster) {
-      heightSumForCluster += hei;
-    }
-    int avgHeight = heightSumForCluster/heightsForCluster.size();
-
-    //avg width of cluster
-    int widthSumForCluster = 0;
-    for(auto wid: widthsForCluster) {
-      widthSumForCluster += wid;
-    }
-    int avgWidth = widthSumForCluster/widthsForCluster.size();
-
-    heightsWidthsByCluster.insert(avgHeight, avgWidth);
+  // Maintain the nearest neighbor pair count from the first insertion on so
+  // that the perimeter can be read at any time.
+  enableNbrPairCount();
 
-  }*/
-  /*std::cout << "all heights:" << std::endl;
-  for (auto vec1 : allHeights)
+  // Place each species at random free interior nodes. Inserting a particle
+  // marks its node as occupied, so each node receives at most one particle.
+  for (unsigned int numRedAdded = 0; numRedAdded < numRedParticles && !freeSites->empty(); numRedAdded++)
   {
-    if (vec1.size() > 1)
-    {
-      std::cout << vec1.size() << " ";
-    }
+    Node node = freeSites->at(randInt(0, freeSites->size()));
+    insert(new CompressionParticle(node, -1, 0, *this, lambda, CompressionParticle::State::Red));
   }
-  std::cout << std::endl;
-  std::cout << "all widths:" << std::endl;
-  for (auto vec1 : allWidths)
+
+  for (unsigned int numBlueAdded = 0; numBlueAdded < numBlueParticles && !freeSites->empty(); numBlueAdded++)
   {
-    if (vec1.size() > 1)
-    {
-      std::cout << vec1.size() << " ";
-    }
+    Node blueNode = freeSites->at(randInt(0, freeSites->size()));
+    insert(new CompressionParticle(blueNode, -1, 0, *this, lambda, CompressionParticle::State::Blue));
   }
-  std::cout << std::endl;
-  std::cout << "all clusters:" << std::endl;
-  for (auto vec1 : allClusters)
+
+  for (unsigned int numGreenAdded = 0; numGreenAdded < numGreenParticles && !freeSites->empty(); numGreenAdded++)
   {
-    if (vec1.size() > 1)
-    {
-      std::cout << vec1.size() << " ";
-    }
+    Node greenNode = freeSites->at(randInt(0, freeSites->size()));
+    insert(new CompressionParticle(greenNode, -1, 0, *this, lambda, CompressionParticle::State::Green));
   }
-  std::cout << std::endl;
-  */
-  return allWidths;
+  _measures.push_back(new PerimeterMeasure("Perimeter", 1, *this));
+  _measures.push_back(new SurfaceArea("% SC Nodes/Nodes", 1, *this));
+  _measures.push_back(new SurfaceAreaNumeratorParticles("% SC Particles/Nodes", 1, *this));
+  _measures.push_back(new PercentOrdering("% Ordering", 1, *this));
+  _measures.push_back(new AvgHeight("Avg Height", 1, *this));
+  _measures.push_back(new AvgWidth("Avg Width", 1, *this));
+  _measures.push_back(new MaxHeight("Max Height", 1, *this));
+  _measures.push_back(new MaxWidth("Max Width", 1, *this));
+  _measures.push_back(new MovesOverActivations("Moves/Activations", 1, *this));
+  if (!lattice.isTorus()) {
+    // Cluster spread is only meaningful on the plane, where it is unbounded.
+    _measures.push_back(new HullMeasure("Diameter", 1, *this,
+                                        HullMeasure::Extent::Diameter));
+    _measures.push_back(new HullMeasure("Min Width", 1, *this,
+                                        HullMeasure::Extent::MinWidth));
+  }
+  //_counts.push_back(new Count("Surface Coverage"));
+
 }
 
 // map? we want to find average for each group?
@@ -1722,6 +1686,49 @@ bool CompressionSystem::hasTerminated() const
   return particles.size() == 0;
 }
 
+unsigned int CompressionSystem::numSurfaceNodes() const
+{
+  return freeSites->numSites();
+}
+
+bool CompressionSystem::supportsCheckpoints() const
+{
+  return true;
+}
+
+AmoebotParticle *CompressionSystem::restoreParticle(const Node &head,
+                                                    const int globalTailDir,
+                                                    const int orientation)
+{
+  // The state is loaded with the rest of the particle's memory.
+  return new CompressionParticle(head, globalTailDir, orientation, *this,
+                                 lambda, CompressionParticle::State::Red);
+}
+
+void CompressionSystem::clearParticles()
+{
+  // The particles' line links go away with them.
+  lineTracker.clear();
+  AmoebotSystem::clearParticles();
+}
+
+bool CompressionSystem::supportsLayouts() const
+{
+  return true;
+}
+
+AmoebotParticle *CompressionSystem::layoutParticle(const Node &head,
+                                                   const int state)
+{
+  if (state < static_cast<int>(CompressionParticle::State::Red) ||
+      state > static_cast<int>(CompressionParticle::State::Green))
+  {
+    return nullptr;
+  }
+  return new CompressionParticle(head, -1, 0, *this, lambda,
+                                 static_cast<CompressionParticle::State>(state));
+}
+
 PerimeterMeasure::PerimeterMeasure(const QString name, const unsigned int freq,
                                    CompressionSystem &system)
     : Measure(name, freq),
@@ -1729,49 +1736,41 @@ PerimeterMeasure::PerimeterMeasure(const QString name, const unsigned int freq,
 
 double PerimeterMeasure::calculate() const
 {
-  int numEdges = 0;
-  for (const auto &p : _system.particles)
-  {
-    auto comp_p = dynamic_cast<CompressionParticle *>(p);
-    auto tailLabels = comp_p->isContracted() ? comp_p->uniqueLabels()
-                                             : comp_p->tailLabels();
-    for (const int label : tailLabels)
-    {
-      if (comp_p->hasNbrAtLabel(label) && !comp_p->hasExpHeadAtLabel(label))
-      {
-        ++numEdges;
-      }
-    }
-  }
-
-  return (3 * _system.size()) - (numEdges / 2) - 3;
+  return (3 * static_cast<int>(_system.size())) - _system.numNbrPairs() - 3;
 }
 
 SurfaceArea::SurfaceArea(const QString name, const unsigned int freq,
                          CompressionSystem &system)
     : Measure(name, freq),
-      _system(system) {}
-
-double SurfaceArea::calculate() const
+      _system(system),
+      _nodesOccupied(0)
 {
-  int nodesOccupied = 0;
-
-  // Loop through all particles of the system.
   for (const auto &p : _system.particles)
   {
-    // Convert the pointer to a MetricsDemoParticle so its color can be checked.
-    auto metr_p = dynamic_cast<CompressionParticle *>(p);
-    if (metr_p->isExpanded())
-    {
-      nodesOccupied += 2;
-    }
-    else
-    {
-      nodesOccupied++;
-    }
+    _nodesOccupied += p->isExpanded() ? 2 : 1;
   }
-  int sideLen = static_cast<int>(std::round(50));
-  return ((double)(nodesOccupied)*100.0) / (3.0005 * pow(sideLen, 2) - 3.0246 * sideLen + 1.0154);
+  _system.addObserver(this);
+}
+
+double SurfaceArea::calculate() const
+{
+  return ((double)(_nodesOccupied)*100.0) / _system.numSurfaceNodes();
+}
+
+void SurfaceArea::onInsert(const AmoebotParticle &particle)
+{
+  _nodesOccupied += particle.isExpanded() ? 2 : 1;
+}
+
+void SurfaceArea::onRemove(const AmoebotParticle &particle)
+{
+  _nodesOccupied -= particle.isExpanded() ? 2 : 1;
+}
+
+void SurfaceArea::onMove(const AmoebotParticle &particle, const Node &,
+                         const int oldTailDir)
+{
+  _nodesOccupied += (particle.isExpanded() ? 2 : 1) - (oldTailDir != -1 ? 2 : 1);
 }
 
 SurfaceAreaNumeratorParticles::SurfaceAreaNumeratorParticles(const QString name, const unsigned int freq,
@@ -1781,46 +1780,48 @@ SurfaceAreaNumeratorParticles::SurfaceAreaNumeratorParticles(const QString name,
 
 double SurfaceAreaNumeratorParticles::calculate() const
 {
-  int particles = 0;
-
-  // Loop through all particles of the system.
-  for (const auto &p : _system.particles)
-  {
-    // Convert the pointer to a MetricsDemoParticle so its color can be checked.
-    auto metr_p = dynamic_cast<CompressionParticle *>(p);
-    //if (metr_p->isExpanded()) {
-    //  nodesOccupied +=2;
-    //}
-    //else
-    //{
-    particles++;
-    //}
-  }
-  int sideLen = static_cast<int>(std::round(50));
-  return ((double)(particles)*100.0) / (3.0005 * pow(sideLen, 2) - 3.0246 * sideLen + 1.0154);
+  return ((double)(_system.size())*100.0) / _system.numSurfaceNodes();
 }
 
 PercentOrdering::PercentOrdering(const QString name, const unsigned int freq,
                                  CompressionSystem &system)
     : Measure(name, freq),
-      _system(system) {}
+      _system(system),
+      _numBlack(0)
+{
+  for (const auto &p : _system.particles)
+  {
+    onInsert(*p);
+  }
+  _system.addObserver(this);
+}
 
 double PercentOrdering::calculate() const
 {
-  int numBlack = 0;
+  return ((double)(_numBlack)*100.0) / static_cast<double>(_system.size());
+}
 
-  // Loop through all particles of the system.
-  for (const auto &p : _system.particles)
+void PercentOrdering::onInsert(const AmoebotParticle &particle)
+{
+  if (dynamic_cast<const CompressionParticle &>(particle)._state == CompressionParticle::State::Black)
   {
-    // Convert the pointer to a MetricsDemoParticle so its color can be checked.
-    auto metr_p = dynamic_cast<CompressionParticle *>(p);
-    if (metr_p->_state == CompressionParticle::State::Black)
-    {
-      numBlack++;
-    }
+    _numBlack++;
   }
+}
 
-  return ((double)(numBlack)*100.0) / static_cast<double>(_system.size());
+void PercentOrdering::onRemove(const AmoebotParticle &particle)
+{
+  if (dynamic_cast<const CompressionParticle &>(particle)._state == CompressionParticle::State::Black)
+  {
+    _numBlack--;
+  }
+}
+
+void PercentOrdering::onStateChange(const AmoebotParticle &, const int oldState,
+                                    const int newState)
+{
+  const int black = static_cast<int>(CompressionParticle::State::Black);
+  _numBlack += (newState == black) - (oldState == black);
 }
 
 AvgHeight::AvgHeight(const QString name,
@@ -1834,12 +1835,7 @@ AvgHeight::AvgHeight(const QString name,
 
 double AvgHeight::calculate() const
 {
-  //counter++;
-  //if (counter % 5 == 0)
-  //{
-    std::vector<std::vector<CompressionParticle>> clusters = _system.getClusters();
-  //}
-  return _system.averageHeight;
+  return _system.lineTracker.averageLength(BlackLineTracker::Height);
 }
 AvgWidth::AvgWidth(const QString name,
                    const unsigned int freq,
@@ -1849,12 +1845,7 @@ AvgWidth::AvgWidth(const QString name,
 
 double AvgWidth::calculate() const
 {
-  //counter++;
-  //if (counter % 5 == 0)
-  //{
-  std::vector<std::vector<CompressionParticle>> clusters = _system.getClusters();
-  //}
-  return _system.averageWidth;
+  return _system.lineTracker.averageLength(BlackLineTracker::Width);
 }
 MaxWidth::MaxWidth(const QString name,
                    const unsigned int freq,
@@ -1864,10 +1855,7 @@ MaxWidth::MaxWidth(const QString name,
 
 double MaxWidth::calculate() const
 {
-  std::vector<std::vector<CompressionParticle>> clusters = _system.getClusters();
-  //std::cout << "NEW ROUND " << std::endl;
-  //std::cout << "maxW: " << _system.maxWidth << std::endl;
-  return _system.maxWidth;
+  return _system.lineTracker.maxLength(BlackLineTracker::Width);
 }
 
 MaxHeight::MaxHeight(const QString name,
@@ -1878,9 +1866,7 @@ MaxHeight::MaxHeight(const QString name,
 
 double MaxHeight::calculate() const
 {
-  std::vector<std::vector<CompressionParticle>> clusters = _system.getClusters();
-  //std::cout << "maxH: " << _system.maxHeight << std::endl;
-  return _system.maxHeight;
+  return _system.lineTracker.maxLength(BlackLineTracker::Height);
 }
 
 MovesOverActivations::MovesOverActivations(const QString name,
@@ -1893,3 +1879,115 @@ double MovesOverActivations::calculate() const
   //std::cout<< (double)_system.getCount("# Moves")._value/_system.getCount("# Activations")._value <<std::endl;
   return (double)_system.getCount("# Moves")._value/_system.getCount("# Activations")._value;
 }
+
+BlackLinesAnalysis &BlackLinesAnalysis::of(CompressionSystem &system)
+{
+  for (const auto &a : system._analyses)
+  {
+    auto analysis = dynamic_cast<BlackLinesAnalysis *>(a);
+    if (analysis != nullptr)
+    {
+      return *analysis;
+    }
+  }
+
+  auto analysis = new BlackLinesAnalysis(system);
+  system._analyses.push_back(analysis);
+  system.addObserver(analysis);
+  return *analysis;
+}
+
+BlackLinesAnalysis::BlackLinesAnalysis(CompressionSystem &system)
+    : _system(system) {}
+
+const std::vector<std::vector<int>> &
+BlackLinesAnalysis::lines(BlackLineTracker::Kind kind)
+{
+  update();
+  return _lines[kind];
+}
+
+const std::vector<int> &
+BlackLinesAnalysis::lengthHistogram(BlackLineTracker::Kind kind)
+{
+  update();
+  return _histogram[kind];
+}
+
+void BlackLinesAnalysis::onInsert(const AmoebotParticle &)
+{
+  invalidate();
+}
+
+void BlackLinesAnalysis::onRemove(const AmoebotParticle &)
+{
+  invalidate();
+}
+
+void BlackLinesAnalysis::onMove(const AmoebotParticle &, const Node &,
+                                const int)
+{
+  invalidate();
+}
+
+void BlackLinesAnalysis::onStateChange(const AmoebotParticle &, const int,
+                                       const int)
+{
+  invalidate();
+}
+
+void BlackLinesAnalysis::compute()
+{
+  for (int kind = 0; kind < 2; ++kind)
+  {
+    _lines[kind].clear();
+    _histogram[kind].assign(1, 0);
+  }
+
+  // Only Black particles with the same direction form lines, so scan the
+  // Black particles of each direction separately.
+  std::vector<Node> nodes[3];
+  std::vector<int> indices[3];
+  for (unsigned int i = 0; i < _system.particles.size(); ++i)
+  {
+    auto comp_p = dynamic_cast<CompressionParticle *>(_system.particles[i]);
+    if (comp_p->_state == CompressionParticle::State::Black)
+    {
+      nodes[comp_p->_direction].push_back(comp_p->head);
+      indices[comp_p->_direction].push_back(i);
+    }
+  }
+
+  for (int dir = 0; dir < 3; ++dir)
+  {
+    addRuns(LatticeRuns(nodes[dir], dir, _system.lattice), indices[dir],
+            BlackLineTracker::Height);
+    addRuns(LatticeRuns(nodes[dir], (dir + 1) % 3, _system.lattice),
+            indices[dir], BlackLineTracker::Width);
+  }
+}
+
+void BlackLinesAnalysis::addRuns(const LatticeRuns &runs,
+                                 const std::vector<int> &indices,
+                                 BlackLineTracker::Kind kind)
+{
+  for (const auto &run : runs.runs())
+  {
+    _lines[kind].push_back({});
+    for (const int i : run)
+    {
+      _lines[kind].back().push_back(indices[i]);
+    }
+  }
+
+  const std::vector<int> &counts = runs.histogram();
+  std::vector<int> &histogram = _histogram[kind];
+  if (counts.size() > histogram.size())
+  {
+    histogram.resize(counts.size(), 0);
+  }
+  for (unsigned int length = 0; length < counts.size(); ++length)
+  {
+    histogram[length] += counts[length];
+  }
+}
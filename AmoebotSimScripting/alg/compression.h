@@ -24,10 +24,18 @@
 #include <QString>
 
 #include "core/amoebotparticle.h"
+#include "core/analysis.h"
+#include "core/latticeruns.h"
 #include "core/amoebotsystem.h"
+#include "core/systemobserver.h"
+
+// CompressionSystem must be forward declared so particles can reach its
+// BlackLineTracker.
+class CompressionSystem;
 
 class CompressionParticle : public AmoebotParticle {
   friend class CompressionSystem;
+  friend class BlackLineTracker;
   friend class PerimeterMeasure;
   friend class SurfaceArea;
   friend class PercentOrdering;
@@ -37,6 +45,7 @@ class CompressionParticle : public AmoebotParticle {
   friend class MaxHeight;
   friend class MaxWidth;
   friend class MovesOverActivations;
+  friend class BlackLinesAnalysis;
 
   enum class State {
       Red,
@@ -75,6 +84,14 @@ class CompressionParticle : public AmoebotParticle {
     int tailMarkColor() const override; //Not sure if this causes problems.
       double headMarkDir() const override;
       int tailMarkDir() const override;
+
+  // Returns the particle's State as an integer.
+  int stateCode() const override;
+
+  // Functions for checkpointing the particle's memory; see amoebotparticle.h.
+  // The bias lambda is a system parameter and is not saved.
+  void saveState(QDataStream& out) const override;
+  void loadState(QDataStream& in) override;
 protected:
   // Particle memory.
   const double lambda;
@@ -87,6 +104,11 @@ protected:
   bool flag;
   State _state;   //MichaelM added states (like in DiscoDemo)
   int _direction; //MichaelM added directions
+
+  // Union-find links of this particle's height (index 0) and width (index 1)
+  // lines while it is Black; see BlackLineTracker.
+  CompressionParticle* _lineParent[2];
+  int _lineSize[2];
 //  Direction getRandDir() const;
 
   //Member variables:
@@ -98,6 +120,10 @@ private:
   // hasNbrAtLabel() first if unsure.
   CompressionParticle& nbrAtLabel(int label) const;
 
+  // Changes this particle's state, keeping the system's BlackLineTracker up to
+  // date when the particle becomes or stops being Black.
+  void setState(State state);
+
   // hasExpNbr() checks whether this particle has an expanded neighbor, while
   // hasExpHeadAtLabel() checks whether the head of an expanded neighbor is at
   // the position at the specified label.
@@ -126,6 +152,82 @@ private:
   bool checkBlueProp2(std::vector<int> S) const;
 };
 
+// Incrementally maintains the lines formed by Black particles. A Black particle
+// with direction d lies on exactly one "height" line, the maximal run of
+// adjacent Black particles with direction d along lattice axis d (global
+// directions d and d + 3), and on exactly one "width" line, the analogous run
+// along axis (d + 1) % 3. Lines are kept in union-find structures that merge
+// when a particle turns Black next to aligned Black neighbors; when a particle
+// stops being Black, only the line it split is relabeled. Line length
+// histograms make the average and maximum heights and widths O(1) to read.
+class BlackLineTracker {
+ public:
+  enum Kind { Height = 0, Width = 1 };
+
+  // Constructs a tracker with no lines for the given system's particles.
+  BlackLineTracker(AmoebotSystem& system);
+
+  // Functions for updating the tracked lines. add must be called right after a
+  // particle becomes Black and remove right before it stops being Black (or is
+  // removed from the system while Black). Both assume Black particles are
+  // contracted, which holds between activations.
+  void add(CompressionParticle* p);
+  void remove(CompressionParticle* p);
+
+  // Returns the length of the line of the given kind through the given Black
+  // particle.
+  int lineLength(CompressionParticle* p, Kind kind);
+
+  // Forgets all lines at once, for when all particles are removed at once.
+  void clear();
+
+  // Functions for reading line statistics. averageLength returns the mean
+  // number of particles per line of the given kind (NaN if there are no Black
+  // particles), maxLength the longest such line (0 if there are none), and
+  // numLines the number of lines.
+  double averageLength(Kind kind) const;
+  int maxLength(Kind kind) const;
+  int numLines(Kind kind) const;
+
+  // Returns the length histogram of the lines of the given kind, whose entry
+  // at index l is the number of lines of length l. Unlike the histograms of
+  // LatticeRuns, it may end in zero entries left by lines that shrank.
+  const std::vector<int>& lengthHistogram(Kind kind) const;
+
+ private:
+  // Line length histogram for one kind of line.
+  struct Histogram {
+    std::vector<int> counts;
+    int numLines = 0;
+    int max = 0;
+
+    void add(int length);
+    void remove(int length);
+  };
+
+  // Returns the lattice axis of the given particle's lines of the given kind.
+  static int axis(const CompressionParticle* p, Kind kind);
+
+  // Returns the Black particle with the same direction as p occupying the node
+  // adjacent to p's head in the given global direction, or nullptr.
+  CompressionParticle* lineNbr(const CompressionParticle* p, int globalDir) const;
+
+  // Union-find operations on the lines of the given kind.
+  CompressionParticle* find(CompressionParticle* p, Kind kind);
+  void unite(CompressionParticle* p, CompressionParticle* q, Kind kind);
+
+  // Makes the run of line particles starting at start and continuing in the
+  // given global direction (stopping before stop or the end of the line) a new
+  // line of its own. Returns false if the walk reached stop, i.e., the line
+  // closed into a ring around a periodic surface.
+  bool relabel(CompressionParticle* start, CompressionParticle* stop,
+               int globalDir, Kind kind);
+
+  AmoebotSystem& _system;
+  int _numBlack;
+  Histogram _hist[2];
+};
+
 class CompressionSystem : public AmoebotSystem {
   friend class PerimeterMeasure;
   friend class SurfaceArea;
@@ -136,37 +238,93 @@ class CompressionSystem : public AmoebotSystem {
   friend class MaxHeight;
   friend class MaxWidth;
   friend class MovesOverActivations;
+  friend class BlackLinesAnalysis;
 
  public:
   // Constructs a system of CompressionParticles connected to a randomly
   // generated surface (with no tunnels). Takes an optionally specified size
   // (#particles) and a bias parameter. A bias above 2 + sqrt(2) will provably
-  // yield compression; a bias below 2.17 will provably yield expansion.
+  // yield compression; a bias below 2.17 will provably yield expansion. The
+  // surface is a hexagon of the given side length enclosed by objects or, if
+  // periodic is true, a rhombic torus of sideLen x sideLen nodes without any
+  // boundary (see node.h).
   CompressionSystem(unsigned int numRedParticles = 15, unsigned int numBlueParticles = 15,
   unsigned int numGreenParticles = 15, double lambda = 4.0, double diffusionRate = 1.0,
   double bindingAffinity = 0.6, double seperationAffinity = 0.4, double convertToStable = 0.0005,
-  double detachFromLine = 1.2, unsigned int adsorptionRate = 2000, unsigned int desorptionRate = 8000);
+  double detachFromLine = 1.2, unsigned int adsorptionRate = 2000, unsigned int desorptionRate = 8000,
+  int sideLen = 50, bool periodic = false);
   int findGroup(CompressionParticle* particle);
   void allGroups();
-  //std::vector<CompressionParticle> DFS(CompressionParticle &p);
-  void DFSHeight(CompressionParticle &p, std::vector<CompressionParticle> &cluster);
-  void DFSWidth(CompressionParticle &p, std::vector<CompressionParticle> &cluster, int dir);
-  void DFSCluster(CompressionParticle &p, std::vector<CompressionParticle> &cluster,
-    std::vector<std::vector<CompressionParticle>> &heights, std::vector<std::vector<CompressionParticle>> &widths);
-  std::vector<std::vector<CompressionParticle>> getClusters();
-  //void getClusters();
   // Because this algorithm never terminates, this simply returns false.
   virtual bool hasTerminated() const;
+
+  // Returns the number of nodes of the surface particles can occupy.
+  unsigned int numSurfaceNodes() const;
+
+  // Functions for checkpoint support; see amoebotsystem.h.
+  bool supportsCheckpoints() const override;
+  AmoebotParticle* restoreParticle(const Node& head, const int globalTailDir,
+                                   const int orientation) override;
+  void clearParticles() override;
+
+  // Functions for layout support; see amoebotsystem.h. Layouts can place Red,
+  // Blue, and Green particles, but not Black ones, whose line direction they
+  // do not record.
+  bool supportsLayouts() const override;
+  AmoebotParticle* layoutParticle(const Node& head, const int state) override;
+
+  double lambda;
   int sideLen;
-  double averageHeight;
-  double averageWidth;
-  int maxWidth;
-  int maxHeight;
+  bool periodic;
+  BlackLineTracker lineTracker;
   protected:
     //int nodesOccupied; // Priti
     // int totalNodes; // Priti
 };
 
+// Computes the same height and width lines as BlackLineTracker from scratch,
+// with one LatticeRuns scan per direction and axis. It is the non-incremental
+// path for checking the tracker and for reading the lines themselves, which
+// the tracker does not keep; measures read the tracker instead.
+class BlackLinesAnalysis : public Analysis, public SystemObserver {
+ public:
+  // Returns the Black lines analysis of the given system, creating and
+  // registering it with the system first if it has none.
+  static BlackLinesAnalysis& of(CompressionSystem& system);
+
+  // Returns the lines of the given kind, each given as a list of indices into
+  // the system's particles, and the histogram of their lengths (see
+  // LatticeRuns), recomputing them first if the system changed since.
+  const std::vector<std::vector<int>>& lines(BlackLineTracker::Kind kind);
+  const std::vector<int>& lengthHistogram(BlackLineTracker::Kind kind);
+
+  // Invalidates the lines on every event that may move, add, or remove a
+  // Black particle.
+  void onInsert(const AmoebotParticle& particle) final;
+  void onRemove(const AmoebotParticle& particle) final;
+  void onMove(const AmoebotParticle& particle, const Node& oldHead,
+              const int oldTailDir) final;
+  void onStateChange(const AmoebotParticle& particle, const int oldState,
+                     const int newState) final;
+
+ protected:
+  // Constructs an analysis of the given system; see of().
+  BlackLinesAnalysis(CompressionSystem& system);
+
+  // Rescans the Black particles for their lines.
+  void compute() final;
+
+  // Appends the given runs, whose nodes are those of the particles at the
+  // given indices, to the lines of the given kind and their lengths to its
+  // histogram.
+  void addRuns(const LatticeRuns& runs, const std::vector<int>& indices,
+               BlackLineTracker::Kind kind);
+
+  CompressionSystem& _system;
+  std::vector<std::vector<int>> _lines[2];
+  std::vector<int> _histogram[2];
+};
+
 class PerimeterMeasure : public Measure {
  public:
   // Constructs a PerimeterMeasure by using the parent constructor and adding a
@@ -176,24 +334,33 @@ class PerimeterMeasure : public Measure {
 
   // Calculates the perimeter of the system, i.e., the number of edges on the
   // walk around the unique external boundary of the system. Uses the fact
-  // that perimeter = (3 * #particles) - (#nearest neighbor pairs) - 3.
+  // that perimeter = (3 * #particles) - (#nearest neighbor pairs) - 3, where
+  // the system maintains the number of pairs incrementally.
   double calculate() const final;
 
  protected:
   CompressionSystem& _system;
 };
 
-class SurfaceArea : public Measure {
+class SurfaceArea : public Measure, public SystemObserver {
  public:
-  // Constructs a SurfaceArea
+  // Constructs a SurfaceArea, which observes the system to keep a running
+  // count of the nodes occupied by particles.
   SurfaceArea(const QString name, const unsigned int freq,
                     CompressionSystem& system);
 
   // Calculated the percentage of surface area covered.
   double calculate() const final;
 
+  // Updates the number of occupied nodes.
+  void onInsert(const AmoebotParticle& particle) final;
+  void onRemove(const AmoebotParticle& particle) final;
+  void onMove(const AmoebotParticle& particle, const Node& oldHead,
+              const int oldTailDir) final;
+
  protected:
   CompressionSystem& _system;
+  int _nodesOccupied;
 };
 
 class SurfaceAreaNumeratorParticles : public Measure {
@@ -209,17 +376,25 @@ class SurfaceAreaNumeratorParticles : public Measure {
   CompressionSystem& _system;
 };
 
-class PercentOrdering : public Measure {
+class PercentOrdering : public Measure, public SystemObserver {
  public:
-  // Constructs a SurfaceArea
+  // Constructs a PercentOrdering, which observes the system to keep a running
+  // count of its Black particles.
   PercentOrdering(const QString name, const unsigned int freq,
                     CompressionSystem& system);
 
-  // Calculated the percentage of surface area covered.
+  // Calculates the percentage of particles that are Black.
   double calculate() const final;
 
+  // Updates the number of Black particles.
+  void onInsert(const AmoebotParticle& particle) final;
+  void onRemove(const AmoebotParticle& particle) final;
+  void onStateChange(const AmoebotParticle& particle, const int oldState,
+                     const int newState) final;
+
  protected:
   CompressionSystem& _system;
+  int _numBlack;
 };
 
 class AvgHeight : public Measure {
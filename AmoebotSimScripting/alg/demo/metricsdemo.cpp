@@ -4,8 +4,7 @@
 
 #include "alg/demo/metricsdemo.h"
 
-#include <algorithm>  // for std::max
-#include <cmath>      // for std::sqrt, std::pow
+#include <cmath>  // for std::round, std::sqrt
 
 MetricsDemoParticle::MetricsDemoParticle(const Node& head,
                                          const int globalTailDir,
@@ -24,7 +23,9 @@ void MetricsDemoParticle::activate() {
   _counter--;
   if (_counter == 0) {
     _counter = _counterMax;
+    const State oldState = _state;
     _state = getRandColor();
+    notifyStateChange(static_cast<int>(oldState), static_cast<int>(_state));
   }
 
   // Next, handle movement. If the particle is contracted, choose a random
@@ -87,6 +88,10 @@ QString MetricsDemoParticle::inspectionText() const {
   return text;
 }
 
+int MetricsDemoParticle::stateCode() const {
+  return static_cast<int>(_state);
+}
+
 MetricsDemoParticle::State MetricsDemoParticle::getRandColor() const {
   // Randomly select an integer and return the corresponding state via casting.
   return static_cast<State>(randInt(0, 7));
@@ -126,48 +131,44 @@ MetricsDemoSystem::MetricsDemoSystem(unsigned int numParticles, int counterMax)
   // Set up metrics.
   _counts.push_back(new Count("# Wall Bumps"));
   _measures.push_back(new PercentRedMeasure("% Red", 1, *this));
-  _measures.push_back(new MaxDistanceMeasure("Max. Distance", 1, *this));
+  _measures.push_back(new HullMeasure("Max. Distance", 1, *this,
+                                      HullMeasure::Extent::Diameter));
 }
 
 PercentRedMeasure::PercentRedMeasure(const QString name,
                                      const unsigned int freq,
                                      MetricsDemoSystem& system)
     : Measure(name, freq),
-      _system(system) {}
+      _system(system),
+      _numRed(0) {
+  // Count the Red particles once; from then on, observe the system to keep the
+  // count up to date.
+  for (const auto& p : _system.particles) {
+    onInsert(*p);
+  }
+  _system.addObserver(this);
+}
 
 double PercentRedMeasure::calculate() const {
-  int numRed = 0;
+  return _numRed / static_cast<double>(_system.size()) * 100;
+}
 
-  // Loop through all particles of the system.
-  for (const auto& p : _system.particles) {
-    // Convert the pointer to a MetricsDemoParticle so its color can be checked.
-    auto metr_p = dynamic_cast<MetricsDemoParticle*>(p);
-    if (metr_p->_state == MetricsDemoParticle::State::Red) {
-      numRed++;
-    }
+void PercentRedMeasure::onInsert(const AmoebotParticle& particle) {
+  const auto& metr_p = dynamic_cast<const MetricsDemoParticle&>(particle);
+  if (metr_p._state == MetricsDemoParticle::State::Red) {
+    _numRed++;
   }
-
-  return numRed / static_cast<double>(_system.size()) * 100;
 }
 
-MaxDistanceMeasure::MaxDistanceMeasure(const QString name,
-                                       const unsigned int freq,
-                                       MetricsDemoSystem& system)
-    : Measure(name, freq),
-      _system(system) {}
-
-double MaxDistanceMeasure::calculate() const {
-  double maxDist = 0.0;
-  for (const auto& p1 : _system.particles) {
-    double x1 = p1->head.x + p1->head.y / 2.0;
-    double y1 = std::sqrt(3.0) / 2 * p1->head.y;
-    for (const auto& p2 : _system.particles) {
-      double x2 = p2->head.x + p2->head.y / 2.0;
-      double y2 = std::sqrt(3.0) / 2 * p2->head.y;
-      maxDist = std::max(std::sqrt(std::pow(x2 - x1, 2) + std::pow(y2 - y1, 2)),
-                         maxDist);
-    }
+void PercentRedMeasure::onRemove(const AmoebotParticle& particle) {
+  const auto& metr_p = dynamic_cast<const MetricsDemoParticle&>(particle);
+  if (metr_p._state == MetricsDemoParticle::State::Red) {
+    _numRed--;
   }
+}
 
-  return maxDist;
+void PercentRedMeasure::onStateChange(const AmoebotParticle&,
+                                      const int oldState, const int newState) {
+  const int red = static_cast<int>(MetricsDemoParticle::State::Red);
+  _numRed += (newState == red) - (oldState == red);
 }
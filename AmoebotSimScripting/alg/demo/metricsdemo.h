@@ -15,6 +15,7 @@
 
 #include "core/amoebotparticle.h"
 #include "core/amoebotsystem.h"
+#include "core/hullmeasures.h"
 
 class MetricsDemoParticle : public AmoebotParticle {
   friend class PercentRedMeasure;
@@ -52,6 +53,9 @@ class MetricsDemoParticle : public AmoebotParticle {
   // snapshot the current values of this particle's memory at runtime.
   QString inspectionText() const override;
 
+  // Returns the particle's color as an integer.
+  int stateCode() const override;
+
  protected:
   // Returns a random State.
   State getRandColor() const;
@@ -67,7 +71,6 @@ class MetricsDemoParticle : public AmoebotParticle {
 
 class MetricsDemoSystem : public AmoebotSystem {
   friend class PercentRedMeasure;
-  friend class MaxDistanceMeasure;
 
  public:
   // Constructs a system of the specified number of MetricsDemoParticles
@@ -75,33 +78,27 @@ class MetricsDemoSystem : public AmoebotSystem {
   MetricsDemoSystem(unsigned int numParticles = 30, int counterMax = 5);
 };
 
-class PercentRedMeasure : public Measure {
+class PercentRedMeasure : public Measure, public SystemObserver {
  public:
   // Constructs a PercentRedMeasure by using the parent constructor and adding a
-  // reference to the MetricsDemoSystem being measured.
+  // reference to the MetricsDemoSystem being measured, which it observes to
+  // keep a running count of its Red particles.
   PercentRedMeasure(const QString name, const unsigned int freq,
                     MetricsDemoSystem& system);
 
   // Calculated the percentage of particles in the system in the Red state.
   double calculate() const final;
 
- protected:
-  MetricsDemoSystem& _system;
-};
-
-class MaxDistanceMeasure : public Measure {
- public:
-  // Constructs a MaxDistanceMeasure by using the parent constructor and adding
-  // a reference to the MetricsDemoSystem being measured.
-  MaxDistanceMeasure(const QString name, const unsigned int freq,
-                     MetricsDemoSystem& system);
-
-  // Calculates the largest Cartesian distance between any pair of particles in
-  // the system.
-  double calculate() const final;
+  // Updates the number of Red particles as particles are inserted, removed, or
+  // change color.
+  void onInsert(const AmoebotParticle& particle) final;
+  void onRemove(const AmoebotParticle& particle) final;
+  void onStateChange(const AmoebotParticle& particle, const int oldState,
+                     const int newState) final;
 
  protected:
   MetricsDemoSystem& _system;
+  int _numRed;
 };
 
 #endif  // AMOEBOTSIM_ALG_DEMO_METRICSDEMO_H_
@@ -6,7 +6,7 @@
 
 AmoebotParticle::AmoebotParticle(const Node& head, int globalTailDir,
                                  const int orientation, AmoebotSystem& system)
-  : LocalParticle(head, globalTailDir, orientation),
+  : LocalParticle(head, globalTailDir, orientation, system.lattice),
     system(system) {}
 
 AmoebotParticle::~AmoebotParticle() {}
@@ -42,10 +42,12 @@ bool AmoebotParticle::canExpand(int label) const {
 void AmoebotParticle::expand(int label) {
   Q_ASSERT(canExpand(label));
 
+  const Node oldHead = head;
   const int globalExpansionDir = localToGlobalDir(label);
-  head = head.nodeInDir(globalExpansionDir);
+  head = lattice.nodeInDir(head, globalExpansionDir);
   globalTailDir = (globalExpansionDir + 3) % 6;
-  system.particleMap[head] = this;
+  system.occupy(head, this);
+  system.notifyMove(this, oldHead, -1);
 
   system.registerMovement();
 }
@@ -61,9 +63,13 @@ void AmoebotParticle::push(int label) {
   Q_ASSERT(canPush(label));
 
   const int globalExpansionDir = localToGlobalDir(label);
-  const Node handoverNode = head.nodeInDir(globalExpansionDir);
+  const Node handoverNode = lattice.nodeInDir(head, globalExpansionDir);
   auto& neighbor = nbrAtLabel<AmoebotParticle>(label);
+  const Node oldHead = head, nbrOldHead = neighbor.head;
+  const int nbrOldTailDir = neighbor.globalTailDir;
 
+  // This particle keeps its tail node, but the neighbor may not.
+  system.untrackTail(&neighbor);
   head = handoverNode;
   globalTailDir = (globalExpansionDir + 3) % 6;
   system.particleMap[handoverNode] = this;
@@ -72,6 +78,9 @@ void AmoebotParticle::push(int label) {
     neighbor.head = neighbor.tail();
   }
   neighbor.globalTailDir = -1;
+  system.trackTail(&neighbor);
+  system.notifyMove(this, oldHead, -1);
+  system.notifyMove(&neighbor, nbrOldHead, nbrOldTailDir);
 
   system.registerMovement(2);
   system.registerActivation(&neighbor);
@@ -87,9 +96,12 @@ void AmoebotParticle::contract(int label) {
 void AmoebotParticle::contractHead() {
   Q_ASSERT(isExpanded());
 
-  system.particleMap.erase(head);
+  const Node oldHead = head;
+  const int oldTailDir = globalTailDir;
+  system.vacate(head);
   head = tail();
   globalTailDir = -1;
+  system.notifyMove(this, oldHead, oldTailDir);
 
   system.registerMovement();
 }
@@ -97,8 +109,12 @@ void AmoebotParticle::contractHead() {
 void AmoebotParticle::contractTail() {
   Q_ASSERT(isExpanded());
 
-  system.particleMap.erase(tail());
+  const int oldTailDir = globalTailDir;
+  system.untrackTail(this);
+  system.vacate(tail());
   globalTailDir = -1;
+  system.trackTail(this);
+  system.notifyMove(this, head, oldTailDir);
 
   system.registerMovement();
 }
@@ -116,7 +132,11 @@ void AmoebotParticle::pull(int label) {
   const int globalPullDir = labelToGlobalDir(label);
   const Node handoverNode = isHeadLabel(label) ? head : tail();
   auto& neighbor = nbrAtLabel<AmoebotParticle>(label);
+  const Node oldHead = head, nbrOldHead = neighbor.head;
+  const int oldTailDir = globalTailDir;
 
+  // The neighbor keeps its node as its tail node, but this particle may not.
+  system.untrackTail(this);
   if (isHeadLabel(label)) {
     head = tail();
   }
@@ -125,11 +145,33 @@ void AmoebotParticle::pull(int label) {
   neighbor.head = handoverNode;
   neighbor.globalTailDir = globalPullDir;
   system.particleMap[handoverNode] = &neighbor;
+  system.trackTail(this);
+  system.notifyMove(this, oldHead, oldTailDir);
+  system.notifyMove(&neighbor, nbrOldHead, -1);
 
   system.registerMovement(2);
   system.registerActivation(&neighbor);
 }
 
+int AmoebotParticle::stateCode() const {
+  return 0;
+}
+
+void AmoebotParticle::saveState(QDataStream&) const {}
+
+void AmoebotParticle::loadState(QDataStream&) {}
+
+void AmoebotParticle::notifyStateChange(int oldState, int newState) {
+  system.notifyStateChange(this, oldState, newState);
+}
+
+void AmoebotParticle::notifyDirectionChange(int oldDir) {
+  const int newDir = headMarkGlobalDir();
+  if (newDir != oldDir) {
+    system.notifyDirectionChange(this, oldDir, newDir);
+  }
+}
+
 bool AmoebotParticle::hasNbrAtLabel(int label) const {
   const Node neighboringNode = nbrNodeReachedViaLabel(label);
   return system.particleMap.find(neighboringNode) != system.particleMap.end();
@@ -154,6 +196,10 @@ bool AmoebotParticle::hasTailAtLabel(int label) {
 }
 
 bool AmoebotParticle::hasObjectAtLabel(int label) const {
+  if (system.objectMap.empty()) {
+    return false;
+  }
+
   const Node neighboringNode = nbrNodeReachedViaLabel(label);
   return system.objectMap.find(neighboringNode) != system.objectMap.end();
 }
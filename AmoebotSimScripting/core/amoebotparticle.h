@@ -18,6 +18,8 @@
 #include <map>
 #include <memory>
 
+#include <QDataStream>
+
 #include "core/amoebotsystem.h"
 #include "core/localparticle.h"
 #include "core/node.h"
@@ -39,6 +41,20 @@ class AmoebotParticle : public LocalParticle, public RandomNumberGenerator {
   // virtual function which must be overridden by any particle subclasses.
   virtual void activate() = 0;
 
+  // Returns an integer encoding of this particle's algorithm-specific state,
+  // used when recording the particle outside of its algorithm (e.g., in a
+  // Snapshot). Particles without states use the default of 0.
+  virtual int stateCode() const;
+
+  // Functions for checkpointing this particle's algorithm-specific memory (see
+  // AmoebotSystem::saveCheckpoint). saveState writes it to the given stream,
+  // and loadState reads it back into a particle that the system has just
+  // restored at the same position and inserted. Particle subclasses whose
+  // memory or tokens affect their behavior must override both; the default
+  // implementations save nothing.
+  virtual void saveState(QDataStream& out) const;
+  virtual void loadState(QDataStream& in);
+
   // Returns the global direction from the head (respectively, tail) on which to
   // draw the direction markers (-1 indicates no marker). Meant to provide info
   // to the visualization and should not be called by any particle algorithms.
@@ -77,6 +93,18 @@ class AmoebotParticle : public LocalParticle, public RandomNumberGenerator {
   bool canPull(int label) const;
   void pull(int label);
 
+  // Informs the system's observers (see systemobserver.h) that this particle's
+  // state changed from oldState to newState. Algorithms whose measures observe
+  // state changes call this whenever they update their state, encoding states
+  // as integers (e.g., by casting their State enum).
+  void notifyStateChange(int oldState, int newState);
+
+  // Informs the system's observers that the global direction of this
+  // particle's direction marker (see headMarkGlobalDir) changed from oldDir.
+  // Algorithms whose direction markers carry information (e.g., a preferred
+  // lattice axis) call this whenever they change what headMarkDir returns.
+  void notifyDirectionChange(int oldDir);
+
   // Gets a reference to the neighboring particle incident to the specified port
   // label. Crashes if no such particle exists at this label; consider using
   // hasNbrAtLabel() first if unsure.
@@ -4,18 +4,80 @@
 
 #include "core/amoebotsystem.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+#include <QDataStream>
 #include <QDateTime>
+#include <QFile>
+#include <QRunnable>
+#include <QSaveFile>
 #include <QtGlobal>
 
 #include "core/amoebotparticle.h"
+#include "core/jsonformat.h"
+
+class MeasureTask : public QRunnable {
+ public:
+  MeasureTask(Measure* measure, std::shared_ptr<const Snapshot> snapshot)
+    : measure(measure),
+      snapshot(snapshot),
+      result(0.0),
+      done(false) {
+    // Tasks are deleted by the system once their results are recorded.
+    setAutoDelete(false);
+  }
+
+  void run() override {
+    result = measure->calculateFromSnapshot(*snapshot);
+    done.store(true);
+  }
+
+  Measure* const measure;
+  const std::shared_ptr<const Snapshot> snapshot;
+  double result;
+  std::atomic<bool> done;
+};
+
+namespace {
+
+// Identifies checkpoint files and the version of their layout, which must be
+// increased whenever the layout changes.
+const char checkpointMagic[8] = {'A', 'M', 'B', 'C', 'K', 'P', 'N', 'T'};
+const quint32 checkpointVersion = 1;
 
-AmoebotSystem::AmoebotSystem() {
+void writeNode(QDataStream& out, const Node& node) {
+  out << static_cast<qint32>(node.x) << static_cast<qint32>(node.y);
+}
+
+Node readNode(QDataStream& in) {
+  qint32 x, y;
+  in >> x >> y;
+  return Node(x, y);
+}
+
+}  // namespace
+
+AmoebotSystem::AmoebotSystem()
+  : _countNbrPairs(false),
+    _numNbrPairs(0),
+    _time(0),
+    _parallelMeasures(false),
+    _checkpointInterval(0),
+    _checkpointDue(false) {
   _counts.push_back(new Count("# Rounds"));
   _counts.push_back(new Count("# Activations"));
   _counts.push_back(new Count("# Moves"));
 }
 
 AmoebotSystem::~AmoebotSystem() {
+  // The recorder, exporter, and publisher follow the particles, so they finish
+  // before the particles are gone.
+  closeTrajectory();
+  _exporter.reset();
+  _telemetry.reset();
+
   for (auto p : particles) {
     delete p;
   }
@@ -26,6 +88,11 @@ AmoebotSystem::~AmoebotSystem() {
   }
   objects.clear();
 
+  // Pending measure tasks reference the measures, so they must finish first;
+  // their results are collected so that open metrics streams are complete.
+  closeMetricsStream();
+  closeMetricsSocket();
+
   for (auto c : _counts) {
     delete c;
   }
@@ -33,6 +100,10 @@ AmoebotSystem::~AmoebotSystem() {
   for (auto m : _measures) {
     delete m;
   }
+
+  for (auto a : _analyses) {
+    delete a;
+  }
 }
 
 void AmoebotSystem::activate() {
@@ -40,6 +111,7 @@ void AmoebotSystem::activate() {
     AmoebotParticle* particle = particles.at(randInt(0, particles.size()));
     registerActivation(particle);
     particle->activate();
+    checkpointIfDue();
   }
 }
 
@@ -48,6 +120,7 @@ void AmoebotSystem::activateParticleAt(Node node) {
   if (it != particleMap.end()) {
     registerActivation(it->second);
     it->second->activate();
+    checkpointIfDue();
   }
 }
 
@@ -74,10 +147,12 @@ void AmoebotSystem::insert(AmoebotParticle* particle) {
            particleMap.find(particle->tail()) == particleMap.end());
 
   particles.push_back(particle);
-  particleMap[particle->head] = particle;
+  occupy(particle->head, particle);
   if (particle->isExpanded()) {
-    particleMap[particle->tail()] = particle;
+    occupy(particle->tail(), particle);
   }
+  trackTail(particle);
+  notifyInsert(particle);
 }
 
 void AmoebotSystem::insert(Object* object) {
@@ -88,16 +163,88 @@ void AmoebotSystem::insert(Object* object) {
   objectMap[object->_node] = object;
 }
 
+void AmoebotSystem::insertAll(
+    const std::vector<AmoebotParticle*>& newParticles,
+    const std::vector<Object*>& newObjects) {
+  std::vector<std::pair<Node, AmoebotParticle*>> particleNodes;
+  particleNodes.reserve(newParticles.size());
+  for (const auto p : newParticles) {
+    particleNodes.push_back({p->head, p});
+    if (p->isExpanded()) {
+      particleNodes.push_back({p->tail(), p});
+    }
+  }
+  std::sort(particleNodes.begin(), particleNodes.end());
+  std::vector<std::pair<Node, Object*>> objectNodes;
+  objectNodes.reserve(newObjects.size());
+  for (const auto o : newObjects) {
+    objectNodes.push_back({o->_node, o});
+  }
+  std::sort(objectNodes.begin(), objectNodes.end());
+
+  // In ascending order, the node following the last insertion is the right
+  // hint for the next one unless an existing node lies in between.
+  const size_t numOccupied = particleMap.size();
+  if (!particleNodes.empty()) {
+    auto hint = particleMap.lower_bound(particleNodes.front().first);
+    for (const auto& n : particleNodes) {
+      hint = std::next(particleMap.emplace_hint(hint, n.first, n.second));
+      if (freeSites != nullptr) {
+        freeSites->markOccupied(n.first);
+      }
+    }
+  }
+  Q_ASSERT(particleMap.size() == numOccupied + particleNodes.size());
+  const size_t numObjects = objectMap.size();
+  if (!objectNodes.empty()) {
+    auto hint = objectMap.lower_bound(objectNodes.front().first);
+    for (const auto& n : objectNodes) {
+      hint = std::next(objectMap.emplace_hint(hint, n.first, n.second));
+    }
+  }
+  Q_ASSERT(objectMap.size() == numObjects + objectNodes.size());
+
+  if (_countNbrPairs) {
+    // Pairs among the new particles are found in their sorted tail nodes,
+    // which is much faster than looking up every neighbor in particleMap.
+    // Pairs with particles already in the system still need particleMap.
+    std::vector<Node> tails;
+    tails.reserve(newParticles.size());
+    for (const auto p : newParticles) {
+      tails.push_back(p->isContracted() ? p->head : p->tail());
+    }
+    std::sort(tails.begin(), tails.end());
+    int numNewEdges = 0;
+    for (const auto& tail : tails) {
+      for (int dir = 0; dir < 6; ++dir) {
+        numNewEdges += std::binary_search(tails.begin(), tails.end(),
+                                          lattice.nodeInDir(tail, dir));
+      }
+    }
+    int numOldPairs = 0;
+    if (!particles.empty()) {
+      for (const auto p : newParticles) {
+        numOldPairs += tailNbrCount(p);
+      }
+      numOldPairs -= numNewEdges;
+    }
+    _numNbrPairs += numNewEdges / 2 + numOldPairs;
+  }
+  particles.insert(particles.end(), newParticles.begin(), newParticles.end());
+  objects.insert(objects.end(), newObjects.begin(), newObjects.end());
+  for (const auto p : newParticles) {
+    notifyInsert(p);
+  }
+}
+
 void AmoebotSystem::remove(AmoebotParticle* particle) {
+  notifyRemove(particle);
+  untrackTail(particle);
   particles.erase(std::remove(particles.begin(), particles.end(), particle),
                   particles.end());
-  auto it = particleMap.begin();
-  while (it != particleMap.end()) {
-    if (it->second == particle) {
-      it = particleMap.erase(it);
-    } else {
-      it++;
-    }
+  vacate(particle->head);
+  if (particle->isExpanded()) {
+    vacate(particle->tail());
   }
   activatedParticles.erase(particle);
 
@@ -110,23 +257,61 @@ void AmoebotSystem::registerMovement(unsigned int numMoves) {
 
 void AmoebotSystem::registerActivation(AmoebotParticle* particle) {
   getCount("# Activations").record();
+  _time += 1.0 / particles.size();
+  for (const auto& m : _measures) {
+    if (!m->_enabled) {
+      continue;
+    } else if (m->_schedule == Measure::Schedule::Activations) {
+      if (getCount("# Activations")._value %
+          static_cast<unsigned int>(m->_interval) == 0) {
+        recordMeasure(m);
+      }
+    } else if (m->_schedule == Measure::Schedule::Time) {
+      if (_time >= m->_nextTime) {
+        // An interval shorter than one activation's worth of time can pass
+        // several recording times at once; the measure is recorded once and
+        // the schedule skips ahead to the next time still in the future.
+        recordMeasure(m);
+        while (m->_nextTime <= _time) {
+          m->_nextTime += m->_interval;
+        }
+      }
+    }
+  }
   activatedParticles.insert(particle);
   if (activatedParticles.size() == particles.size()) {
     registerRound();
     activatedParticles.clear();
+    if (_checkpointInterval > 0 &&
+        getCount("# Rounds")._value % _checkpointInterval == 0) {
+      _checkpointDue = true;
+    }
   }
 }
 
 void AmoebotSystem::registerRound() {
+  const unsigned int round = getCount("# Rounds")._value;
+  const unsigned int activation = getCount("# Activations")._value;
   for (const auto& c : _counts) {
-    c->_history.push_back(c->_value);
+    c->recordHistory();
+    _metricsStream.write(round, activation, c->_name, c->_value);
+    _metricsSocket.write(round, c->_name, c->_value);
   }
   for (const auto& m : _measures) {
-    if (getCount("# Rounds")._value % m->_freq == 0) {
-      m->_history.push_back(m->calculate());
+    if (m->_enabled && m->_schedule == Measure::Schedule::Rounds &&
+        getCount("# Rounds")._value %
+        static_cast<unsigned int>(m->_interval) == 0) {
+      recordMeasure(m);
     }
   }
   getCount("# Rounds").record();
+  notifyRound(getCount("# Rounds")._value);
+
+  // Collect whatever parallel measures have finished in the meantime.
+  if (!_pendingMeasures.empty()) {
+    flushMeasures(false);
+  }
+  _metricsSocket.send();
 }
 
 const std::vector<Count*>& AmoebotSystem::getCounts() const {
@@ -154,21 +339,766 @@ Measure& AmoebotSystem::getMeasure(QString name) const {
   }
   Q_ASSERT(false);  // Requested measure does not exist.
 }
+void AmoebotSystem::setMeasureSchedule(Measure& measure,
+                                       const Measure::Schedule schedule,
+                                       const double interval) {
+  Q_ASSERT(schedule == Measure::Schedule::Lazy || interval > 0);
+  Q_ASSERT(schedule == Measure::Schedule::Lazy ||
+           schedule == Measure::Schedule::Time ||
+           interval == static_cast<unsigned int>(interval));
+
+  measure._schedule = schedule;
+  measure._interval = interval;
+  measure._nextTime = _time + interval;
+}
+
+void AmoebotSystem::setParallelMeasures(const bool parallel) {
+  if (!parallel) {
+    flushMeasures(true);
+  }
+  _parallelMeasures = parallel;
+}
+
+void AmoebotSystem::flushMeasures(const bool wait) {
+  if (wait) {
+    _measurePool.waitForDone();
+  }
 
+  while (!_pendingMeasures.empty() && _pendingMeasures.front()->done.load()) {
+    MeasureTask* task = _pendingMeasures.front();
+    task->measure->recordValue(task->result);
+    _metricsStream.write(task->snapshot->round, task->snapshot->activation,
+                         task->measure->_name, task->result);
+    _metricsSocket.write(task->snapshot->round, task->measure->_name,
+                         task->result);
+    if (_convergence != nullptr) {
+      _convergence->record(task->measure, task->result, task->snapshot->round);
+    }
+    _pendingMeasures.pop_front();
+    delete task;
+  }
+}
+
+bool AmoebotSystem::openMetricsStream(const QString filePath,
+                                      const MetricsStream::Format format) {
+  closeMetricsStream();
+  return _metricsStream.open(filePath, format);
+}
+
+void AmoebotSystem::closeMetricsStream() {
+  flushMeasures(true);
+  _metricsStream.close();
+}
+
+bool AmoebotSystem::flushMetricsStream() {
+  if (!_metricsStream.isOpen()) {
+    return false;
+  }
+  flushMeasures(true);
+  _metricsStream.flush();
+
+  return true;
+}
+
+bool AmoebotSystem::openMetricsSocket(const QString socketPath,
+                                      QString& error) {
+  closeMetricsSocket();
+  std::vector<QString> names;
+  for (const auto c : _counts) {
+    names.push_back(c->_name);
+  }
+  for (const auto m : _measures) {
+    names.push_back(m->_name);
+  }
+  return _metricsSocket.open(socketPath, names, error);
+}
+
+void AmoebotSystem::closeMetricsSocket() {
+  if (_metricsSocket.isOpen()) {
+    flushMeasures(true);
+    _metricsSocket.send();
+    _metricsSocket.close();
+  }
+}
+
+void AmoebotSystem::detectConvergence(
+    const std::vector<const Measure*>& measures, const unsigned int window,
+    const double threshold) {
+  // Results of measures that became due before now are not monitored.
+  flushMeasures(true);
+  if (measures.empty()) {
+    _convergence.reset();
+  } else {
+    _convergence.reset(new ConvergenceDetector(measures, window, threshold));
+  }
+}
+
+bool AmoebotSystem::hasConverged() const {
+  return _convergence != nullptr && _convergence->hasConverged();
+}
+
+long long AmoebotSystem::equilibrationRound() const {
+  return (_convergence != nullptr) ? _convergence->equilibrationRound() : -1;
+}
+
+bool AmoebotSystem::saveCheckpoint(const QString filePath, QString& error) {
+  if (!supportsCheckpoints()) {
+    error = "the algorithm does not support checkpoints";
+    return false;
+  }
+
+  // Results of parallel measures that are still pending belong to the saved
+  // histories.
+  flushMeasures(true);
+
+  // The checkpoint is assembled in memory and written at once. QSaveFile
+  // replaces an existing checkpoint only once the new one is complete, so
+  // periodic checkpoints survive a crash while saving.
+  QByteArray data;
+  QDataStream out(&data, QIODevice::WriteOnly);
+  out.setVersion(QDataStream::Qt_5_0);
+  out.writeRawData(checkpointMagic, sizeof(checkpointMagic));
+  out << checkpointVersion;
+  out << static_cast<quint32>(getSeed())
+      << QByteArray::fromStdString(getGeneratorState());
+  out << _time << removeBool;
+  out << static_cast<qint32>(lattice.width())
+      << static_cast<qint32>(lattice.height());
+
+  out << static_cast<quint32>(_counts.size());
+  for (const auto c : _counts) {
+    out << c->_name << static_cast<quint32>(c->_value);
+    c->_history.save(out);
+    out << (c->_stats != nullptr);
+    if (c->_stats != nullptr) {
+      c->_stats->save(out);
+    }
+  }
+  out << static_cast<quint32>(_measures.size());
+  for (const auto m : _measures) {
+    out << m->_name << static_cast<quint8>(m->_schedule) << m->_interval
+        << m->_nextTime << m->_enabled;
+    m->_history.save(out);
+    out << (m->_stats != nullptr);
+    if (m->_stats != nullptr) {
+      m->_stats->save(out);
+    }
+  }
+
+  out << static_cast<quint32>(objects.size());
+  for (const auto o : objects) {
+    writeNode(out, o->_node);
+  }
+
+  // Particles keep their order, which determines which particle a random
+  // activation picks; the ones activated in the current round are given by
+  // their indices in this order.
+  out << static_cast<quint32>(particles.size());
+  for (const auto p : particles) {
+    QByteArray state;
+    QDataStream stateOut(&state, QIODevice::WriteOnly);
+    stateOut.setVersion(out.version());
+    p->saveState(stateOut);
+    writeNode(out, p->head);
+    out << static_cast<qint8>(p->globalTailDir)
+        << static_cast<quint8>(p->orientation) << state;
+  }
+  out << static_cast<quint32>(activatedParticles.size());
+  for (unsigned int i = 0; i < particles.size(); ++i) {
+    if (activatedParticles.find(particles[i]) != activatedParticles.end()) {
+      out << static_cast<quint32>(i);
+    }
+  }
+
+  out << (freeSites != nullptr);
+  if (freeSites != nullptr) {
+    out << static_cast<quint32>(freeSites->size());
+    for (const auto& node : freeSites->freeSites()) {
+      writeNode(out, node);
+    }
+  }
+
+  QSaveFile file(filePath);
+  if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size() ||
+      !file.commit()) {
+    error = "could not write " + filePath;
+    return false;
+  }
+
+  return true;
+}
+
+bool AmoebotSystem::loadCheckpoint(const QString filePath, QString& error) {
+  auto fail = [&error](const QString message) {
+    error = message;
+    return false;
+  };
+
+  if (!supportsCheckpoints()) {
+    return fail("the algorithm does not support checkpoints");
+  }
+  QFile file(filePath);
+  if (!file.open(QIODevice::ReadOnly)) {
+    return fail("could not open " + filePath);
+  }
+  const QByteArray data = file.readAll();
+  QDataStream in(data);
+  in.setVersion(QDataStream::Qt_5_0);
+
+  char magic[sizeof(checkpointMagic)];
+  quint32 version;
+  if (in.readRawData(magic, sizeof(magic)) != sizeof(magic) ||
+      std::memcmp(magic, checkpointMagic, sizeof(magic)) != 0) {
+    return fail(filePath + " is not a checkpoint");
+  }
+  in >> version;
+  if (version != checkpointVersion) {
+    return fail("unsupported checkpoint version " + QString::number(version));
+  }
+
+  // Everything is read into temporaries and checked against the system first,
+  // so that a checkpoint that does not fit leaves the system unchanged.
+  quint32 seed;
+  QByteArray generatorState;
+  double time;
+  bool remove;
+  qint32 torusWidth, torusHeight;
+  in >> seed >> generatorState >> time >> remove >> torusWidth >> torusHeight;
+  if (torusWidth != lattice.width() || torusHeight != lattice.height()) {
+    return fail("the checkpoint's surface differs from the system's");
+  }
+
+  struct SavedCount {
+    unsigned int value;
+    History<int> history;
+    std::unique_ptr<OnlineStats> stats;
+  };
+  quint32 numCounts;
+  in >> numCounts;
+  if (numCounts != _counts.size()) {
+    return fail("the checkpoint's counts differ from the system's");
+  }
+  std::vector<SavedCount> counts(numCounts);
+  for (unsigned int i = 0; i < numCounts; ++i) {
+    QString name;
+    quint32 value;
+    bool hasStats;
+    in >> name >> value;
+    if (name != _counts[i]->_name) {
+      return fail("the checkpoint's counts differ from the system's");
+    } else if (!counts[i].history.load(in)) {
+      return fail("could not restore the history of count " + name);
+    }
+    counts[i].value = value;
+    in >> hasStats;
+    if (hasStats && (counts[i].stats = OnlineStats::load(in)) == nullptr) {
+      return fail("could not restore the stats of count " + name);
+    }
+  }
+
+  struct SavedMeasure {
+    Measure::Schedule schedule;
+    double interval;
+    double nextTime;
+    bool enabled;
+    History<double> history;
+    std::unique_ptr<OnlineStats> stats;
+  };
+  quint32 numMeasures;
+  in >> numMeasures;
+  if (numMeasures != _measures.size()) {
+    return fail("the checkpoint's measures differ from the system's");
+  }
+  std::vector<SavedMeasure> measures(numMeasures);
+  for (unsigned int i = 0; i < numMeasures; ++i) {
+    QString name;
+    quint8 schedule;
+    bool hasStats;
+    in >> name >> schedule >> measures[i].interval >> measures[i].nextTime
+       >> measures[i].enabled;
+    if (name != _measures[i]->_name ||
+        schedule > static_cast<quint8>(Measure::Schedule::Lazy)) {
+      return fail("the checkpoint's measures differ from the system's");
+    } else if (!measures[i].history.load(in)) {
+      return fail("could not restore the history of measure " + name);
+    }
+    measures[i].schedule = static_cast<Measure::Schedule>(schedule);
+    in >> hasStats;
+    if (hasStats && (measures[i].stats = OnlineStats::load(in)) == nullptr) {
+      return fail("could not restore the stats of measure " + name);
+    }
+  }
+
+  // Objects and particles must not overlap, which is checked by collecting the
+  // nodes they occupy.
+  std::set<Node> occupiedNodes;
+  quint32 numObjects;
+  in >> numObjects;
+  std::vector<Node> savedObjects;
+  for (unsigned int i = 0; i < numObjects && in.status() == QDataStream::Ok;
+       ++i) {
+    savedObjects.push_back(readNode(in));
+    if (!occupiedNodes.insert(savedObjects.back()).second) {
+      return fail("the checkpoint's objects overlap");
+    }
+  }
+
+  struct SavedParticle {
+    Node head;
+    int globalTailDir;
+    int orientation;
+    QByteArray state;
+  };
+  quint32 numParticles;
+  in >> numParticles;
+  std::vector<SavedParticle> savedParticles;
+  for (unsigned int i = 0; i < numParticles && in.status() == QDataStream::Ok;
+       ++i) {
+    SavedParticle p;
+    qint8 globalTailDir;
+    quint8 orientation;
+    p.head = readNode(in);
+    in >> globalTailDir >> orientation >> p.state;
+    p.globalTailDir = globalTailDir;
+    p.orientation = orientation;
+    if (p.globalTailDir < -1 || p.globalTailDir >= 6 || p.orientation >= 6) {
+      return fail("the checkpoint's particles are malformed");
+    } else if (!occupiedNodes.insert(p.head).second ||
+               (p.globalTailDir != -1 &&
+                !occupiedNodes
+                     .insert(lattice.nodeInDir(p.head, p.globalTailDir))
+                     .second)) {
+      return fail("the checkpoint's particles overlap");
+    }
+    savedParticles.push_back(p);
+  }
+  quint32 numActivated;
+  in >> numActivated;
+  std::vector<unsigned int> activated;
+  for (unsigned int i = 0; i < numActivated && in.status() == QDataStream::Ok;
+       ++i) {
+    quint32 index;
+    in >> index;
+    if (index >= numParticles) {
+      return fail("the checkpoint's particles are malformed");
+    }
+    activated.push_back(index);
+  }
+
+  // The free sites must be exactly the system's sites left unoccupied.
+  bool hasFreeSites;
+  in >> hasFreeSites;
+  if (hasFreeSites != (freeSites != nullptr)) {
+    return fail("the checkpoint's surface differs from the system's");
+  }
+  std::vector<Node> freeOrder;
+  if (hasFreeSites) {
+    unsigned int numFree = freeSites->numSites();
+    for (const auto& node : occupiedNodes) {
+      numFree -= freeSites->isSite(node);
+    }
+    quint32 numSaved;
+    in >> numSaved;
+    std::set<Node> listed;
+    for (unsigned int i = 0; i < numSaved && in.status() == QDataStream::Ok;
+         ++i) {
+      freeOrder.push_back(readNode(in));
+      if (!freeSites->isSite(freeOrder.back()) ||
+          occupiedNodes.find(freeOrder.back()) != occupiedNodes.end() ||
+          !listed.insert(freeOrder.back()).second) {
+        return fail("the checkpoint's surface differs from the system's");
+      }
+    }
+    if (numSaved != numFree) {
+      return fail("the checkpoint's surface differs from the system's");
+    }
+  }
+
+  if (in.status() != QDataStream::Ok || !in.atEnd()) {
+    return fail(filePath + " is truncated or malformed");
+  }
+  const std::string currentState = getGeneratorState();
+  if (!setGeneratorState(generatorState.toStdString())) {
+    return fail("the checkpoint's random number generator state is malformed");
+  }
+  setGeneratorState(currentState);
+
+  // The checkpoint fits, so the system's configuration is replaced. Particles
+  // are restored through insert, which keeps particleMap, freeSites, the
+  // neighbor pair count, and all observers current, and load their memory
+  // only once all of them are in place.
+  flushMeasures(true);
+  closeTrajectory();
+  clearParticles();
+  for (auto o : objects) {
+    delete o;
+  }
+  objects.clear();
+  objectMap.clear();
+  for (const auto& node : savedObjects) {
+    insert(new Object(node));
+  }
+  for (const auto& p : savedParticles) {
+    insert(restoreParticle(p.head, p.globalTailDir, p.orientation));
+  }
+  for (unsigned int i = 0; i < savedParticles.size(); ++i) {
+    QDataStream stateIn(savedParticles[i].state);
+    stateIn.setVersion(in.version());
+    particles[i]->loadState(stateIn);
+  }
+  for (const auto i : activated) {
+    activatedParticles.insert(particles[i]);
+  }
+
+  for (unsigned int i = 0; i < numCounts; ++i) {
+    _counts[i]->_value = counts[i].value;
+    _counts[i]->_history = std::move(counts[i].history);
+    _counts[i]->_history.reopen();  // The previous history's file is closed.
+    _counts[i]->_stats = std::move(counts[i].stats);
+  }
+  for (unsigned int i = 0; i < numMeasures; ++i) {
+    _measures[i]->_schedule = measures[i].schedule;
+    _measures[i]->_interval = measures[i].interval;
+    _measures[i]->_nextTime = measures[i].nextTime;
+    _measures[i]->_enabled = measures[i].enabled;
+    _measures[i]->_history = std::move(measures[i].history);
+    _measures[i]->_history.reopen();
+    _measures[i]->_stats = std::move(measures[i].stats);
+  }
+  _time = time;
+  removeBool = remove;
+  if (freeSites != nullptr) {
+    freeSites->setOrder(freeOrder);  // Checked above.
+  }
+  for (auto a : _analyses) {
+    a->invalidate();
+  }
+  _snapshot.reset();
+
+  // The detector's windows hold values recorded after the save, so it starts
+  // over with the same configuration and refills them from the restored round.
+  if (_convergence != nullptr) {
+    _convergence.reset(new ConvergenceDetector(_convergence->measures(),
+                                               _convergence->window(),
+                                               _convergence->threshold()));
+  }
+
+  // Restoring the particles may have drawn random numbers, so the generator is
+  // restored last.
+  setSeed(seed);
+  setGeneratorState(generatorState.toStdString());
+
+  return true;
+}
+
+void AmoebotSystem::setCheckpointInterval(const QString filePath,
+                                          const unsigned int rounds) {
+  _checkpointPath = filePath;
+  _checkpointInterval = rounds;
+  _checkpointDue = false;
+}
+
+bool AmoebotSystem::openTrajectory(const QString filePath,
+                                   const unsigned int keyframeInterval) {
+  closeTrajectory();
+  _trajectory.reset(new TrajectoryRecorder(*this));
+  if (!_trajectory->open(filePath, keyframeInterval)) {
+    _trajectory.reset();
+    return false;
+  }
+
+  return true;
+}
+
+void AmoebotSystem::closeTrajectory() {
+  if (_trajectory != nullptr) {
+    _trajectory->close();
+    _trajectory.reset();
+  }
+}
+
+bool AmoebotSystem::exportSnapshot(const QString filePath, QString& error) {
+  if (_exporter == nullptr) {
+    _exporter.reset(new SnapshotExporter(*this));
+  }
+  return _exporter->exportSnapshot(filePath, error);
+}
+
+void AmoebotSystem::setSnapshotInterval(const QString pathPrefix,
+                                        const unsigned int rounds) {
+  if (_exporter == nullptr) {
+    _exporter.reset(new SnapshotExporter(*this));
+  }
+  _exporter->setInterval(pathPrefix, rounds);
+}
+
+bool AmoebotSystem::openTelemetry(const QString name, const unsigned int rounds,
+                                  QString& error) {
+  if (_telemetry == nullptr) {
+    _telemetry.reset(new TelemetryPublisher(*this));
+  }
+  return _telemetry->open(name, rounds, error);
+}
+
+void AmoebotSystem::closeTelemetry() {
+  if (_telemetry != nullptr) {
+    _telemetry->close();
+  }
+}
+
+bool AmoebotSystem::loadLayout(const LatticeLayout& layout, QString& error) {
+  if (!supportsLayouts()) {
+    error = "the algorithm does not support layouts";
+    return false;
+  }
+
+  // Layouts list every node at most once, so only the surface and the objects
+  // the layout keeps can conflict with its particles.
+  const bool keepObjects = layout.objects().empty();
+  const int width = lattice.width(), height = lattice.height();
+  auto onSurface = [&](const Node& node) {
+    return width == 0 || (0 <= node.x && node.x < width &&
+                          0 <= node.y && node.y < height);
+  };
+  for (const auto& p : layout.particles()) {
+    if (!onSurface(p.head) ||
+        (freeSites != nullptr && !freeSites->isSite(p.head))) {
+      error = "particle at (" + QString::number(p.head.x) + ", " +
+              QString::number(p.head.y) + ") lies outside the surface";
+      return false;
+    } else if (keepObjects && objectMap.find(p.head) != objectMap.end()) {
+      error = "particle at (" + QString::number(p.head.x) + ", " +
+              QString::number(p.head.y) + ") overlaps an object";
+      return false;
+    }
+  }
+  for (const auto& node : layout.objects()) {
+    if (!onSurface(node) ||
+        (freeSites != nullptr && freeSites->isSite(node))) {
+      error = "object at (" + QString::number(node.x) + ", " +
+              QString::number(node.y) + ") lies on the particles' surface";
+      return false;
+    }
+  }
+
+  std::vector<AmoebotParticle*> newParticles;
+  newParticles.reserve(layout.particles().size());
+  for (const auto& p : layout.particles()) {
+    AmoebotParticle* particle = layoutParticle(p.head, p.state);
+    if (particle == nullptr) {
+      for (auto q : newParticles) {
+        delete q;
+      }
+      error = "state " + QString::number(p.state) +
+              " cannot be given to particles by layouts";
+      return false;
+    }
+    newParticles.push_back(particle);
+  }
+
+  flushMeasures(true);
+  clearParticles();
+  std::vector<Object*> newObjects;
+  if (!keepObjects) {
+    for (auto o : objects) {
+      delete o;
+    }
+    objects.clear();
+    objectMap.clear();
+    for (const auto& node : layout.objects()) {
+      newObjects.push_back(new Object(node));
+    }
+  }
+  insertAll(newParticles, newObjects);
+  for (auto a : _analyses) {
+    a->invalidate();
+  }
+  _snapshot.reset();
+
+  return true;
+}
+
+bool AmoebotSystem::supportsLayouts() const {
+  return false;
+}
+
+AmoebotParticle* AmoebotSystem::layoutParticle(const Node&, const int) {
+  return nullptr;
+}
+
+bool AmoebotSystem::supportsCheckpoints() const {
+  return false;
+}
+
+AmoebotParticle* AmoebotSystem::restoreParticle(const Node&, const int,
+                                                const int) {
+  Q_ASSERT(false);  // Only systems supporting checkpoints restore particles.
+  return nullptr;
+}
+
+void AmoebotSystem::clearParticles() {
+  // Each particle's neighbor pairs are removed from the count while its
+  // remaining neighbors are still in place, as in remove.
+  for (const auto p : particles) {
+    notifyRemove(p);
+    untrackTail(p);
+    vacate(p->head);
+    if (p->isExpanded()) {
+      vacate(p->tail());
+    }
+  }
+  for (auto p : particles) {
+    delete p;
+  }
+  particles.clear();
+  activatedParticles.clear();
+}
+
+std::shared_ptr<const Snapshot> AmoebotSystem::takeSnapshot() {
+  const unsigned int activation = getCount("# Activations")._value;
+  if (_snapshot == nullptr || _snapshot->activation != activation ||
+      _snapshot->particles.size() != particles.size()) {
+    auto snapshot = std::make_shared<Snapshot>();
+    snapshot->round = getCount("# Rounds")._value;
+    snapshot->activation = activation;
+    snapshot->particles.reserve(particles.size());
+    for (const auto p : particles) {
+      snapshot->particles.push_back({p->head, p->globalTailDir,
+                                     p->stateCode(), p->headMarkGlobalDir()});
+    }
+    _snapshot = snapshot;
+  }
+
+  return _snapshot;
+}
+
+void AmoebotSystem::recordMeasure(Measure* measure) {
+  if (_parallelMeasures && measure->usesSnapshot()) {
+    auto task = new MeasureTask(measure, takeSnapshot());
+    _pendingMeasures.push_back(task);
+    _measurePool.start(task);
+  } else {
+    const double value = measure->calculate();
+    measure->recordValue(value);
+    _metricsStream.write(getCount("# Rounds")._value,
+                         getCount("# Activations")._value, measure->_name,
+                         value);
+    _metricsSocket.write(getCount("# Rounds")._value, measure->_name, value);
+    if (_convergence != nullptr) {
+      _convergence->record(measure, value, getCount("# Rounds")._value);
+    }
+  }
+}
+
+void AmoebotSystem::checkpointIfDue() {
+  if (_checkpointDue) {
+    _checkpointDue = false;
+
+    // Failing to write a periodic checkpoint keeps the previous one; scripts
+    // learn about unwritable files when they set up periodic checkpoints.
+    QString error;
+    saveCheckpoint(_checkpointPath, error);
+  }
+}
+
+double AmoebotSystem::getTime() const {
+  return _time;
+}
+
+void AmoebotSystem::addObserver(SystemObserver* observer) {
+  _observers.push_back(observer);
+}
+
+void AmoebotSystem::removeObserver(SystemObserver* observer) {
+  _observers.erase(std::remove(_observers.begin(), _observers.end(), observer),
+                   _observers.end());
+}
+
+void AmoebotSystem::enableNbrPairCount() {
+  int numEdges = 0;
+  for (const auto p : particles) {
+    numEdges += tailNbrCount(p);
+  }
+
+  // Every pair was counted once from each of its two particles.
+  _numNbrPairs = numEdges / 2;
+  _countNbrPairs = true;
+}
+
+int AmoebotSystem::numNbrPairs() const {
+  Q_ASSERT(_countNbrPairs);
+
+  return _numNbrPairs;
+}
+
+int AmoebotSystem::tailNbrCount(const AmoebotParticle* particle) const {
+  const Node tail = particle->isContracted() ? particle->head
+                                             : particle->tail();
+  int numNbrs = 0;
+  for (int dir = 0; dir < 6; ++dir) {
+    const Node node = lattice.nodeInDir(tail, dir);
+    auto it = particleMap.find(node);
+    if (it != particleMap.end() && it->second != particle) {
+      const AmoebotParticle* nbr = it->second;
+      if (nbr->isContracted() || nbr->tail() == node) {
+        ++numNbrs;
+      }
+    }
+  }
+
+  return numNbrs;
+}
+
+void AmoebotSystem::untrackTail(const AmoebotParticle* particle) {
+  if (_countNbrPairs) {
+    _numNbrPairs -= tailNbrCount(particle);
+  }
+}
+
+void AmoebotSystem::trackTail(const AmoebotParticle* particle) {
+  if (_countNbrPairs) {
+    _numNbrPairs += tailNbrCount(particle);
+  }
+}
+
+void AmoebotSystem::occupy(const Node& node, AmoebotParticle* particle) {
+  particleMap[node] = particle;
+  if (freeSites != nullptr) {
+    freeSites->markOccupied(node);
+  }
+}
+
+void AmoebotSystem::vacate(const Node& node) {
+  particleMap.erase(node);
+  if (freeSites != nullptr) {
+    freeSites->markFree(node);
+  }
+}
 
 const QString AmoebotSystem::metricsAsJSON() const {
   QString json = "{\"title\" : \"AmoebotSim Metrics JSON\", ";
   json += "\"datetime\" : \"" +
           QDateTime::currentDateTime().toString("yyyy-MM-dd HH:mm:ss") + "\", ";
   json += "\"algorithm\" : \"???\", ";
+  if (_convergence != nullptr) {
+    json += "\"equilibrationRound\" : " +
+            (hasConverged() ? QString::number(equilibrationRound()) : "null") +
+            ", ";
+  }
   json += "\"counts\" : [";
   for (const auto& c : _counts) {
-    json += "{\"name\" : \"" + c->_name + "\", ";
+    json += "{\"name\" : " + jsonString(c->_name) + ", ";
+    json += "\"historyPolicy\" : \"" +
+            History<int>::policyName(c->_history.policy()) + "\", ";
+    if (c->_stats != nullptr) {
+      json += "\"stats\" : " + c->_stats->toJSON() + ", ";
+    }
     json += "\"history\" : [";
-    for (auto val : c->_history) {
+    const auto values = c->_history.values();
+    for (auto val : values) {
       json += QString::number(val) += ", ";
     }
-    if (!c->_history.empty()) {
+    if (!values.empty()) {
       json.chop(2);  // Remove the last ", ".
     }
     json += "]}, ";
@@ -178,13 +1108,22 @@ const QString AmoebotSystem::metricsAsJSON() const {
   }
   json += "], \"measures\" : [";
   for (const auto& m : _measures) {
-    json += "{\"name\" : \"" + m->_name + "\", ";
-    json += "\"frequency\" : " + QString::number(m->_freq) + ", ";
+    json += "{\"name\" : " + jsonString(m->_name) + ", ";
+    json += "\"schedule\" : \"" + Measure::scheduleName(m->_schedule) + "\", ";
+    json += "\"interval\" : " + QString::number(m->_interval) + ", ";
+    json += "\"enabled\" : " + QString(m->_enabled ? "true" : "false") + ", ";
+    json += "\"value\" : " + jsonNumber(m->value()) + ", ";
+    json += "\"historyPolicy\" : \"" +
+            History<double>::policyName(m->_history.policy()) + "\", ";
+    if (m->_stats != nullptr) {
+      json += "\"stats\" : " + m->_stats->toJSON() + ", ";
+    }
     json += "\"history\" : [";
-    for (auto val : m->_history) {
-      json += QString::number(val) += ", ";
+    const auto values = m->_history.values();
+    for (auto val : values) {
+      json += jsonNumber(val) + ", ";
     }
-    if (!m->_history.empty()) {
+    if (!values.empty()) {
       json.chop(2);  // Remove the last ", ".
     }
     json += "]}, ";
@@ -10,19 +10,37 @@
 
 #include <deque>
 #include <map>
+#include <memory>
 #include <set>
 #include <vector>
 
 #include <QString>
+#include <QThreadPool>
 
+#include "core/analysis.h"
+#include "core/convergencedetector.h"
+#include "core/freesiteindex.h"
+#include "core/lattice.h"
+#include "core/latticelayout.h"
 #include "core/metric.h"
+#include "core/metricssocket.h"
+#include "core/metricsstream.h"
 #include "core/object.h"
+#include "core/snapshot.h"
+#include "core/snapshotexporter.h"
 #include "core/system.h"
+#include "core/systemobserver.h"
+#include "core/telemetrypublisher.h"
+#include "core/trajectory.h"
 #include "helper/randomnumbergenerator.h"
 
 // AmoebotParticle must be forward declared to avoid a cyclic dependency.
 class AmoebotParticle;
 
+// A MeasureTask evaluates one measure on a snapshot on a worker thread; see
+// amoebotsystem.cpp.
+class MeasureTask;
+
 class AmoebotSystem : public System, public RandomNumberGenerator {
   friend class AmoebotParticle;
 
@@ -45,8 +63,8 @@ class AmoebotSystem : public System, public RandomNumberGenerator {
   unsigned int adsorptionRate;
   unsigned int desorptionRate;
 
-  // Deletes the particles, objects, and metrics in this system before
-  // destructing the system.
+  // Deletes the particles, objects, metrics, and analyses in this system
+  // before destructing the system.
   virtual ~AmoebotSystem();
 
   // Functions for activating a particle in the system. activate activates a
@@ -73,19 +91,45 @@ class AmoebotSystem : public System, public RandomNumberGenerator {
   void insert(AmoebotParticle* particle);
   void insert(Object* object);
 
+  // Inserts the given particles and objects all at once. Their nodes are
+  // entered into particleMap and objectMap in sorted order, so each insertion
+  // starts from a hint instead of searching from the root, and neighbor pairs
+  // among the new particles are counted together. Fails if any of the nodes
+  // are already occupied or occupied twice.
+  void insertAll(const std::vector<AmoebotParticle*>& newParticles,
+                 const std::vector<Object*>& newObjects = {});
+
   // Removes the specified particle from the system.
   void remove(AmoebotParticle* particle);
 
   // Functions for logging system progress. registerMovement logs the given
   // number of movements the system has made. registerActivation logs that the
-  // given particle has been activated. When all particles have been activated
-  // at least once, this resets its logging and triggers registerRound(), which
-  // commits all counts and measures to their histories and increments the
-  // number of completed asynchronous rounds by one.
+  // given particle has been activated, advances the simulated time, and
+  // records the measures scheduled by activations or time that are due. When
+  // all particles have been activated at least once, this resets its logging
+  // and triggers registerRound(), which commits all counts and the measures
+  // scheduled by rounds to their histories and increments the number of
+  // completed asynchronous rounds by one.
   void registerMovement(unsigned int numMoves = 1);
   void registerActivation(AmoebotParticle* particle);
   void registerRound();
 
+  // Functions for (un)registering an observer that is notified of every
+  // insertion, removal, movement, state or direction change, and round in this
+  // system (see systemobserver.h). The system does not take ownership of its
+  // observers.
+  void addObserver(SystemObserver* observer);
+  void removeObserver(SystemObserver* observer);
+
+  // Functions for the number of nearest neighbor pairs among the particles'
+  // tail nodes, where the tail node of a contracted particle is the node it
+  // occupies. enableNbrPairCount counts all such pairs once; from then on, the
+  // count is kept up to date on every insertion, removal, and movement, so
+  // numNbrPairs is O(1) at any time. Systems that never enable the count do
+  // not pay for maintaining it.
+  void enableNbrPairCount();
+  int numNbrPairs() const;
+
   // Various access functions for metrics (counts and measures). getCounts
   // (resp., getMeasures) returns a reference to the count (resp., measure)
   // list. getCount (resp., getMeasure) returns a reference to the named count
@@ -96,6 +140,151 @@ class AmoebotSystem : public System, public RandomNumberGenerator {
   Count& getCount(QString name) const final;
   Measure& getMeasure(QString name) const final;
 
+  // Sets the schedule by which the given measure is recorded (see metric.h).
+  // The interval counts rounds, activations, or units of simulated time,
+  // depending on the schedule, and is ignored for lazy measures. Time schedules
+  // start counting from the current simulated time. Fails if a non-lazy
+  // schedule has a non-positive interval, or a round or activation schedule
+  // has a non-integer one.
+  void setMeasureSchedule(Measure& measure, const Measure::Schedule schedule,
+                          const double interval);
+
+  // Functions for evaluating measures off the simulation thread. When parallel
+  // measures are enabled, every due measure that usesSnapshot() is calculated
+  // on a thread pool from a Snapshot taken when it became due, while the
+  // simulation continues. Results are appended to the measures' histories in
+  // the order they became due: flushMeasures appends all finished results (up
+  // to the first unfinished one), first waiting for every pending result if
+  // wait is true. Anything reading measure histories (e.g., an export) should
+  // flush with wait = true first. Disabling parallel measures flushes them.
+  void setParallelMeasures(const bool parallel);
+  void flushMeasures(const bool wait);
+
+  // Functions for streaming metrics to a file (see metricsstream.h). While a
+  // stream is open, every count and measure value is appended to it as it is
+  // recorded (parallel measures once their results are collected), so a final
+  // export only has to flush the stream. openMetricsStream replaces any open
+  // stream and returns false if the file cannot be opened. closeMetricsStream
+  // collects all pending measure results before closing the stream.
+  // flushMetricsStream does the same without closing it, returning false if no
+  // stream is open.
+  bool openMetricsStream(const QString filePath,
+                         const MetricsStream::Format format);
+  void closeMetricsStream();
+  bool flushMetricsStream();
+
+  // Functions for pushing metrics to a local process over a Unix domain
+  // datagram socket (see metricssocket.h). While a socket stream is open, the
+  // values recorded during each round are sent as one frame after the round,
+  // or dropped if the receiver is not keeping up. openMetricsSocket replaces
+  // any open socket stream and describes failures in error.
+  // closeMetricsSocket sends the pending measure results before closing.
+  bool openMetricsSocket(const QString socketPath, QString& error);
+  void closeMetricsSocket();
+
+  // Functions for stopping runs once their measures reach equilibrium (see
+  // convergencedetector.h). detectConvergence starts monitoring the values the
+  // given measures record from now on, replacing any previous detector; an
+  // empty list of measures stops the detection. hasConverged checks whether
+  // the monitored measures have converged, in which case equilibrationRound
+  // returns the round from which they were stationary (and -1 otherwise).
+  // Simulators treat convergence like termination (see simulator.h).
+  void detectConvergence(const std::vector<const Measure*>& measures,
+                         const unsigned int window,
+                         const double threshold);
+  bool hasConverged() const;
+  long long equilibrationRound() const;
+
+  // Functions for checkpointing the complete state of the system to a
+  // versioned binary file: its particles with their algorithm-specific memory
+  // (see AmoebotParticle::saveState), objects, counts, measures with their
+  // schedules, histories, and statistics, the simulated time, the progress of
+  // the current round, the order of freeSites, and the state of the random
+  // number generator. Restoring a checkpoint into a system of the same
+  // algorithm constructed with the same parameters continues the run exactly
+  // as the saved one continued. loadCheckpoint checks the whole file before
+  // changing anything and leaves the system unchanged if it fails; both
+  // functions describe failures in error. setCheckpointInterval saves a
+  // checkpoint to the given file after every rounds-th round, replacing the
+  // previous one atomically; 0 disables periodic checkpoints. Metrics streams
+  // and parallel measures are not checkpointed. Neither is convergence
+  // detection: restoring a checkpoint restarts the detector with the same
+  // measures, window size, and threshold, so convergence is only detected
+  // among the values recorded after the restored round.
+  bool saveCheckpoint(const QString filePath, QString& error);
+  bool loadCheckpoint(const QString filePath, QString& error);
+  void setCheckpointInterval(const QString filePath,
+                             const unsigned int rounds);
+
+  // Functions for recording the system's trajectory to a delta-encoded file
+  // that can be replayed from any recorded round (see trajectory.h).
+  // openTrajectory starts recording from the current configuration, replacing
+  // any recording in progress, and writes a keyframe every keyframeInterval
+  // rounds; it returns false if the file cannot be opened. closeTrajectory
+  // finishes the file with its index. Restoring a checkpoint closes the
+  // trajectory, since the recorded rounds would no longer be consecutive.
+  bool openTrajectory(const QString filePath,
+                      const unsigned int keyframeInterval);
+  void closeTrajectory();
+
+  // Functions for exporting the system's configuration as NumPy archives (see
+  // snapshotexporter.h). exportSnapshot writes the current configuration to the
+  // given file, describing failures in error. setSnapshotInterval exports the
+  // configuration after every rounds-th round to <pathPrefix>_<round>.npz; 0
+  // disables periodic exports.
+  bool exportSnapshot(const QString filePath, QString& error);
+  void setSnapshotInterval(const QString pathPrefix,
+                           const unsigned int rounds);
+
+  // Functions for publishing the system's state to a POSIX shared memory
+  // segment for external monitors (see telemetrypublisher.h). openTelemetry
+  // creates the segment with the given name, publishes the current state, and
+  // publishes again after every rounds-th round (never, if rounds is 0),
+  // replacing any segment published before; it describes failures in error.
+  // closeTelemetry marks the segment inactive and removes its name.
+  bool openTelemetry(const QString name, const unsigned int rounds,
+                     QString& error);
+  void closeTelemetry();
+
+  // Functions algorithms override to support checkpoints. supportsCheckpoints
+  // returns whether they do, which is false by default. restoreParticle
+  // returns a new particle of the algorithm at the given position with the
+  // given orientation; the system inserts it and then loads its memory from
+  // the checkpoint. clearParticles removes all particles at once, notifying
+  // observers as remove does; algorithms keeping structures over their
+  // particles outside of observers (e.g., compression's line tracker) clear
+  // them as well.
+  virtual bool supportsCheckpoints() const;
+  virtual AmoebotParticle* restoreParticle(const Node& head,
+                                           const int globalTailDir,
+                                           const int orientation);
+  virtual void clearParticles();
+
+  // Replaces the system's particles by those of the given layout (see
+  // latticelayout.h) and, if the layout has objects, its objects by the
+  // layout's, inserting them in bulk. On surfaces with a free site index (see
+  // freeSites), particles must lie on sites and objects must not. Counts,
+  // measures, and the simulated time are kept. Returns false and leaves the
+  // system unchanged if the layout does not fit the system or the algorithm.
+  bool loadLayout(const LatticeLayout& layout, QString& error);
+
+  // Functions algorithms override to support layouts. supportsLayouts returns
+  // whether they do, which is false by default. layoutParticle returns a new
+  // contracted particle of the algorithm at the given node with the species
+  // the given state code stands for, or nullptr if layouts cannot give
+  // particles that state.
+  virtual bool supportsLayouts() const;
+  virtual AmoebotParticle* layoutParticle(const Node& head, const int state);
+
+  // Returns a snapshot of the current configuration. Repeated calls between two
+  // activations share the same snapshot.
+  std::shared_ptr<const Snapshot> takeSnapshot();
+
+  // Returns the simulated time of this system. Under the asynchronous model,
+  // every particle is activated once per unit of time in expectation, so each
+  // activation advances the time by 1 / #particles.
+  double getTime() const;
+
   // Formats the count and measure histories as a JSON string. The structure of
   // this JSON string can be found in the Usage documentation.
   const QString metricsAsJSON() const final;
@@ -108,6 +297,117 @@ class AmoebotSystem : public System, public RandomNumberGenerator {
   std::map<Node, Object*> objectMap;
   std::vector<Count*> _counts;
   //std::vector<Measure*> _measures;
+  std::vector<Analysis*> _analyses;
+
+  // Optional index of the unoccupied nodes of a bounded surface. Systems that
+  // sample free nodes (e.g., for adsorption) set this up before inserting any
+  // particles; it is then kept current on every insertion, removal, and move.
+  std::unique_ptr<FreeSiteIndex> freeSites;
+
+  // The lattice this system lives on, the infinite plane unless the system
+  // makes it a torus (see lattice.h). Systems set it up before inserting any
+  // particles, which keep a copy of it.
+  Lattice lattice;
+
+ private:
+  // Functions for maintaining the nearest neighbor pair count. tailNbrCount
+  // returns the number of other particles whose tail nodes are adjacent to the
+  // given particle's tail node. untrackTail (resp., trackTail) removes (resp.,
+  // adds) these pairs from (resp., to) the count, if it is enabled; particles
+  // call them just before and just after changing their tail node.
+  int tailNbrCount(const AmoebotParticle* particle) const;
+  void untrackTail(const AmoebotParticle* particle);
+  void trackTail(const AmoebotParticle* particle);
+
+  bool _countNbrPairs;
+  int _numNbrPairs;
+  double _time;
+
+  // Calculates the given measure and appends its value to its history, either
+  // immediately or, for parallel measures, once its MeasureTask finishes.
+  void recordMeasure(Measure* measure);
+
+  bool _parallelMeasures;
+  QThreadPool _measurePool;
+  std::deque<MeasureTask*> _pendingMeasures;
+  std::shared_ptr<const Snapshot> _snapshot;
+  MetricsStream _metricsStream;
+  MetricsSocket _metricsSocket;
+  std::unique_ptr<ConvergenceDetector> _convergence;
+
+  // Saves a periodic checkpoint if one became due during the last activation.
+  // Checkpoints are taken between activations, never during one.
+  void checkpointIfDue();
+
+  QString _checkpointPath;
+  unsigned int _checkpointInterval;
+  bool _checkpointDue;
+
+  std::unique_ptr<TrajectoryRecorder> _trajectory;
+  std::unique_ptr<SnapshotExporter> _exporter;
+  std::unique_ptr<TelemetryPublisher> _telemetry;
+
+  // Functions for notifying the registered observers of an event; see
+  // systemobserver.h. These are inlined so that they cost only an emptiness
+  // check when there are no observers.
+  void notifyInsert(const AmoebotParticle* particle);
+  void notifyRemove(const AmoebotParticle* particle);
+  void notifyMove(const AmoebotParticle* particle, const Node& oldHead,
+                  const int oldTailDir);
+  void notifyStateChange(const AmoebotParticle* particle, const int oldState,
+                         const int newState);
+  void notifyDirectionChange(const AmoebotParticle* particle, const int oldDir,
+                             const int newDir);
+  void notifyRound(const unsigned int round);
+
+  std::vector<SystemObserver*> _observers;
+
+  // Functions for updating particleMap whenever a node changes occupancy.
+  // occupy places the given particle on the given node, while vacate frees the
+  // node. Both keep freeSites (if any) in sync with particleMap.
+  void occupy(const Node& node, AmoebotParticle* particle);
+  void vacate(const Node& node);
 };
 
+inline void AmoebotSystem::notifyInsert(const AmoebotParticle* particle) {
+  for (const auto o : _observers) {
+    o->onInsert(*particle);
+  }
+}
+
+inline void AmoebotSystem::notifyRemove(const AmoebotParticle* particle) {
+  for (const auto o : _observers) {
+    o->onRemove(*particle);
+  }
+}
+
+inline void AmoebotSystem::notifyMove(const AmoebotParticle* particle,
+                                      const Node& oldHead,
+                                      const int oldTailDir) {
+  for (const auto o : _observers) {
+    o->onMove(*particle, oldHead, oldTailDir);
+  }
+}
+
+inline void AmoebotSystem::notifyStateChange(const AmoebotParticle* particle,
+                                             const int oldState,
+                                             const int newState) {
+  for (const auto o : _observers) {
+    o->onStateChange(*particle, oldState, newState);
+  }
+}
+
+inline void AmoebotSystem::notifyDirectionChange(
+    const AmoebotParticle* particle, const int oldDir, const int newDir) {
+  for (const auto o : _observers) {
+    o->onDirectionChange(*particle, oldDir, newDir);
+  }
+}
+
+inline void AmoebotSystem::notifyRound(const unsigned int round) {
+  for (const auto o : _observers) {
+    o->onRound(round);
+  }
+}
+
 #endif  // AMOEBOTSIM_CORE_AMOEBOTSYSTEM_H_
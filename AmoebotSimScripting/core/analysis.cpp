@@ -0,0 +1,25 @@
+/* Copyright (C) 2021 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+#include "core/analysis.h"
+
+Analysis::Analysis()
+  : _current(false) {}
+
+Analysis::~Analysis() {}
+
+void Analysis::update() {
+  if (!_current) {
+    compute();
+    _current = true;
+  }
+}
+
+void Analysis::invalidate() {
+  _current = false;
+}
+
+bool Analysis::isCurrent() const {
+  return _current;
+}
@@ -0,0 +1,43 @@
+/* Copyright (C) 2021 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+// Defines derived data about a system's configuration that is shared among
+// several measures, such as the convex hull of its particles (see
+// hullmeasures.h). An analysis is computed lazily: events that may change it
+// invalidate it, and the first request afterwards recomputes it once for all
+// measures that depend on it. Systems own their analyses (see
+// AmoebotSystem::_analyses).
+
+#ifndef AMOEBOTSIM_CORE_ANALYSIS_H_
+#define AMOEBOTSIM_CORE_ANALYSIS_H_
+
+class Analysis {
+ public:
+  // Constructs a new analysis that has not been computed.
+  Analysis();
+  virtual ~Analysis();
+
+  // Recomputes the analysis if it has been invalidated since it was last
+  // computed.
+  void update();
+
+  // Forces the next update to recompute this analysis. Analyses call this when
+  // an event may have changed them; systems call it when they replace their
+  // configuration wholesale (e.g., when restoring a checkpoint).
+  void invalidate();
+
+ protected:
+  // Returns whether the analysis is up to date, i.e., has been computed and
+  // not invalidated since.
+  bool isCurrent() const;
+
+  // Recomputes the analysis' data from the system it analyzes. This is a pure
+  // virtual function and must be overridden by child classes.
+  virtual void compute() = 0;
+
+ private:
+  bool _current;
+};
+
+#endif  // AMOEBOTSIM_CORE_ANALYSIS_H_
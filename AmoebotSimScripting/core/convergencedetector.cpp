@@ -0,0 +1,125 @@
+/* Copyright (C) 2021 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+#include "core/convergencedetector.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <QtGlobal>
+
+#include "core/onlinestats.h"
+
+ConvergenceDetector::ConvergenceDetector(
+    const std::vector<const Measure*>& measures, const unsigned int window,
+    const double threshold)
+  : _window(window),
+    _threshold(threshold),
+    _converged(false),
+    _equilibrationRound(-1) {
+  Q_ASSERT(window >= 20);
+
+  for (const auto m : measures) {
+    _series.push_back({m, {}, 0.0});
+  }
+}
+
+void ConvergenceDetector::record(const Measure* measure, const double value,
+                                 const unsigned int round) {
+  if (_converged) {
+    return;
+  }
+
+  for (auto& s : _series) {
+    if (s.measure == measure) {
+      s.window.push_back({round, value});
+      if (s.window.size() > _window) {
+        s.window.pop_front();
+      }
+      if (s.window.size() == _window) {
+        s.z = geweke(s.window);
+      }
+      check();
+      return;
+    }
+  }
+}
+
+bool ConvergenceDetector::hasConverged() const {
+  return _converged;
+}
+
+long long ConvergenceDetector::equilibrationRound() const {
+  return _equilibrationRound;
+}
+
+double ConvergenceDetector::zScore(const Measure* measure) const {
+  for (const auto& s : _series) {
+    if (s.measure == measure) {
+      return s.z;
+    }
+  }
+
+  return 0.0;
+}
+
+std::vector<const Measure*> ConvergenceDetector::measures() const {
+  std::vector<const Measure*> result;
+  for (const auto& s : _series) {
+    result.push_back(s.measure);
+  }
+
+  return result;
+}
+
+unsigned int ConvergenceDetector::window() const {
+  return _window;
+}
+
+double ConvergenceDetector::threshold() const {
+  return _threshold;
+}
+
+double ConvergenceDetector::geweke(const Window& window) const {
+  // Summarize the first 10% and the last 50% of the window. The autocorrelation
+  // lag is bounded by the length of the shorter segment.
+  const unsigned int lengthA = window.size() / 10;
+  const unsigned int lengthB = window.size() / 2;
+  const unsigned int maxLag = std::max(1u, lengthA / 2);
+  OnlineStats a(1.0, maxLag), b(1.0, maxLag);
+  for (unsigned int i = 0; i < lengthA; ++i) {
+    a.push(window[i].second);
+  }
+  for (unsigned int i = window.size() - lengthB; i < window.size(); ++i) {
+    b.push(window[i].second);
+  }
+
+  const double diff = a.mean() - b.mean();
+  const double se = std::sqrt(a.variance() / a.effectiveSampleSize() +
+                              b.variance() / b.effectiveSampleSize());
+  if (se == 0) {
+    // Both segments are constant, so they agree exactly or not at all.
+    return (diff == 0) ? 0.0 : INFINITY;
+  }
+
+  return diff / se;
+}
+
+void ConvergenceDetector::check() {
+  long long start = -1;
+  for (const auto& s : _series) {
+    // A NaN z-score (e.g., from NaN values) fails every comparison, so it is
+    // ruled out explicitly rather than being taken as below the threshold.
+    if (s.window.size() < _window || !std::isfinite(s.z) ||
+        std::abs(s.z) >= _threshold) {
+      return;
+    }
+    start = std::max(start, static_cast<long long>(s.window.front().first));
+  }
+
+  if (!_series.empty()) {
+    _converged = true;
+    _equilibrationRound = start;
+  }
+}
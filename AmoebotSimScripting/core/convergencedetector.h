@@ -0,0 +1,80 @@
+/* Copyright (C) 2021 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+// Defines a detector that decides when a set of measures has reached
+// equilibrium, so that runs of algorithms that never terminate on their own
+// (e.g., compression) can be stopped once their measures have plateaued.
+//
+// For every monitored measure, the detector keeps a window of its most recently
+// recorded values and applies a Geweke-style diagnostic to it: the mean of the
+// first 10% of the window is compared to the mean of its last 50% by the
+// z-score (meanA - meanB) / sqrt(varA / essA + varB / essB), where the
+// effective sample sizes ess correct the variances of the means for
+// autocorrelation (see onlinestats.h). A measure is stationary if its window
+// is full and |z| is finite and below the threshold. The measures have
+// converged the first time they are all stationary at once; the equilibration
+// round is then the latest round at which one of their windows starts, since
+// each measure is stationary from its window's start onwards. Convergence is
+// final.
+
+#ifndef AMOEBOTSIM_CORE_CONVERGENCEDETECTOR_H_
+#define AMOEBOTSIM_CORE_CONVERGENCEDETECTOR_H_
+
+#include <deque>
+#include <utility>
+#include <vector>
+
+#include "core/metric.h"
+
+class ConvergenceDetector {
+ public:
+  // Constructs a detector monitoring the given measures with the given window
+  // size, which must be at least 20, and z-score threshold.
+  ConvergenceDetector(const std::vector<const Measure*>& measures,
+                      const unsigned int window = 200,
+                      const double threshold = 2.0);
+
+  // Records the given value of the given measure, recorded at the given round.
+  // Values of measures that are not monitored are ignored.
+  void record(const Measure* measure, const double value,
+              const unsigned int round);
+
+  // Functions for querying the detector. hasConverged checks whether the
+  // monitored measures have converged, in which case equilibrationRound returns
+  // the round from which they were stationary; otherwise, it returns -1.
+  // zScore returns the latest z-score of the given monitored measure's window,
+  // or 0 if its window is not full yet. measures, window, and threshold return
+  // the detector's configuration.
+  bool hasConverged() const;
+  long long equilibrationRound() const;
+  double zScore(const Measure* measure) const;
+  std::vector<const Measure*> measures() const;
+  unsigned int window() const;
+  double threshold() const;
+
+ private:
+  // A monitored measure's window of (round, value) pairs, oldest first, and the
+  // z-score of its latest full window.
+  using Window = std::deque<std::pair<unsigned int, double>>;
+  struct Series {
+    const Measure* measure;
+    Window window;
+    double z;
+  };
+
+  // Returns the Geweke z-score of the given full window.
+  double geweke(const Window& window) const;
+
+  // Checks whether all series are stationary and, if so, marks the detector as
+  // converged.
+  void check();
+
+  const unsigned int _window;
+  const double _threshold;
+  std::vector<Series> _series;
+  bool _converged;
+  long long _equilibrationRound;
+};
+
+#endif  // AMOEBOTSIM_CORE_CONVERGENCEDETECTOR_H_
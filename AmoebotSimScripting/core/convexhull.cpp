@@ -0,0 +1,156 @@
+/* Copyright (C) 2021 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+#include "core/convexhull.h"
+
+#include <algorithm>
+#include <cmath>
+
+ConvexHull::ConvexHull(std::vector<Node> nodes) {
+  // Sort the nodes lexicographically by (x,y), remove duplicates, and build the
+  // lower and upper hulls, dropping nodes that do not make a left turn.
+  std::sort(nodes.begin(), nodes.end(), [](const Node& a, const Node& b) {
+    return a.x < b.x || (a.x == b.x && a.y < b.y);
+  });
+  nodes.erase(std::unique(nodes.begin(), nodes.end()), nodes.end());
+  if (nodes.size() < 3) {
+    _vertices = nodes;
+    return;
+  }
+
+  std::vector<Node> hull(2 * nodes.size());
+  size_t k = 0;
+  for (size_t i = 0; i < nodes.size(); ++i) {
+    while (k >= 2 && cross(hull[k - 2], hull[k - 1], nodes[i]) <= 0) {
+      --k;
+    }
+    hull[k++] = nodes[i];
+  }
+  for (size_t i = nodes.size() - 1, lower = k + 1; i > 0; --i) {
+    while (k >= lower && cross(hull[k - 2], hull[k - 1], nodes[i - 1]) <= 0) {
+      --k;
+    }
+    hull[k++] = nodes[i - 1];
+  }
+  hull.resize(k - 1);  // The last node is the first one again.
+  _vertices = hull;
+}
+
+const std::vector<Node>& ConvexHull::vertices() const {
+  return _vertices;
+}
+
+bool ConvexHull::isVertex(const Node& node) const {
+  return std::find(_vertices.begin(), _vertices.end(), node) != _vertices.end();
+}
+
+bool ConvexHull::contains(const Node& node) const {
+  const size_t h = _vertices.size();
+  if (h == 0) {
+    return false;
+  } else if (h == 1) {
+    return node == _vertices[0];
+  } else if (h == 2) {
+    const Node& a = _vertices[0];
+    const Node& b = _vertices[1];
+    return cross(a, b, node) == 0 &&
+           std::min(a.x, b.x) <= node.x && node.x <= std::max(a.x, b.x) &&
+           std::min(a.y, b.y) <= node.y && node.y <= std::max(a.y, b.y);
+  }
+
+  for (size_t i = 0; i < h; ++i) {
+    if (cross(_vertices[i], _vertices[(i + 1) % h], node) < 0) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+double ConvexHull::diameter() const {
+  const size_t h = _vertices.size();
+  if (h < 3) {
+    return (h == 2) ? std::sqrt(squaredDistance(_vertices[0], _vertices[1]))
+                    : 0.0;
+  }
+
+  // For each edge (i,i+1), advance j to the vertex farthest from the edge; the
+  // pairs visited this way include all antipodal pairs.
+  long long best = 0;
+  for (size_t i = 0, j = 1; i < h; ++i) {
+    const Node& a = _vertices[i];
+    const Node& b = _vertices[(i + 1) % h];
+    while (cross(a, b, _vertices[(j + 1) % h]) > cross(a, b, _vertices[j])) {
+      j = (j + 1) % h;
+    }
+    best = std::max({best, squaredDistance(a, _vertices[j]),
+                     squaredDistance(b, _vertices[j])});
+  }
+
+  return std::sqrt(best);
+}
+
+double ConvexHull::minWidth() const {
+  const size_t h = _vertices.size();
+  if (h < 3) {
+    return 0.0;
+  }
+
+  // The minimum width is attained with one line through a hull edge. The
+  // distance of the farthest vertex from that edge is the Cartesian area of
+  // their parallelogram (the lattice one scaled by sqrt(3)/2) over the edge's
+  // Cartesian length.
+  double best = INFINITY;
+  for (size_t i = 0, j = 1; i < h; ++i) {
+    const Node& a = _vertices[i];
+    const Node& b = _vertices[(i + 1) % h];
+    while (cross(a, b, _vertices[(j + 1) % h]) > cross(a, b, _vertices[j])) {
+      j = (j + 1) % h;
+    }
+    best = std::min(best, std::sqrt(3.0) / 2 * cross(a, b, _vertices[j]) /
+                          std::sqrt(squaredDistance(a, b)));
+  }
+
+  return best;
+}
+
+double ConvexHull::extentX() const {
+  if (_vertices.empty()) {
+    return 0.0;
+  }
+
+  double minX = INFINITY, maxX = -INFINITY;
+  for (const auto& v : _vertices) {
+    minX = std::min(minX, v.x + v.y / 2.0);
+    maxX = std::max(maxX, v.x + v.y / 2.0);
+  }
+
+  return maxX - minX;
+}
+
+double ConvexHull::extentY() const {
+  if (_vertices.empty()) {
+    return 0.0;
+  }
+
+  int minY = _vertices[0].y, maxY = _vertices[0].y;
+  for (const auto& v : _vertices) {
+    minY = std::min(minY, v.y);
+    maxY = std::max(maxY, v.y);
+  }
+
+  return std::sqrt(3.0) / 2 * (maxY - minY);
+}
+
+long long ConvexHull::cross(const Node& a, const Node& b, const Node& c) {
+  return static_cast<long long>(b.x - a.x) * (c.y - a.y) -
+         static_cast<long long>(b.y - a.y) * (c.x - a.x);
+}
+
+long long ConvexHull::squaredDistance(const Node& a, const Node& b) {
+  // (dx + dy/2)^2 + (sqrt(3)/2 dy)^2 = dx^2 + dx dy + dy^2.
+  const long long dx = b.x - a.x;
+  const long long dy = b.y - a.y;
+  return dx * dx + dx * dy + dy * dy;
+}
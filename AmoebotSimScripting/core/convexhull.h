@@ -0,0 +1,59 @@
+/* Copyright (C) 2021 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+// Defines the convex hull of a set of lattice nodes and the extents of the set
+// that can be read off it. Convexity and parallelism are preserved by the
+// linear map from triangular lattice coordinates (x,y) to Cartesian coordinates
+// (x + y/2, (sqrt(3)/2) y), so the hull and its antipodal pairs are computed
+// exactly in integer lattice coordinates and only the final distances are
+// taken in the Cartesian plane. Building the hull takes O(n log n) time for n
+// nodes; all queries take time linear in the number of hull vertices, which is
+// much smaller than n for lattice configurations.
+
+#ifndef AMOEBOTSIM_CORE_CONVEXHULL_H_
+#define AMOEBOTSIM_CORE_CONVEXHULL_H_
+
+#include <vector>
+
+#include "core/node.h"
+
+class ConvexHull {
+ public:
+  // Constructs the convex hull of the given nodes using Andrew's monotone chain
+  // algorithm. The nodes need not be distinct.
+  ConvexHull(std::vector<Node> nodes = {});
+
+  // Returns the hull's vertices in counter-clockwise order. Nodes lying on the
+  // hull's boundary between two vertices are not vertices themselves.
+  const std::vector<Node>& vertices() const;
+
+  // Functions for querying the hull. isVertex checks whether the given node is
+  // a vertex of the hull, and contains whether it lies inside the hull or on
+  // its boundary.
+  bool isVertex(const Node& node) const;
+  bool contains(const Node& node) const;
+
+  // Functions for the extents of the nodes in the Cartesian plane, all 0 for
+  // fewer than two distinct nodes. diameter returns the largest distance
+  // between two nodes and minWidth the smallest distance between two parallel
+  // lines enclosing all nodes, both using rotating calipers. extentX (resp.,
+  // extentY) returns the width (resp., height) of the nodes' axis-aligned
+  // bounding box.
+  double diameter() const;
+  double minWidth() const;
+  double extentX() const;
+  double extentY() const;
+
+ private:
+  // Returns twice the signed area of the triangle (a,b,c) in lattice
+  // coordinates, which is positive iff c lies to the left of the line ab.
+  static long long cross(const Node& a, const Node& b, const Node& c);
+
+  // Returns the squared Cartesian distance between the given nodes.
+  static long long squaredDistance(const Node& a, const Node& b);
+
+  std::vector<Node> _vertices;
+};
+
+#endif  // AMOEBOTSIM_CORE_CONVEXHULL_H_
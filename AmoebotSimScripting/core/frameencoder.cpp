@@ -0,0 +1,101 @@
+/* Copyright (C) 2021 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+#include "core/frameencoder.h"
+
+#include <QRunnable>
+#include <QThread>
+
+namespace {
+
+class EncodeTask : public QRunnable {
+ public:
+  EncodeTask(const QImage& image, const QString filePath, QSemaphore& pending,
+             std::atomic<int>& failures)
+    : image(image),
+      filePath(filePath),
+      pending(pending),
+      failures(failures) {}
+
+  void run() override {
+    if (!image.save(filePath)) {
+      ++failures;
+    }
+    pending.release();
+  }
+
+  const QImage image;
+  const QString filePath;
+  QSemaphore& pending;
+  std::atomic<int>& failures;
+};
+
+class StreamTask : public QRunnable {
+ public:
+  StreamTask(const QImage& image, QFile& file, QSemaphore& pending,
+             std::atomic<int>& failures)
+    : image(image.convertToFormat(QImage::Format_RGBA8888)),
+      file(file),
+      pending(pending),
+      failures(failures) {}
+
+  void run() override {
+    const qint64 rowSize = 4 * image.width();
+    for (int y = 0; y < image.height(); ++y) {
+      const char* row = reinterpret_cast<const char*>(image.constScanLine(y));
+      if (file.write(row, rowSize) != rowSize) {
+        ++failures;
+        break;
+      }
+    }
+    pending.release();
+  }
+
+  const QImage image;
+  QFile& file;
+  QSemaphore& pending;
+  std::atomic<int>& failures;
+};
+
+}  // namespace
+
+FrameEncoder::FrameEncoder(const int maxPending)
+  : _slots((maxPending > 0) ? maxPending : 2 * QThread::idealThreadCount()),
+    _failures(0) {
+  // Streamed frames are written by a single thread, which keeps their order.
+  _streamPool.setMaxThreadCount(1);
+}
+
+FrameEncoder::~FrameEncoder() {
+  _pool.waitForDone();
+  closeStream();
+}
+
+void FrameEncoder::encode(const QImage& image, const QString filePath) {
+  _slots.acquire();
+  _pool.start(new EncodeTask(image, filePath, _slots, _failures));
+}
+
+bool FrameEncoder::openStream(const QString filePath) {
+  closeStream();
+  _streamFile.setFileName(filePath);
+  return _streamFile.open(QIODevice::WriteOnly);
+}
+
+void FrameEncoder::stream(const QImage& image) {
+  Q_ASSERT(_streamFile.isOpen());
+  _slots.acquire();
+  _streamPool.start(new StreamTask(image, _streamFile, _slots, _failures));
+}
+
+void FrameEncoder::closeStream() {
+  _streamPool.waitForDone();
+  _streamFile.close();
+}
+
+int FrameEncoder::waitForDone() {
+  _pool.waitForDone();
+  _streamPool.waitForDone();
+  return _failures.exchange(0);
+}
@@ -0,0 +1,58 @@
+/* Copyright (C) 2021 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+// Defines an encoder that saves the frames of a movie as image files on a
+// thread pool, so that rendering the next frame overlaps with compressing the
+// previous ones. Frames are handed over as implicitly shared QImages and are
+// encoded in the format given by their file suffix (e.g., .png). Alternatively,
+// frames can be streamed as raw RGBA pixels into a single file, such as a
+// named pipe read by a video encoder, which a background thread writes in
+// order. To bound the memory held by frames waiting to be written, encode and
+// stream block while a fixed number of frames is pending.
+
+#ifndef AMOEBOTSIM_CORE_FRAMEENCODER_H_
+#define AMOEBOTSIM_CORE_FRAMEENCODER_H_
+
+#include <atomic>
+
+#include <QFile>
+#include <QImage>
+#include <QSemaphore>
+#include <QString>
+#include <QThreadPool>
+
+class FrameEncoder {
+ public:
+  // Constructs an encoder that keeps at most maxPending frames waiting; 0 uses
+  // twice the number of available cores.
+  explicit FrameEncoder(const int maxPending = 0);
+
+  // Waits for all pending frames to be encoded.
+  ~FrameEncoder();
+
+  // Saves the given image to the file at the given path in the background.
+  void encode(const QImage& image, const QString filePath);
+
+  // Functions for streaming frames. openStream opens the file at the given
+  // path for writing, returning false if it cannot be opened. stream appends
+  // the raw pixels of the given image to it, row by row from the top, with
+  // four bytes per pixel in the order red, green, blue, alpha. closeStream
+  // waits for all streamed frames to be written and closes the file.
+  bool openStream(const QString filePath);
+  void stream(const QImage& image);
+  void closeStream();
+
+  // Waits for all pending frames to be encoded and returns the number of
+  // frames that could not be saved or streamed since the last call.
+  int waitForDone();
+
+ private:
+  QThreadPool _pool;
+  QThreadPool _streamPool;
+  QFile _streamFile;
+  QSemaphore _slots;
+  std::atomic<int> _failures;
+};
+
+#endif  // AMOEBOTSIM_CORE_FRAMEENCODER_H_
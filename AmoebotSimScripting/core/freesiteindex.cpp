@@ -0,0 +1,119 @@
+/* Copyright (C) 2021 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+#include "core/freesiteindex.h"
+
+#include <QtGlobal>
+
+// The position map values are bound to references (e.g., by std::vector's
+// constructor), so C++11 needs their definitions.
+constexpr int FreeSiteIndex::notASite;
+constexpr int FreeSiteIndex::occupied;
+
+FreeSiteIndex::FreeSiteIndex(int minX, int minY, int maxX, int maxY)
+  : _minX(minX),
+    _minY(minY),
+    _width(maxX - minX + 1),
+    _height(maxY - minY + 1),
+    _numSites(0),
+    _positions(_width * _height, notASite) {
+  Q_ASSERT(minX <= maxX && minY <= maxY);
+}
+
+void FreeSiteIndex::addSite(const Node& node) {
+  const int s = slot(node);
+  Q_ASSERT(s != -1);
+
+  if (_positions[s] == notASite) {
+    _positions[s] = occupied;
+    ++_numSites;
+    markFree(node);
+  }
+}
+
+void FreeSiteIndex::markFree(const Node& node) {
+  const int s = slot(node);
+  if (s != -1 && _positions[s] == occupied) {
+    _positions[s] = _free.size();
+    _free.push_back(node);
+  }
+}
+
+void FreeSiteIndex::markOccupied(const Node& node) {
+  const int s = slot(node);
+  if (s == -1 || _positions[s] < 0) {
+    return;
+  }
+
+  // Swap the last free site into the vacated position before popping it.
+  const int i = _positions[s];
+  const Node last = _free.back();
+  _free[i] = last;
+  _positions[slot(last)] = i;
+  _free.pop_back();
+  _positions[s] = occupied;
+}
+
+bool FreeSiteIndex::isSite(const Node& node) const {
+  const int s = slot(node);
+  return s != -1 && _positions[s] != notASite;
+}
+
+bool FreeSiteIndex::isFree(const Node& node) const {
+  const int s = slot(node);
+  return s != -1 && _positions[s] >= 0;
+}
+
+unsigned int FreeSiteIndex::numSites() const {
+  return _numSites;
+}
+
+unsigned int FreeSiteIndex::size() const {
+  return _free.size();
+}
+
+bool FreeSiteIndex::empty() const {
+  return _free.empty();
+}
+
+const Node& FreeSiteIndex::at(unsigned int i) const {
+  Q_ASSERT(i < _free.size());
+
+  return _free[i];
+}
+
+const std::vector<Node>& FreeSiteIndex::freeSites() const {
+  return _free;
+}
+
+bool FreeSiteIndex::setOrder(const std::vector<Node>& order) {
+  if (order.size() != _free.size()) {
+    return false;
+  }
+  std::vector<bool> listed(_positions.size(), false);
+  for (const auto& node : order) {
+    const int s = slot(node);
+    if (s == -1 || _positions[s] < 0 || listed[s]) {
+      return false;
+    }
+    listed[s] = true;
+  }
+
+  _free = order;
+  for (unsigned int i = 0; i < _free.size(); ++i) {
+    _positions[slot(_free[i])] = i;
+  }
+
+  return true;
+}
+
+int FreeSiteIndex::slot(const Node& node) const {
+  const int dx = node.x - _minX;
+  const int dy = node.y - _minY;
+  if (dx < 0 || dx >= _width || dy < 0 || dy >= _height) {
+    return -1;
+  }
+
+  return dx * _height + dy;
+}
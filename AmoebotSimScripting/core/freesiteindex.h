@@ -0,0 +1,73 @@
+/* Copyright (C) 2021 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+// Defines an index over a fixed set of lattice nodes ("sites") that tracks
+// which of them are currently unoccupied. Free sites are kept in a dense array
+// with a per-node position map, so marking a site free or occupied and drawing
+// a uniformly random free site all take O(1) time.
+
+#ifndef AMOEBOTSIM_CORE_FREESITEINDEX_H_
+#define AMOEBOTSIM_CORE_FREESITEINDEX_H_
+
+#include <vector>
+
+#include "core/node.h"
+
+class FreeSiteIndex {
+ public:
+  // Constructs an empty index that can hold any node (x,y) with
+  // minX <= x <= maxX and minY <= y <= maxY. Nodes must be registered as sites
+  // with addSite() before they are tracked.
+  FreeSiteIndex(int minX, int minY, int maxX, int maxY);
+
+  // Registers the given node as a site, initially free. Fails if the node lies
+  // outside the bounds given at construction.
+  void addSite(const Node& node);
+
+  // Functions for updating a site's occupancy. markFree (resp., markOccupied)
+  // adds (resp., removes) the given site to (resp., from) the set of free
+  // sites. Both are no-ops for nodes that are not sites or that are already in
+  // the requested state, so they can be called for arbitrary nodes.
+  void markFree(const Node& node);
+  void markOccupied(const Node& node);
+
+  // Functions for querying the index. isSite checks whether the node was
+  // registered as a site, isFree whether it is a currently unoccupied site.
+  // numSites returns the number of registered sites and size the number of
+  // free ones. at returns the free site stored at the given index in
+  // [0, size()); combined with a random index this samples free sites
+  // uniformly. The order of free sites changes whenever the index is updated.
+  bool isSite(const Node& node) const;
+  bool isFree(const Node& node) const;
+  unsigned int numSites() const;
+  unsigned int size() const;
+  bool empty() const;
+  const Node& at(unsigned int i) const;
+
+  // Functions for the order of the free sites. freeSites returns them in index
+  // order, and setOrder rearranges them into the given order, which must list
+  // exactly the currently free sites. Restoring a checkpoint (see
+  // amoebotsystem.h) uses these to sample the same free sites as the original
+  // run. setOrder returns false and leaves the order unchanged if the given
+  // nodes are not a permutation of the free sites.
+  const std::vector<Node>& freeSites() const;
+  bool setOrder(const std::vector<Node>& order);
+
+ private:
+  // Returns the slot of the given node in the position map, or -1 if the node
+  // lies outside the index's bounds.
+  int slot(const Node& node) const;
+
+  // Special position map values for nodes that are not sites or are occupied
+  // sites, respectively; free sites map to their index in the free array.
+  static constexpr int notASite = -2;
+  static constexpr int occupied = -1;
+
+  const int _minX, _minY, _width, _height;
+  unsigned int _numSites;
+  std::vector<Node> _free;
+  std::vector<int> _positions;
+};
+
+#endif  // AMOEBOTSIM_CORE_FREESITEINDEX_H_
@@ -0,0 +1,468 @@
+/* Copyright (C) 2021 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+// Defines the history of a metric, i.e., the sequence of values it recorded
+// over time, under a policy bounding the memory it uses:
+// - Unbounded keeps every value in memory (the default).
+// - Ring keeps only the most recent values, up to a fixed capacity.
+// - Downsampled keeps a multi-resolution pyramid. Level 0 holds up to capacity
+//   raw values; whenever a level overflows, its two oldest entries are merged
+//   into one entry summarizing their min, mean, and max and passed up to the
+//   next level. Recent values thus stay exact while older ones are kept at
+//   exponentially coarser resolution, using O(capacity * log(#values)) memory.
+// - Spill appends every value to a binary file on disk and keeps only the
+//   latest value in memory.
+
+#ifndef AMOEBOTSIM_CORE_HISTORY_H_
+#define AMOEBOTSIM_CORE_HISTORY_H_
+
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include <QDataStream>
+#include <QFile>
+#include <QString>
+#include <QtGlobal>
+
+template<class T>
+class History {
+ public:
+  enum class Policy {
+    Unbounded,
+    Ring,
+    Downsampled,
+    Spill
+  };
+
+  // A summary of count consecutive values, used by the Downsampled policy.
+  struct Summary {
+    T min;
+    T max;
+    double sum;
+    unsigned long long count;
+
+    double mean() const { return sum / count; }
+  };
+
+  // Constructs an empty, unbounded history.
+  History();
+
+  // Functions for changing the history's policy. The values recorded so far
+  // are carried over as far as the new policy allows. setRing and
+  // setDownsampled take the number of values (resp., entries per level) to
+  // keep, which must be at least 1 (resp., 2). setSpill appends values to the
+  // file at the given path, replacing its contents; it returns false and
+  // leaves the policy unchanged if the file cannot be opened.
+  void setUnbounded();
+  void setRing(const unsigned int capacity);
+  void setDownsampled(const unsigned int capacity);
+  bool setSpill(const QString filePath);
+  Policy policy() const;
+
+  // Records the given value.
+  void push_back(const T value);
+
+  // Functions for querying the history. empty checks whether any value has
+  // been recorded and back returns the latest one. total returns the number of
+  // values ever recorded, while size returns the number of entries values()
+  // returns under the current policy.
+  bool empty() const;
+  T back() const;
+  unsigned long long total() const;
+  unsigned long long size() const;
+
+  // Returns the retained values from oldest to newest. Downsampled entries are
+  // represented by their means (see summaries()), and spilled values are read
+  // back from disk. The second form returns only the count values starting at
+  // the given index, reading no more than those from disk, so that long
+  // histories can be processed in blocks; the range must lie within size().
+  std::vector<T> values() const;
+  std::vector<T> values(const unsigned long long first,
+                        const unsigned long long count) const;
+
+  // Returns the retained values as summaries from oldest to newest. Under the
+  // Downsampled policy these are the pyramid's entries; under all others, each
+  // value is its own summary.
+  std::vector<Summary> summaries() const;
+
+  // Functions for checkpointing the history (see amoebotsystem.h). save writes
+  // the policy, its parameters, and the retained entries to the given stream.
+  // load replaces this history by one written by save. It returns false and
+  // leaves this history unchanged if the stream is malformed or, for a spilled
+  // history, the file is not writable or no longer holds the saved values; it
+  // does not modify the file. Once the loaded history has taken the place of
+  // the one writing to the file (if any), reopen truncates the file to the
+  // values recorded up to the save and continues spilling to it; it does
+  // nothing under the other policies. If the file cannot be reopened after
+  // all, later values are lost like those of any failed spill write.
+  void save(QDataStream& out) const;
+  bool load(QDataStream& in);
+  void reopen();
+
+  // Returns the name of the given policy as used in scripts and metrics
+  // exports ("unbounded", "ring", "downsampled", or "spill").
+  static QString policyName(const Policy policy);
+
+ private:
+  // Removes all values, keeping the current policy and its parameters.
+  void reset();
+
+  // Merges the oldest entries of the given pyramid level into the next level
+  // until the level no longer overflows, cascading upwards.
+  void compact(unsigned int level);
+
+  Policy _policy;
+  unsigned int _capacity;
+  unsigned long long _total;
+  T _last;
+
+  // Storage for the Unbounded and Ring policies, the Downsampled pyramid
+  // (level 0 holds the newest entries), and the Spill file, respectively.
+  std::deque<T> _values;
+  std::vector<std::deque<Summary>> _levels;
+  std::unique_ptr<QFile> _file;
+};
+
+template<class T>
+History<T>::History()
+  : _policy(Policy::Unbounded),
+    _capacity(0),
+    _total(0),
+    _last() {}
+
+template<class T>
+void History<T>::setUnbounded() {
+  const std::vector<T> old = values();
+  _policy = Policy::Unbounded;
+  reset();
+  for (const T value : old) {
+    push_back(value);
+  }
+}
+
+template<class T>
+void History<T>::setRing(const unsigned int capacity) {
+  Q_ASSERT(capacity >= 1);
+
+  const std::vector<T> old = values();
+  _policy = Policy::Ring;
+  _capacity = capacity;
+  reset();
+  for (const T value : old) {
+    push_back(value);
+  }
+}
+
+template<class T>
+void History<T>::setDownsampled(const unsigned int capacity) {
+  Q_ASSERT(capacity >= 2);
+
+  const std::vector<Summary> old = summaries();
+  _policy = Policy::Downsampled;
+  _capacity = capacity;
+  reset();
+
+  // Existing summaries keep their resolution: they enter the pyramid as-is and
+  // are merged further only if the new capacity requires it.
+  for (const Summary& s : old) {
+    _levels[0].push_back(s);
+    _total += s.count;
+    compact(0);
+  }
+}
+
+template<class T>
+bool History<T>::setSpill(const QString filePath) {
+  // Read the old values first in case they are spilled to the same file.
+  const std::vector<T> old = values();
+  std::unique_ptr<QFile> file(new QFile(filePath));
+  if (!file->open(QIODevice::ReadWrite | QIODevice::Truncate)) {
+    return false;
+  }
+
+  _policy = Policy::Spill;
+  reset();
+  _file = std::move(file);
+  for (const T value : old) {
+    push_back(value);
+  }
+
+  return true;
+}
+
+template<class T>
+typename History<T>::Policy History<T>::policy() const {
+  return _policy;
+}
+
+template<class T>
+void History<T>::push_back(const T value) {
+  _last = value;
+  ++_total;
+
+  switch (_policy) {
+    case Policy::Unbounded:
+      _values.push_back(value);
+      break;
+    case Policy::Ring:
+      _values.push_back(value);
+      if (_values.size() > _capacity) {
+        _values.pop_front();
+      }
+      break;
+    case Policy::Downsampled:
+      _levels[0].push_back({value, value, static_cast<double>(value), 1});
+      compact(0);
+      break;
+    case Policy::Spill:
+      _file->write(reinterpret_cast<const char*>(&value), sizeof(T));
+      break;
+  }
+}
+
+template<class T>
+bool History<T>::empty() const {
+  return _total == 0;
+}
+
+template<class T>
+T History<T>::back() const {
+  Q_ASSERT(!empty());
+
+  return _last;
+}
+
+template<class T>
+unsigned long long History<T>::total() const {
+  return _total;
+}
+
+template<class T>
+unsigned long long History<T>::size() const {
+  switch (_policy) {
+    case Policy::Unbounded:
+    case Policy::Ring:
+      return _values.size();
+    case Policy::Downsampled: {
+      unsigned long long numEntries = 0;
+      for (const auto& level : _levels) {
+        numEntries += level.size();
+      }
+      return numEntries;
+    }
+    case Policy::Spill:
+      return _total;
+  }
+
+  return 0;
+}
+
+template<class T>
+std::vector<T> History<T>::values() const {
+  return values(0, size());
+}
+
+template<class T>
+std::vector<T> History<T>::values(const unsigned long long first,
+                                  const unsigned long long count) const {
+  Q_ASSERT(first + count <= size());
+
+  std::vector<T> result;
+  if (_policy == Policy::Downsampled) {
+    // Entries are numbered from the oldest, i.e., from the top level down.
+    unsigned long long skip = first;
+    for (auto level = _levels.rbegin();
+         level != _levels.rend() && result.size() < count; ++level) {
+      if (skip >= level->size()) {
+        skip -= level->size();
+        continue;
+      }
+      for (auto s = level->begin() + skip;
+           s != level->end() && result.size() < count; ++s) {
+        result.push_back(static_cast<T>(s->mean()));
+      }
+      skip = 0;
+    }
+  } else if (_policy == Policy::Spill) {
+    _file->flush();
+    QFile in(_file->fileName());
+    if (in.open(QIODevice::ReadOnly) && in.seek(first * sizeof(T))) {
+      result.resize(count);
+      const qint64 numBytes = in.read(reinterpret_cast<char*>(result.data()),
+                                      count * sizeof(T));
+      result.resize(std::max<qint64>(numBytes, 0) / sizeof(T));
+    }
+  } else {
+    result.assign(_values.begin() + first, _values.begin() + first + count);
+  }
+
+  return result;
+}
+
+template<class T>
+std::vector<typename History<T>::Summary> History<T>::summaries() const {
+  std::vector<Summary> result;
+  if (_policy == Policy::Downsampled) {
+    for (auto level = _levels.rbegin(); level != _levels.rend(); ++level) {
+      result.insert(result.end(), level->begin(), level->end());
+    }
+  } else {
+    for (const T value : values()) {
+      result.push_back({value, value, static_cast<double>(value), 1});
+    }
+  }
+
+  return result;
+}
+
+template<class T>
+void History<T>::save(QDataStream& out) const {
+  out << static_cast<quint8>(_policy) << static_cast<quint32>(_capacity)
+      << static_cast<quint64>(_total) << _last;
+  switch (_policy) {
+    case Policy::Unbounded:
+    case Policy::Ring:
+      out << static_cast<quint64>(_values.size());
+      for (const T value : _values) {
+        out << value;
+      }
+      break;
+    case Policy::Downsampled:
+      out << static_cast<quint32>(_levels.size());
+      for (const auto& level : _levels) {
+        out << static_cast<quint64>(level.size());
+        for (const Summary& s : level) {
+          out << s.min << s.max << s.sum << static_cast<quint64>(s.count);
+        }
+      }
+      break;
+    case Policy::Spill:
+      _file->flush();
+      out << _file->fileName();
+      break;
+  }
+}
+
+template<class T>
+bool History<T>::load(QDataStream& in) {
+  quint8 policy;
+  quint32 capacity;
+  quint64 total;
+  History<T> loaded;
+  in >> policy >> capacity >> total >> loaded._last;
+  if (in.status() != QDataStream::Ok || policy > 3) {
+    return false;
+  }
+  loaded._policy = static_cast<Policy>(policy);
+  loaded._capacity = capacity;
+  loaded._total = total;
+
+  if (loaded._policy == Policy::Unbounded || loaded._policy == Policy::Ring) {
+    quint64 numValues;
+    in >> numValues;
+    for (quint64 i = 0; i < numValues && in.status() == QDataStream::Ok; ++i) {
+      T value;
+      in >> value;
+      loaded._values.push_back(value);
+    }
+  } else if (loaded._policy == Policy::Downsampled) {
+    quint32 numLevels;
+    in >> numLevels;
+    if (numLevels == 0 || capacity < 2) {
+      return false;
+    }
+    loaded._levels.resize(numLevels);
+    for (auto& level : loaded._levels) {
+      quint64 numEntries;
+      in >> numEntries;
+      for (quint64 i = 0; i < numEntries && in.status() == QDataStream::Ok;
+           ++i) {
+        Summary s;
+        quint64 count;
+        in >> s.min >> s.max >> s.sum >> count;
+        s.count = count;
+        level.push_back(s);
+      }
+    }
+  } else {
+    QString filePath;
+    in >> filePath;
+    if (in.status() != QDataStream::Ok) {
+      return false;
+    }
+
+    // The file may still be written by this or another history, so it is
+    // only checked here and truncated by reopen.
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadWrite) ||
+        file.size() < static_cast<qint64>(total * sizeof(T))) {
+      return false;
+    }
+    file.close();
+    loaded._file.reset(new QFile(filePath));
+  }
+
+  if (in.status() != QDataStream::Ok) {
+    return false;
+  }
+  *this = std::move(loaded);
+
+  return true;
+}
+
+template<class T>
+void History<T>::reopen() {
+  if (_policy != Policy::Spill) {
+    return;
+  }
+
+  // Values spilled to the file since the save are discarded.
+  _file->close();
+  const qint64 numBytes = _total * sizeof(T);
+  if (_file->open(QIODevice::ReadWrite)) {
+    _file->resize(numBytes);
+    _file->seek(numBytes);
+  }
+}
+
+template<class T>
+QString History<T>::policyName(const Policy policy) {
+  switch (policy) {
+    case Policy::Unbounded:   return "unbounded";
+    case Policy::Ring:        return "ring";
+    case Policy::Downsampled: return "downsampled";
+    case Policy::Spill:       return "spill";
+  }
+
+  return "";
+}
+
+template<class T>
+void History<T>::reset() {
+  _total = 0;
+  _values.clear();
+  _levels.assign(_policy == Policy::Downsampled ? 1 : 0, {});
+  _file.reset();
+}
+
+template<class T>
+void History<T>::compact(unsigned int level) {
+  while (_levels[level].size() > _capacity) {
+    const Summary a = _levels[level].front();
+    _levels[level].pop_front();
+    const Summary b = _levels[level].front();
+    _levels[level].pop_front();
+
+    if (level + 1 == _levels.size()) {
+      _levels.push_back({});
+    }
+    _levels[level + 1].push_back({std::min(a.min, b.min), std::max(a.max, b.max),
+                                  a.sum + b.sum, a.count + b.count});
+    compact(level + 1);
+  }
+}
+
+#endif  // AMOEBOTSIM_CORE_HISTORY_H_
@@ -0,0 +1,93 @@
+/* Copyright (C) 2021 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+#include "core/hullmeasures.h"
+
+#include "core/amoebotparticle.h"
+
+ConvexHullAnalysis& ConvexHullAnalysis::of(AmoebotSystem& system) {
+  for (const auto& a : system._analyses) {
+    auto analysis = dynamic_cast<ConvexHullAnalysis*>(a);
+    if (analysis != nullptr) {
+      return *analysis;
+    }
+  }
+
+  auto analysis = new ConvexHullAnalysis(system);
+  system._analyses.push_back(analysis);
+  system.addObserver(analysis);
+  return *analysis;
+}
+
+ConvexHullAnalysis::ConvexHullAnalysis(AmoebotSystem& system)
+  : _system(system) {}
+
+const ConvexHull& ConvexHullAnalysis::hull() {
+  update();
+  return _hull;
+}
+
+void ConvexHullAnalysis::onInsert(const AmoebotParticle& particle) {
+  if (isCurrent() && !_hull.contains(particle.head)) {
+    invalidate();
+  }
+}
+
+void ConvexHullAnalysis::onRemove(const AmoebotParticle& particle) {
+  if (isCurrent() && _hull.isVertex(particle.head)) {
+    invalidate();
+  }
+}
+
+void ConvexHullAnalysis::onMove(const AmoebotParticle& particle,
+                                const Node& oldHead, const int) {
+  if (isCurrent() && particle.head != oldHead &&
+      (_hull.isVertex(oldHead) || !_hull.contains(particle.head))) {
+    invalidate();
+  }
+}
+
+void ConvexHullAnalysis::compute() {
+  std::vector<Node> heads;
+  heads.reserve(_system.size());
+  for (const auto& p : _system.particles) {
+    heads.push_back(p->head);
+  }
+  _hull = ConvexHull(heads);
+}
+
+HullMeasure::HullMeasure(const QString name, const unsigned int freq,
+                         AmoebotSystem& system, const Extent extent)
+  : Measure(name, freq),
+    _analysis(ConvexHullAnalysis::of(system)),
+    _extent(extent) {}
+
+double HullMeasure::calculate() const {
+  return extentOf(_analysis.hull());
+}
+
+bool HullMeasure::usesSnapshot() const {
+  return true;
+}
+
+double HullMeasure::calculateFromSnapshot(const Snapshot& snapshot) const {
+  std::vector<Node> heads;
+  heads.reserve(snapshot.particles.size());
+  for (const auto& record : snapshot.particles) {
+    heads.push_back(record.head);
+  }
+
+  return extentOf(ConvexHull(heads));
+}
+
+double HullMeasure::extentOf(const ConvexHull& hull) const {
+  switch (_extent) {
+    case Extent::Diameter: return hull.diameter();
+    case Extent::MinWidth: return hull.minWidth();
+    case Extent::Width:    return hull.extentX();
+    case Extent::Height:   return hull.extentY();
+  }
+
+  return 0.0;
+}
@@ -0,0 +1,84 @@
+/* Copyright (C) 2021 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+// Defines generic measures of the spread of a system on the plane, such as its
+// diameter, based on the convex hull of its particles' heads (see
+// convexhull.h). Any AmoebotSystem can register them; all such measures of a
+// system share one ConvexHullAnalysis, which keeps the hull up to date with the
+// system's events and rebuilds it only when an event may have changed it.
+
+#ifndef AMOEBOTSIM_CORE_HULLMEASURES_H_
+#define AMOEBOTSIM_CORE_HULLMEASURES_H_
+
+#include <QString>
+
+#include "core/amoebotsystem.h"
+#include "core/analysis.h"
+#include "core/convexhull.h"
+#include "core/metric.h"
+#include "core/systemobserver.h"
+
+class ConvexHullAnalysis : public Analysis, public SystemObserver {
+ public:
+  // Returns the convex hull analysis of the given system, creating and
+  // registering it with the system first if it has none.
+  static ConvexHullAnalysis& of(AmoebotSystem& system);
+
+  // Returns the convex hull of the particles' heads, rebuilding it first if an
+  // event since the last rebuild may have changed it.
+  const ConvexHull& hull();
+
+  // Invalidates the hull if the event may have changed it: a head that appears
+  // outside the hull or a hull vertex that is vacated. Heads that appear inside
+  // the hull or leave a non-vertex node never change it.
+  void onInsert(const AmoebotParticle& particle) final;
+  void onRemove(const AmoebotParticle& particle) final;
+  void onMove(const AmoebotParticle& particle, const Node& oldHead,
+              const int oldTailDir) final;
+
+ protected:
+  // Constructs an analysis of the given system; see of().
+  ConvexHullAnalysis(AmoebotSystem& system);
+
+  // Rebuilds the hull from the particles' heads.
+  void compute() final;
+
+  AmoebotSystem& _system;
+  ConvexHull _hull;
+};
+
+class HullMeasure : public Measure {
+ public:
+  // The extents of a system HullMeasure can measure: its diameter (the largest
+  // Cartesian distance between two particles), its minimum width (the smallest
+  // distance between two parallel lines enclosing it), and the width and height
+  // of its axis-aligned bounding box, respectively. Particles are represented
+  // by their heads.
+  enum class Extent {
+    Diameter,
+    MinWidth,
+    Width,
+    Height
+  };
+
+  // Constructs a HullMeasure by using the parent constructor and adding a
+  // reference to the system being measured and the extent to measure.
+  HullMeasure(const QString name, const unsigned int freq,
+              AmoebotSystem& system, const Extent extent);
+
+  // Calculates the measure's extent from the system's shared convex hull, or,
+  // when evaluated in parallel, from the hull of the snapshot's heads.
+  double calculate() const final;
+  bool usesSnapshot() const final;
+  double calculateFromSnapshot(const Snapshot& snapshot) const final;
+
+ protected:
+  // Returns the measure's extent of the given hull.
+  double extentOf(const ConvexHull& hull) const;
+
+  ConvexHullAnalysis& _analysis;
+  const Extent _extent;
+};
+
+#endif  // AMOEBOTSIM_CORE_HULLMEASURES_H_
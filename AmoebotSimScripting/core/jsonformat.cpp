@@ -0,0 +1,38 @@
+/* Copyright (C) 2021 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+#include "core/jsonformat.h"
+
+#include <cmath>
+
+QString jsonString(const QString& text) {
+  QString json = "\"";
+  for (const QChar c : text) {
+    if (c == '"') {
+      json += "\\\"";
+    } else if (c == '\\') {
+      json += "\\\\";
+    } else if (c == '\n') {
+      json += "\\n";
+    } else if (c == '\r') {
+      json += "\\r";
+    } else if (c == '\t') {
+      json += "\\t";
+    } else if (c.unicode() < 0x20) {
+      json += QString("\\u%1").arg(c.unicode(), 4, 16, QChar('0'));
+    } else {
+      json += c;
+    }
+  }
+
+  return json + "\"";
+}
+
+QString jsonNumber(const double value) {
+  return std::isfinite(value) ? QString::number(value) : QString("null");
+}
+
+QString csvString(const QString& text) {
+  return "\"" + QString(text).replace("\"", "\"\"") + "\"";
+}
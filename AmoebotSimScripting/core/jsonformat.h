@@ -0,0 +1,25 @@
+/* Copyright (C) 2021 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+// Defines the formatting shared by every writer of metrics as JSON or CSV, so
+// that names are escaped and non-finite values are written the same way
+// everywhere. JSON has no representation of NaN or infinity (e.g., averages
+// over no lines yet), so jsonNumber writes such values as null.
+
+#ifndef AMOEBOTSIM_CORE_JSONFORMAT_H_
+#define AMOEBOTSIM_CORE_JSONFORMAT_H_
+
+#include <QString>
+
+// Returns the given text as a JSON string, with quotes, backslashes, and
+// control characters escaped.
+QString jsonString(const QString& text);
+
+// Returns the given value as a JSON number, or null if it is not finite.
+QString jsonNumber(const double value);
+
+// Returns the given text as a quoted CSV field, with quotes doubled.
+QString csvString(const QString& text);
+
+#endif  // AMOEBOTSIM_CORE_JSONFORMAT_H_
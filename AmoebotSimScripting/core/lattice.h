@@ -0,0 +1,95 @@
+/* Copyright (C) 2021 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+// Defines the topology of the triangular lattice a system lives on. By default
+// the lattice is the infinite plane. It can instead be a rhombic torus of
+// width x height nodes, in which case all nodes have 0 <= x < width and
+// 0 <= y < height and nodeInDir wraps around the edges. Every system owns its
+// lattice and hands it to its particles, so systems with different topologies
+// can exist side by side (e.g., while a new system is being set up before it
+// replaces a running one).
+
+#ifndef AMOEBOTSIM_CORE_LATTICE_H_
+#define AMOEBOTSIM_CORE_LATTICE_H_
+
+#include <QtGlobal>
+
+#include "core/node.h"
+
+class Lattice {
+ public:
+  // Constructs the infinite plane (the default) or a rhombic torus of the
+  // given dimensions, respectively.
+  Lattice();
+  Lattice(int width, int height);
+
+  // Equality operators; two lattices are equal if they have the same topology.
+  bool operator==(const Lattice& other) const;
+  bool operator!=(const Lattice& other) const;
+
+  // isTorus checks whether the lattice is a torus, and width and height return
+  // its dimensions (0 on the plane).
+  bool isTorus() const;
+  int width() const;
+  int height() const;
+
+  // Returns the node adjacent to the given one in the given global direction,
+  // wrapping around the edges of a torus (see Node::nodeInDir).
+  Node nodeInDir(const Node& node, int dir) const;
+
+ private:
+  // Dimensions of the torus, or 0 if the lattice is the infinite plane.
+  int _width;
+  int _height;
+};
+
+inline Lattice::Lattice()
+  : _width(0), _height(0) {}
+
+inline Lattice::Lattice(int width, int height)
+  : _width(width), _height(height) {
+  Q_ASSERT(width >= 3 && height >= 3);
+}
+
+inline bool Lattice::operator==(const Lattice& other) const {
+  return (_width == other._width) && (_height == other._height);
+}
+
+inline bool Lattice::operator!=(const Lattice& other) const {
+  return !operator==(other);
+}
+
+inline bool Lattice::isTorus() const {
+  return _width != 0;
+}
+
+inline int Lattice::width() const {
+  return _width;
+}
+
+inline int Lattice::height() const {
+  return _height;
+}
+
+inline Node Lattice::nodeInDir(const Node& node, int dir) const {
+  Node nbr = node.nodeInDir(dir);
+  if (_width != 0) {
+    // Neighbors are at most one step outside the torus, so a single correction
+    // per coordinate suffices.
+    if (nbr.x < 0) {
+      nbr.x += _width;
+    } else if (nbr.x >= _width) {
+      nbr.x -= _width;
+    }
+    if (nbr.y < 0) {
+      nbr.y += _height;
+    } else if (nbr.y >= _height) {
+      nbr.y -= _height;
+    }
+  }
+
+  return nbr;
+}
+
+#endif  // AMOEBOTSIM_CORE_LATTICE_H_
@@ -0,0 +1,110 @@
+/* Copyright (C) 2021 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+#include "core/latticelayout.h"
+
+#include <QFile>
+#include <QImageReader>
+#include <QList>
+
+LatticeLayout::LatticeLayout() {}
+
+bool LatticeLayout::load(const QString filePath, const Node& origin,
+                         const std::map<QRgb, int>& colors, QString& error) {
+  _particles.clear();
+  _objects.clear();
+
+  QImageReader reader(filePath);
+  if (reader.canRead()) {
+    const QImage image = reader.read();
+    if (image.isNull()) {
+      error = "could not read " + filePath + ": " + reader.errorString();
+      return false;
+    }
+    return loadImage(image, origin, colors, error);
+  }
+
+  QFile file(filePath);
+  if (!file.open(QIODevice::ReadOnly)) {
+    error = "could not open " + filePath;
+    return false;
+  }
+  return loadText(file.readAll(), origin, error);
+}
+
+const std::vector<ParticleRecord>& LatticeLayout::particles() const {
+  return _particles;
+}
+
+const std::vector<Node>& LatticeLayout::objects() const {
+  return _objects;
+}
+
+bool LatticeLayout::loadText(const QByteArray& text, const Node& origin,
+                             QString& error) {
+  QList<QByteArray> rows;
+  for (QByteArray line : text.split('\n')) {
+    if (line.endsWith('\r')) {
+      line.chop(1);
+    }
+    if (!line.startsWith('#')) {
+      rows.append(line);
+    }
+  }
+  // A final newline does not start another row.
+  while (!rows.isEmpty() && rows.last().isEmpty()) {
+    rows.removeLast();
+  }
+
+  for (int r = 0; r < rows.size(); ++r) {
+    const int y = origin.y + rows.size() - 1 - r;
+    for (int c = 0; c < rows[r].size(); ++c) {
+      const char ch = rows[r][c];
+      const Node node(origin.x + c, y);
+      if ('0' <= ch && ch <= '9') {
+        _particles.push_back({node, -1, ch - '0', -1});
+      } else if (ch == 'X') {
+        _objects.push_back(node);
+      } else if (ch != '.' && ch != ' ') {
+        error = "unknown character '" + QString(QChar(ch)) + "' in line " +
+                QString::number(r + 1) + " of the grid";
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+bool LatticeLayout::loadImage(const QImage& image, const Node& origin,
+                              const std::map<QRgb, int>& colors,
+                              QString& error) {
+  const QImage pixels = image.convertToFormat(QImage::Format_ARGB32);
+  for (int r = 0; r < pixels.height(); ++r) {
+    const QRgb* line = reinterpret_cast<const QRgb*>(pixels.constScanLine(r));
+    const int y = origin.y + pixels.height() - 1 - r;
+    for (int c = 0; c < pixels.width(); ++c) {
+      const QRgb color = line[c] & 0xffffff;
+      const Node node(origin.x + c, y);
+      if (qAlpha(line[c]) == 0 || color == 0xffffff) {
+        continue;
+      } else if (color == 0x000000) {
+        _objects.push_back(node);
+        continue;
+      }
+
+      auto it = colors.find(color);
+      if (it == colors.end()) {
+        error = "unmapped color #" +
+                QString::number(color, 16).rightJustified(6, '0') +
+                " at pixel (" + QString::number(c) + ", " +
+                QString::number(r) + ")";
+        return false;
+      }
+      _particles.push_back({node, -1, it->second, -1});
+    }
+  }
+
+  return true;
+}
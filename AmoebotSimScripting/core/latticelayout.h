@@ -0,0 +1,63 @@
+/* Copyright (C) 2021 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+// Defines a layout of contracted particles and objects read from a lattice
+// file, which systems load in bulk (see AmoebotSystem::loadLayout) instead of
+// generating their initial configuration. Particles are given by their state
+// codes (see AmoebotParticle::stateCode), which the algorithm maps back to its
+// species. Two file formats are supported:
+// - Text: a grid of characters, one per node, where '0' to '9' is a particle of
+//   that state, 'X' an object, and '.' or ' ' an empty node. Lines starting
+//   with '#' are comments. The last line of the grid holds the nodes with
+//   y = 0 and the lines above it increasing y; the c-th character of a line is
+//   the node with x = c. Since lattice coordinates are axial, the grid is the
+//   rhombus that is also the shape of a torus (see lattice.h).
+// - Images (any format Qt reads, e.g., PNG or BMP): one pixel per node, laid
+//   out like the text grid. Black pixels are objects and white or transparent
+//   pixels empty nodes; all other colors must be mapped to particle states.
+// Both formats place their grid's bottom-left node at a given origin.
+
+#ifndef AMOEBOTSIM_CORE_LATTICELAYOUT_H_
+#define AMOEBOTSIM_CORE_LATTICELAYOUT_H_
+
+#include <map>
+#include <vector>
+
+#include <QByteArray>
+#include <QImage>
+#include <QRgb>
+#include <QString>
+
+#include "core/node.h"
+#include "core/snapshot.h"
+
+class LatticeLayout {
+ public:
+  // Constructs an empty layout.
+  LatticeLayout();
+
+  // Reads the lattice file at the given path, replacing the layout. Images are
+  // recognized by their contents; their colors (as 0xrrggbb) are mapped to
+  // particle states by the given map. Returns false and describes the problem
+  // in error if the file cannot be read, has an unknown character, or has an
+  // unmapped color.
+  bool load(const QString filePath, const Node& origin,
+            const std::map<QRgb, int>& colors, QString& error);
+
+  // Returns the particles of the layout, all contracted and at distinct nodes,
+  // and the nodes of its objects.
+  const std::vector<ParticleRecord>& particles() const;
+  const std::vector<Node>& objects() const;
+
+ private:
+  // Functions for parsing the two formats; see above.
+  bool loadText(const QByteArray& text, const Node& origin, QString& error);
+  bool loadImage(const QImage& image, const Node& origin,
+                 const std::map<QRgb, int>& colors, QString& error);
+
+  std::vector<ParticleRecord> _particles;
+  std::vector<Node> _objects;
+};
+
+#endif  // AMOEBOTSIM_CORE_LATTICELAYOUT_H_
@@ -0,0 +1,158 @@
+/* Copyright (C) 2021 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+#include "core/latticerenderer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "core/object.h"
+#include "core/particle.h"
+
+namespace {
+
+// Height of a triangle in the lattice if the side length is 1.
+const double triangleHeight = std::sqrt(3.0 / 4.0);
+
+// Radii of particles and objects and the width of particle outlines, relative
+// to the distance between adjacent nodes.
+const double particleRadius = 0.45;
+const double objectRadius = 0.5;
+const double outlineWidth = 0.08;
+
+// Colors of the background, outlines and objects, and particles without color.
+const QRgb backgroundColor = 0xffffffff;
+const QRgb black = 0xff000000;
+const QRgb noColor = 0xffc8c8c8;
+
+// Returns the position of the given node in world coordinates; see VisItem.
+QPointF nodeToWorldCoord(const Node& node) {
+  return QPointF(node.x + 0.5 * node.y, node.y * triangleHeight);
+}
+
+}  // namespace
+
+LatticeRenderer::LatticeRenderer(const int width, const int height)
+  : _width(width),
+    _height(height),
+    _center(0, 0),
+    _scale(20) {
+  Q_ASSERT(width > 0 && height > 0);
+}
+
+void LatticeRenderer::fit(const System& system) {
+  double left = std::numeric_limits<double>::max();
+  double right = std::numeric_limits<double>::lowest();
+  double bottom = left;
+  double top = right;
+  auto include = [&](const Node& node) {
+    const QPointF pos = nodeToWorldCoord(node);
+    left = std::min(left, pos.x());
+    right = std::max(right, pos.x());
+    bottom = std::min(bottom, pos.y());
+    top = std::max(top, pos.y());
+  };
+  for (const Particle& p : system) {
+    include(p.head);
+    if (p.globalTailDir != -1) {
+      include(p.tail());
+    }
+  }
+  for (const Object* o : system.getObjects()) {
+    include(o->_node);
+  }
+  if (left > right) {
+    return;  // Nothing to frame.
+  }
+
+  // Leave a margin of one node around the configuration.
+  _center = QPointF((left + right) / 2, (bottom + top) / 2);
+  _scale = std::min(_width / (right - left + 2), _height / (top - bottom + 2));
+}
+
+QImage LatticeRenderer::render(const System& system) const {
+  QImage image(_width, _height, QImage::Format_RGB32);
+  image.fill(backgroundColor);
+
+  // Outlines are left out when they would cover most of a particle.
+  const double outline = (_scale >= 6) ? std::max(1.0, outlineWidth * _scale)
+                                       : 0.0;
+  // Particles stay visible as single pixels when zoomed out far.
+  const double radius = std::max(0.75, particleRadius * _scale);
+
+  for (const Object* o : system.getObjects()) {
+    const QPointF pos = toPixel(o->_node);
+    fillCapsule(image, pos, pos, objectRadius * _scale, black);
+  }
+
+  for (const Particle& p : system) {
+    const QPointF head = toPixel(p.head);
+    QPointF tail = (p.globalTailDir == -1) ? head : toPixel(p.tail());
+    const QRgb headColor = (p.headMarkColor() == -1)
+                           ? noColor : (0xff000000 | p.headMarkColor());
+    const QRgb tailColor = (p.tailMarkColor() == -1)
+                           ? headColor : (0xff000000 | p.tailMarkColor());
+
+    // A tail that wrapped around a torus is drawn where it lies, on its own.
+    const QPointF bar = tail - head;
+    if (bar.x() * bar.x() + bar.y() * bar.y() > 4 * _scale * _scale) {
+      fillCapsule(image, tail, tail, radius, black);
+      fillCapsule(image, tail, tail, radius - outline, tailColor);
+      tail = head;
+    }
+
+    fillCapsule(image, head, tail, radius, black);
+    fillCapsule(image, head, tail, radius - outline, headColor);
+    if (tail != head && tailColor != headColor) {
+      fillCapsule(image, tail, tail, radius - outline, tailColor);
+    }
+  }
+
+  return image;
+}
+
+QPointF LatticeRenderer::toPixel(const Node& node) const {
+  const QPointF pos = nodeToWorldCoord(node) - _center;
+  return QPointF(_width / 2.0 + pos.x() * _scale,
+                 _height / 2.0 - pos.y() * _scale);
+}
+
+void LatticeRenderer::fillCapsule(QImage& image, const QPointF& a,
+                                  const QPointF& b, const double radius,
+                                  const QRgb color) {
+  // Only the pixels within the capsule's bounding box are tested.
+  const double left = std::min(a.x(), b.x()) - radius;
+  const double right = std::max(a.x(), b.x()) + radius;
+  const double top = std::min(a.y(), b.y()) - radius;
+  const double bottom = std::max(a.y(), b.y()) + radius;
+  const int minX = std::max(0, static_cast<int>(std::floor(left)));
+  const int maxX = std::min(image.width() - 1,
+                            static_cast<int>(std::ceil(right)));
+  const int minY = std::max(0, static_cast<int>(std::floor(top)));
+  const int maxY = std::min(image.height() - 1,
+                            static_cast<int>(std::ceil(bottom)));
+  if (radius <= 0 || minX > maxX || minY > maxY) {
+    return;
+  }
+
+  const double dx = b.x() - a.x();
+  const double dy = b.y() - a.y();
+  const double length2 = dx * dx + dy * dy;
+  const double radius2 = radius * radius;
+  for (int y = minY; y <= maxY; ++y) {
+    QRgb* line = reinterpret_cast<QRgb*>(image.scanLine(y));
+    const double py = y + 0.5 - a.y();
+    for (int x = minX; x <= maxX; ++x) {
+      const double px = x + 0.5 - a.x();
+      double t = (length2 > 0) ? (px * dx + py * dy) / length2 : 0.0;
+      t = std::max(0.0, std::min(1.0, t));
+      const double ex = px - t * dx;
+      const double ey = py - t * dy;
+      if (ex * ex + ey * ey <= radius2) {
+        line[x] = color;
+      }
+    }
+  }
+}
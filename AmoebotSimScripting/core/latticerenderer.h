@@ -0,0 +1,52 @@
+/* Copyright (C) 2021 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+// Defines a software renderer that draws a system's particles and objects
+// straight into an image, without OpenGL or a window, so that movies can be
+// made on machines without a display. Particles are drawn as disks (or, if
+// expanded, as two disks joined by a bar) outlined in black and filled with
+// their head mark color (see Particle::headMarkColor), or light gray if they
+// have none; objects are drawn as black disks. The lattice is laid out as in
+// the GUI (see VisItem), so images look like screenshots without the grid.
+
+#ifndef AMOEBOTSIM_CORE_LATTICERENDERER_H_
+#define AMOEBOTSIM_CORE_LATTICERENDERER_H_
+
+#include <QImage>
+#include <QPointF>
+#include <QRgb>
+
+#include "core/node.h"
+#include "core/system.h"
+
+class LatticeRenderer {
+ public:
+  // Constructs a renderer of images with the given size in pixels that shows
+  // the area around the origin.
+  LatticeRenderer(const int width, const int height);
+
+  // Frames the given system's particles and objects as tightly as the image's
+  // aspect ratio allows. Renderers keep their framing until fit is called
+  // again, so all frames of a movie can share the same view.
+  void fit(const System& system);
+
+  // Returns an image of the given system's current configuration.
+  QImage render(const System& system) const;
+
+ private:
+  // Returns the pixel coordinates of the given node's center.
+  QPointF toPixel(const Node& node) const;
+
+  // Sets all pixels whose centers lie within the given radius (in pixels) of
+  // the segment from a to b to the given color.
+  static void fillCapsule(QImage& image, const QPointF& a, const QPointF& b,
+                          const double radius, const QRgb color);
+
+  const int _width;
+  const int _height;
+  QPointF _center;
+  double _scale;  // Pixels per unit of distance between adjacent nodes.
+};
+
+#endif  // AMOEBOTSIM_CORE_LATTICERENDERER_H_
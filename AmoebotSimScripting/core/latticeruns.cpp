@@ -0,0 +1,94 @@
+/* Copyright (C) 2021 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+#include "core/latticeruns.h"
+
+#include <algorithm>
+
+#include <QtGlobal>
+
+LatticeRuns::LatticeRuns(const std::vector<Node>& nodes, int axis,
+                         const Lattice& lattice)
+  : _histogram(1, 0) {
+  Q_ASSERT(0 <= axis && axis <= 2);
+
+  const int len = period(lattice, axis);
+  std::vector<Entry> entries;
+  entries.reserve(nodes.size());
+  for (unsigned int i = 0; i < nodes.size(); ++i) {
+    entries.push_back(entry(nodes[i], axis, len, i));
+  }
+  std::sort(entries.begin(), entries.end());
+
+  // Sweep the sorted nodes line by line, starting a new run whenever the next
+  // node is not adjacent to the previous one.
+  unsigned int lineStart = 0;
+  int lineStartCoord = 0;
+  for (unsigned int i = 0; i < entries.size(); ++i) {
+    const bool newLine = (i == 0 || entries[i].line != entries[i - 1].line);
+    if (newLine) {
+      lineStart = _runs.size();
+      lineStartCoord = entries[i].coord;
+    }
+    if (newLine || entries[i].coord != entries[i - 1].coord + 1) {
+      _runs.push_back({});
+    }
+    _runs.back().push_back(entries[i].index);
+
+    // On a torus, a run ending at the last coordinate of a line continues with
+    // the run starting at coordinate 0 of the same line, if there is one.
+    const bool lineEnd = (i + 1 == entries.size() ||
+                          entries[i + 1].line != entries[i].line);
+    if (lineEnd && len != 0 && _runs.size() - 1 > lineStart &&
+        entries[i].coord == len - 1 && lineStartCoord == 0) {
+      _runs.back().insert(_runs.back().end(), _runs[lineStart].begin(),
+                          _runs[lineStart].end());
+      _runs.erase(_runs.begin() + lineStart);
+    }
+  }
+
+  for (const auto& run : _runs) {
+    if (run.size() >= _histogram.size()) {
+      _histogram.resize(run.size() + 1, 0);
+    }
+    ++_histogram[run.size()];
+  }
+}
+
+const std::vector<std::vector<int>>& LatticeRuns::runs() const {
+  return _runs;
+}
+
+const std::vector<int>& LatticeRuns::histogram() const {
+  return _histogram;
+}
+
+bool LatticeRuns::Entry::operator<(const Entry& other) const {
+  return (line < other.line) || (line == other.line && coord < other.coord);
+}
+
+LatticeRuns::Entry LatticeRuns::entry(const Node& node, int axis, int period,
+                                      int index) {
+  if (axis == 0) {
+    // Moving E increments x within a row of constant y.
+    return {node.y, node.x, index};
+  } else if (axis == 1) {
+    // Moving NE increments y within a column of constant x.
+    return {node.x, node.y, index};
+  } else {
+    // Moving NW increments y and decrements x, keeping x + y constant (modulo
+    // the side length on a torus).
+    const int line = node.x + node.y;
+    return {period != 0 ? line % period : line, node.y, index};
+  }
+}
+
+int LatticeRuns::period(const Lattice& lattice, int axis) {
+  if (!lattice.isTorus()) {
+    return 0;
+  }
+  Q_ASSERT(axis != 2 || lattice.width() == lattice.height());
+
+  return (axis == 1) ? lattice.height() : lattice.width();
+}
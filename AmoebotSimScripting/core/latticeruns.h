@@ -0,0 +1,57 @@
+/* Copyright (C) 2021 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+// Defines a scan that decomposes a set of lattice nodes into maximal runs of
+// consecutive nodes along one of the three lattice axes. Axis a is the line
+// through global directions a and a + 3 (see node.h): axis 0 runs E-W, axis 1
+// NE-SW, and axis 2 NW-SE. The nodes are sorted once by the lattice line they
+// lie on and their position along it, after which a single linear sweep finds
+// all runs; no recursion or occupancy lookups are needed. On a torus, runs
+// continue across the seam and a fully occupied line forms one run.
+
+#ifndef AMOEBOTSIM_CORE_LATTICERUNS_H_
+#define AMOEBOTSIM_CORE_LATTICERUNS_H_
+
+#include <vector>
+
+#include "core/lattice.h"
+#include "core/node.h"
+
+class LatticeRuns {
+ public:
+  // Computes the runs of the given (distinct) nodes of the given lattice along
+  // the given axis. Scanning axis 2 of a torus requires the torus to be square.
+  LatticeRuns(const std::vector<Node>& nodes, int axis,
+              const Lattice& lattice = Lattice());
+
+  // Returns the runs, each given as the indices into the scanned nodes of its
+  // nodes in order along the axis.
+  const std::vector<std::vector<int>>& runs() const;
+
+  // Returns the run length histogram, whose entry at index l is the number of
+  // runs of length l. Its last entry is the length of the longest run.
+  const std::vector<int>& histogram() const;
+
+ private:
+  // Position of a scanned node: the lattice line it lies on, its coordinate
+  // along that line, and its index among the scanned nodes.
+  struct Entry {
+    int line, coord, index;
+
+    bool operator<(const Entry& other) const;
+  };
+
+  // Returns the position of the given node along the given axis, whose lines
+  // have the given period (see period()).
+  static Entry entry(const Node& node, int axis, int period, int index);
+
+  // Returns the number of nodes on each line of the given axis if the given
+  // lattice is a torus, or 0 if it is the plane.
+  static int period(const Lattice& lattice, int axis);
+
+  std::vector<std::vector<int>> _runs;
+  std::vector<int> _histogram;
+};
+
+#endif  // AMOEBOTSIM_CORE_LATTICERUNS_H_
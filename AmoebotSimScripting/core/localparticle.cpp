@@ -31,8 +31,8 @@ const std::array<std::array<int, 10>, 6> LocalParticle::labelDir = {
 };
 
 LocalParticle::LocalParticle(const Node& head, int globalTailDir,
-                             const int orientation)
-  : Particle(head, globalTailDir),
+                             const int orientation, const Lattice& lattice)
+  : Particle(head, globalTailDir, lattice),
   orientation(orientation) {
   Q_ASSERT(0 <= orientation && orientation < 6);
 }
@@ -286,11 +286,11 @@ Node LocalParticle::nbrNodeReachedViaLabel(int label) const {
   if (isContracted()) {
     Q_ASSERT(0 <= label && label < 6);
     const int dir = (orientation + label) % 6;
-    return head.nodeInDir(dir);
+    return lattice.nodeInDir(head, dir);
   } else {
     Q_ASSERT(0 <= label && label < 10);
     Node incidentNode = occupiedNodeIncidentToLabel(label);
-    return incidentNode.nodeInDir(labelToGlobalDir(label));
+    return lattice.nodeInDir(incidentNode, labelToGlobalDir(label));
   }
 }
 
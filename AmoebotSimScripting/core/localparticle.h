@@ -28,15 +28,17 @@
 #include <array>
 #include <vector>
 
+#include "core/lattice.h"
 #include "core/node.h"
 #include "core/particle.h"
 
 class LocalParticle : public Particle {
  public:
   // Constructs a new particle with a node position for its head, a global
-  // compass direction from its head to its tail (-1 if contracted), and an
-  // offset for its local compass.
-  LocalParticle(const Node& head, int globalTailDir, const int orientation);
+  // compass direction from its head to its tail (-1 if contracted), an offset
+  // for its local compass, and the lattice it lives on.
+  LocalParticle(const Node& head, int globalTailDir, const int orientation,
+                const Lattice& lattice = Lattice());
 
   // Returns the local direction of the tail relative to the head, (-1 if
   // contracted).
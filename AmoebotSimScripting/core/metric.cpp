@@ -4,6 +4,8 @@
 
 #include "core/metric.h"
 
+#include <QtGlobal>
+
 #include "core/amoebotsystem.h"
 
 Count::Count(const QString name)
@@ -14,8 +16,65 @@ void Count::record(const unsigned int numEvents) {
   _value += numEvents;
 }
 
+void Count::recordHistory() {
+  _history.push_back(_value);
+  if (_stats != nullptr) {
+    _stats->push(_value);
+  }
+}
+
 Measure::Measure(const QString name, const unsigned int freq)
   : _name(name),
-    _freq(freq) {}
+    _schedule(Schedule::Rounds),
+    _interval(freq),
+    _nextTime(0),
+    _enabled(true) {}
 
 Measure::~Measure() {}
+
+bool Measure::usesSnapshot() const {
+  return false;
+}
+
+double Measure::calculateFromSnapshot(const Snapshot&) const {
+  Q_ASSERT(false);  // Only measures overriding usesSnapshot() can be called.
+  return 0.0;
+}
+
+double Measure::value() const {
+  if (_enabled && _schedule == Schedule::Lazy) {
+    return calculate();
+  }
+
+  return _history.empty() ? 0.0 : _history.back();
+}
+
+void Measure::recordValue(const double value) {
+  _history.push_back(value);
+  if (_stats != nullptr) {
+    _stats->push(value);
+  }
+}
+
+QString Measure::scheduleName(const Schedule schedule) {
+  switch (schedule) {
+    case Schedule::Rounds:      return "rounds";
+    case Schedule::Activations: return "activations";
+    case Schedule::Time:        return "time";
+    case Schedule::Lazy:        return "lazy";
+  }
+
+  return "";
+}
+
+bool Measure::scheduleFromName(const QString name, Schedule& schedule) {
+  for (auto s : {Schedule::Rounds, Schedule::Activations, Schedule::Time,
+                 Schedule::Lazy}) {
+    if (QString::compare(scheduleName(s), name) == 0) {
+      schedule = s;
+      return true;
+    }
+  }
+
+  return false;
+}
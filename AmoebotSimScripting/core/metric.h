@@ -10,10 +10,15 @@
 
 #include <deque>
 #include <map>
+#include <memory>
 #include <vector>
 
 #include <QString>
 
+#include "core/history.h"
+#include "core/onlinestats.h"
+#include "core/snapshot.h"
+
 class Count {
  public:
   // Constructs a new count initialized to zero.
@@ -23,17 +28,37 @@ class Count {
   // whose default is 1.
   void record(const unsigned int numEvents = 1);
 
+  // Appends the current value of this count to its history and, if enabled,
+  // its statistics.
+  void recordHistory();
+
   // Member variables. The count's name should be human-readable, as it is used
   // to represent this count in the GUI. The value of the count is what is
-  // incremented. History records the count values over time, once per round.
+  // incremented. History records the count values over time, once per round,
+  // under a memory policy that can be changed per count (see history.h).
+  // Stats, if not null, summarizes the recorded values (see onlinestats.h).
   const QString _name;
   unsigned int _value;
-  std::vector<int> _history;
+  History<int> _history;
+  std::unique_ptr<OnlineStats> _stats;
 };
 
 class Measure {
  public:
-  // Constructs a new measure with a given name and calculation frequency.
+  // The schedules by which a measure's history can be recorded. Rounds,
+  // Activations, and Time record the measure every interval rounds,
+  // activations, or units of simulated time, respectively. Lazy measures are
+  // never recorded automatically; they are only calculated when their value is
+  // requested (e.g., by the GUI, a script, or a metrics export).
+  enum class Schedule {
+    Rounds,
+    Activations,
+    Time,
+    Lazy
+  };
+
+  // Constructs a new measure with a given name and calculation frequency in
+  // terms of # of rounds.
   Measure(const QString name, const unsigned int freq);
   virtual ~Measure();
 
@@ -43,13 +68,47 @@ class Measure {
   // This is a pure virtual function and must be overridden by child classes.
   virtual double calculate() const = 0;
 
+  // Functions for measures that can be calculated from a Snapshot of the system
+  // alone, without touching the live system. Such measures override both
+  // usesSnapshot (to return true) and calculateFromSnapshot; the system may
+  // then evaluate them on a worker thread (see
+  // AmoebotSystem::setParallelMeasures). calculateFromSnapshot must be safe to
+  // run concurrently with the simulation and with other measures.
+  virtual bool usesSnapshot() const;
+  virtual double calculateFromSnapshot(const Snapshot& snapshot) const;
+
+  // Returns the measure's current value. Enabled lazy measures are calculated
+  // on the spot; all others return their most recently recorded value (0 if
+  // they have not been recorded yet), so reading them costs nothing.
+  double value() const;
+
+  // Appends the given value of this measure to its history and, if enabled,
+  // its statistics.
+  void recordValue(const double value);
+
+  // Returns the name of the given schedule as used in scripts and metrics
+  // exports ("rounds", "activations", "time", or "lazy"), and the schedule with
+  // the given name, respectively. scheduleFromName returns false if the name is
+  // not recognized.
+  static QString scheduleName(const Schedule schedule);
+  static bool scheduleFromName(const QString name, Schedule& schedule);
+
   // Member variables. The measure's name should be human-readable, as it is
-  // used to represent this measure in the GUI. Frequency determines how often
-  // the measure is calculated in terms of # of rounds. History records the
-  // measure values over time, once per round.
+  // used to represent this measure in the GUI. The schedule and interval
+  // determine when the measure is calculated and recorded (see
+  // AmoebotSystem::setMeasureSchedule); _nextTime is the simulated time of the
+  // next recording under the Time schedule. Disabled measures are never
+  // calculated. History records the measure values over time, once per
+  // scheduled recording, under a memory policy that can be changed per measure
+  // (see history.h). Stats, if not null, summarizes the recorded values (see
+  // onlinestats.h).
   const QString _name;
-  const unsigned int _freq;
-  std::vector<double> _history;
+  Schedule _schedule;
+  double _interval;
+  double _nextTime;
+  bool _enabled;
+  History<double> _history;
+  std::unique_ptr<OnlineStats> _stats;
 };
 
 #endif  // AMOEBOTSIM_CORE_METRIC_H_
@@ -0,0 +1,376 @@
+/* Copyright (C) 2021 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+#include "core/metricsarchive.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <QDateTime>
+#include <QTextStream>
+#include <QtEndian>
+
+#include "core/history.h"
+#include "core/jsonformat.h"
+
+namespace {
+
+// Appends the little-endian representation of the given value to the buffer.
+template<class T>
+void append(QByteArray& buffer, const T value) {
+  const T le = qToLittleEndian(value);
+  buffer.append(reinterpret_cast<const char*>(&le), sizeof(T));
+}
+
+void appendString(QByteArray& buffer, const QString& string) {
+  const QByteArray utf8 = string.toUtf8();
+  append<quint32>(buffer, utf8.size());
+  buffer.append(utf8);
+}
+
+// Returns the given size rounded up to the next multiple of 8.
+quint64 align(const quint64 size) {
+  return (size + 7) & ~quint64(7);
+}
+
+// Writes the values of the given history to the file in blocks of at most
+// blockSize bytes, followed by zero padding up to the next multiple of 8 bytes.
+// Only one block of values is read from the history at a time.
+template<class T, class Stored>
+bool writeColumn(QFile& file, const History<T>& history,
+                 const int blockSize) {
+  const unsigned long long numValues = history.size();
+  const unsigned long long perBlock = blockSize / sizeof(Stored);
+  QByteArray block;
+  block.reserve(blockSize);
+  for (unsigned long long i = 0; i < numValues; i += perBlock) {
+    const unsigned long long count = std::min(numValues - i, perBlock);
+    const std::vector<T> values = history.values(i, count);
+    if (values.size() != count) {
+      return false;  // The history could not be read back (e.g., from disk).
+    }
+    block.clear();
+    for (const T value : values) {
+      append<Stored>(block, static_cast<Stored>(value));
+    }
+    if (file.write(block) != block.size()) {
+      return false;
+    }
+  }
+
+  const quint64 size = numValues * sizeof(Stored);
+  const QByteArray padding(align(size) - size, '\0');
+  return file.write(padding) == padding.size();
+}
+
+}  // namespace
+
+const char MetricsArchive::magic[8] = {'A', 'M', 'B', 'M', 'E', 'T', 'R', 'C'};
+
+bool MetricsArchive::write(const QString filePath, const System& system,
+                           const std::vector<Parameter>& params,
+                           const quint64 seed) {
+  const auto& counts = system.getCounts();
+  const auto& measures = system.getMeasures();
+
+  // Everything up to the column directory's offsets is independent of where
+  // the columns end up, so the header's size is known before it is complete.
+  QByteArray header(magic, sizeof(magic));
+  append<quint32>(header, version);
+  append<quint32>(header, 0);  // Header size; filled in below.
+  append<quint64>(header, seed);
+  append<quint32>(header, params.size());
+  for (const auto& param : params) {
+    appendString(header, param.first);
+    appendString(header, param.second);
+  }
+  append<quint32>(header, counts.size() + measures.size());
+  quint64 headerSize = header.size();
+  for (const auto& c : counts) {
+    headerSize += 4 + c->_name.toUtf8().size() + 24;
+  }
+  for (const auto& m : measures) {
+    headerSize += 4 + m->_name.toUtf8().size() + 24;
+  }
+  headerSize = align(headerSize);
+  const quint32 headerSizeLE = qToLittleEndian<quint32>(headerSize);
+  std::memcpy(header.data() + sizeof(magic) + 4, &headerSizeLE, 4);
+
+  quint64 offset = headerSize;
+  for (const auto& c : counts) {
+    appendString(header, c->_name);
+    append<quint32>(header, static_cast<quint32>(ColumnType::Count));
+    append<quint32>(header, 0);
+    append<quint64>(header, offset);
+    append<quint64>(header, c->_history.size());
+    offset += align(c->_history.size() * sizeof(qint32));
+  }
+  for (const auto& m : measures) {
+    appendString(header, m->_name);
+    append<quint32>(header, static_cast<quint32>(ColumnType::Measure));
+    append<quint32>(header, 0);
+    append<quint64>(header, offset);
+    append<quint64>(header, m->_history.size());
+    offset += align(m->_history.size() * sizeof(double));
+  }
+  header.append(QByteArray(headerSize - header.size(), '\0'));
+
+  QFile file(filePath);
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate) ||
+      file.write(header) != header.size()) {
+    return false;
+  }
+  for (const auto& c : counts) {
+    if (!writeColumn<int, qint32>(file, c->_history, blockSize)) {
+      return false;
+    }
+  }
+  for (const auto& m : measures) {
+    if (!writeColumn<double, double>(file, m->_history, blockSize)) {
+      return false;
+    }
+  }
+  file.close();
+
+  return true;
+}
+
+MetricsArchiveReader::MetricsArchiveReader()
+  : _file(nullptr),
+    _data(nullptr),
+    _size(0),
+    _seed(0) {}
+
+MetricsArchiveReader::~MetricsArchiveReader() {
+  close();
+}
+
+bool MetricsArchiveReader::open(const QString filePath) {
+  close();
+  _error = "";
+
+#if Q_BYTE_ORDER == Q_BIG_ENDIAN
+  // Columns are accessed in place, so they must be in the host's byte order.
+  return fail("metrics archives cannot be read on big-endian hosts");
+#endif
+
+  _file = new QFile(filePath);
+  if (!_file->open(QIODevice::ReadOnly)) {
+    return fail("could not open " + filePath);
+  }
+  _size = _file->size();
+  _data = _file->map(0, _size);
+  if (_data == nullptr) {
+    return fail("could not map " + filePath);
+  }
+
+  // Validate the fixed part of the header.
+  quint64 pos = sizeof(MetricsArchive::magic);
+  quint32 fileVersion, headerSize;
+  if (_size < pos ||
+      std::memcmp(_data, MetricsArchive::magic, pos) != 0 ||
+      !read(pos, _size, fileVersion) || !read(pos, _size, headerSize)) {
+    return fail("not a metrics archive");
+  } else if (fileVersion != MetricsArchive::version) {
+    return fail("unsupported metrics archive version " +
+                QString::number(fileVersion));
+  } else if (headerSize > _size) {
+    return fail("truncated metrics archive header");
+  }
+
+  // Read the parameters and the column directory, checking that every column
+  // lies within the file and is aligned for in-place access.
+  quint32 numParams, numColumns;
+  if (!read(pos, headerSize, _seed) || !read(pos, headerSize, numParams)) {
+    return fail("truncated metrics archive header");
+  }
+  for (quint32 i = 0; i < numParams; ++i) {
+    MetricsArchive::Parameter param;
+    if (!readString(pos, headerSize, param.first) ||
+        !readString(pos, headerSize, param.second)) {
+      return fail("truncated metrics archive header");
+    }
+    _params.push_back(param);
+  }
+  if (!read(pos, headerSize, numColumns)) {
+    return fail("truncated metrics archive header");
+  }
+  for (quint32 i = 0; i < numColumns; ++i) {
+    Column column;
+    quint32 type, reserved;
+    quint64 offset;
+    if (!readString(pos, headerSize, column.name) ||
+        !read(pos, headerSize, type) || !read(pos, headerSize, reserved) ||
+        !read(pos, headerSize, offset) ||
+        !read(pos, headerSize, column.numValues)) {
+      return fail("truncated metrics archive header");
+    } else if (type !=
+               static_cast<quint32>(MetricsArchive::ColumnType::Count) &&
+               type !=
+               static_cast<quint32>(MetricsArchive::ColumnType::Measure)) {
+      return fail("unknown type of column " + column.name);
+    }
+    column.type = static_cast<MetricsArchive::ColumnType>(type);
+    const quint64 valueSize =
+        (column.type == MetricsArchive::ColumnType::Count) ? 4 : 8;
+    if (offset % 8 != 0 || offset > _size ||
+        column.numValues > (_size - offset) / valueSize) {
+      return fail("column " + column.name + " lies outside the archive");
+    }
+    column.data = _data + offset;
+    _columns.push_back(column);
+  }
+
+  return true;
+}
+
+void MetricsArchiveReader::close() {
+  if (_file != nullptr) {
+    if (_data != nullptr) {
+      _file->unmap(const_cast<uchar*>(_data));
+    }
+    _file->close();
+    delete _file;
+  }
+  _file = nullptr;
+  _data = nullptr;
+  _size = 0;
+  _seed = 0;
+  _params.clear();
+  _columns.clear();
+}
+
+QString MetricsArchiveReader::error() const {
+  return _error;
+}
+
+quint64 MetricsArchiveReader::seed() const {
+  return _seed;
+}
+
+const std::vector<MetricsArchive::Parameter>&
+MetricsArchiveReader::params() const {
+  return _params;
+}
+
+const std::vector<MetricsArchiveReader::Column>&
+MetricsArchiveReader::columns() const {
+  return _columns;
+}
+
+const qint32* MetricsArchiveReader::counts(const int column) const {
+  Q_ASSERT(_columns[column].type == MetricsArchive::ColumnType::Count);
+
+  return reinterpret_cast<const qint32*>(_columns[column].data);
+}
+
+const double* MetricsArchiveReader::measures(const int column) const {
+  Q_ASSERT(_columns[column].type == MetricsArchive::ColumnType::Measure);
+
+  return reinterpret_cast<const double*>(_columns[column].data);
+}
+
+QString MetricsArchiveReader::toJSON() const {
+  QString algorithm = "???";
+  QString params;
+  for (const auto& param : _params) {
+    if (param.first == "algorithm") {
+      algorithm = param.second;
+    }
+    params += jsonString(param.first) + " : " + jsonString(param.second) +
+              ", ";
+  }
+  if (!_params.empty()) {
+    params.chop(2);  // Remove the last ", ".
+  }
+
+  QString json = "{\"title\" : \"AmoebotSim Metrics JSON\", ";
+  json += "\"datetime\" : \"" +
+          QDateTime::currentDateTime().toString("yyyy-MM-dd HH:mm:ss") + "\", ";
+  json += "\"algorithm\" : " + jsonString(algorithm) + ", ";
+  json += "\"seed\" : " + QString::number(_seed) + ", ";
+  json += "\"parameters\" : {" + params + "}, ";
+  for (auto type : {MetricsArchive::ColumnType::Count,
+                    MetricsArchive::ColumnType::Measure}) {
+    json += (type == MetricsArchive::ColumnType::Count) ? "\"counts\" : ["
+                                                        : "\"measures\" : [";
+    bool any = false;
+    for (size_t i = 0; i < _columns.size(); ++i) {
+      if (_columns[i].type != type) {
+        continue;
+      }
+      json += "{\"name\" : " + jsonString(_columns[i].name) +
+              ", \"history\" : [";
+      for (quint64 j = 0; j < _columns[i].numValues; ++j) {
+        json += (type == MetricsArchive::ColumnType::Count)
+                ? QString::number(counts(i)[j])
+                : jsonNumber(measures(i)[j]);
+        json += ", ";
+      }
+      if (_columns[i].numValues > 0) {
+        json.chop(2);  // Remove the last ", ".
+      }
+      json += "]}, ";
+      any = true;
+    }
+    if (any) {
+      json.chop(2);  // Remove the last ", ".
+    }
+    json += "], ";
+  }
+  json.chop(2);  // Remove the last ", ".
+  json += "}";
+
+  return json;
+}
+
+bool MetricsArchiveReader::convertToJSON(const QString binaryPath,
+                                         const QString jsonPath) {
+  MetricsArchiveReader reader;
+  if (!reader.open(binaryPath)) {
+    return false;
+  }
+
+  QFile outFile(jsonPath);
+  if (!outFile.open(QIODevice::WriteOnly | QIODevice::Text)) {
+    return false;
+  }
+  QTextStream outStream(&outFile);
+  outStream << reader.toJSON();
+  outFile.close();
+
+  return true;
+}
+
+template<class T>
+bool MetricsArchiveReader::read(quint64& pos, const quint64 end,
+                                T& value) const {
+  if (pos + sizeof(T) > end) {
+    return false;
+  }
+  value = qFromLittleEndian<T>(_data + pos);
+  pos += sizeof(T);
+
+  return true;
+}
+
+bool MetricsArchiveReader::readString(quint64& pos, const quint64 end,
+                                      QString& value) const {
+  quint32 length;
+  if (!read(pos, end, length) || pos + length > end) {
+    return false;
+  }
+  value = QString::fromUtf8(reinterpret_cast<const char*>(_data + pos),
+                            length);
+  pos += length;
+
+  return true;
+}
+
+bool MetricsArchiveReader::fail(const QString message) {
+  close();
+  _error = message;
+
+  return false;
+}
@@ -0,0 +1,127 @@
+/* Copyright (C) 2021 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+// Defines a compact, self-describing binary format for the metrics of a run,
+// intended for parameter sweeps whose thousands of JSON exports would be slow
+// to write and to load. A metrics archive stores every count and measure
+// history as one contiguous column, so that a reader can memory-map the file
+// and access the columns in place without parsing or copying them.
+//
+// All integers are little-endian. An archive consists of:
+// - A header: the magic bytes "AMBMETRC", the format version (u32), the size of
+//   the header in bytes (u32), the run's random seed (u64), the number of run
+//   parameters (u32) followed by each parameter's key and value, and the
+//   number of columns (u32) followed by a directory entry for each column: its
+//   name, its type (u32; 0 for a count stored as i32 values, 1 for a measure
+//   stored as f64 values), a reserved u32, the byte offset of its data from the
+//   start of the file (u64), and its number of values (u64). Strings are stored
+//   as their UTF-8 byte length (u32) followed by their bytes.
+// - The column data in directory order, each column starting at an offset that
+//   is a multiple of 8 so that it can be accessed in place.
+
+#ifndef AMOEBOTSIM_CORE_METRICSARCHIVE_H_
+#define AMOEBOTSIM_CORE_METRICSARCHIVE_H_
+
+#include <utility>
+#include <vector>
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+#include <QtGlobal>
+
+#include "core/system.h"
+
+class MetricsArchive {
+ public:
+  enum class ColumnType : quint32 {
+    Count = 0,
+    Measure = 1
+  };
+
+  // A run parameter, given as a key and its value.
+  using Parameter = std::pair<QString, QString>;
+
+  // Writes the count and measure histories of the given system to an archive
+  // at the given path, together with the given run parameters and seed.
+  // Column data is read from the histories, converted, and written in
+  // fixed-size blocks, so the only memory used beyond the histories themselves
+  // is one block (even for histories spilled to disk). Pending parallel
+  // measures should be flushed first (see System::flushMeasures). Returns
+  // false if the file cannot be written.
+  static bool write(const QString filePath, const System& system,
+                    const std::vector<Parameter>& params, const quint64 seed);
+
+  // The magic bytes and version identifying the format.
+  static const char magic[8];
+  static const quint32 version = 1;
+
+ private:
+  // Number of bytes of column data converted and written at a time.
+  static const int blockSize = 1 << 16;
+};
+
+class MetricsArchiveReader {
+ public:
+  // A column of the archive. data points directly into the memory-mapped file
+  // and is valid as long as the reader remains open.
+  struct Column {
+    QString name;
+    MetricsArchive::ColumnType type;
+    quint64 numValues;
+    const uchar* data;
+  };
+
+  // Constructs a reader with no archive open.
+  MetricsArchiveReader();
+  ~MetricsArchiveReader();
+
+  // Memory-maps and validates the archive at the given path, closing any
+  // archive previously open. Returns false if the file cannot be mapped or is
+  // not a well-formed archive; error() then describes the problem.
+  bool open(const QString filePath);
+  void close();
+  QString error() const;
+
+  // Functions for accessing the open archive's header and columns. counts
+  // (resp., measures) returns the values of the column at the given index,
+  // which must be of type Count (resp., Measure), without copying them.
+  quint64 seed() const;
+  const std::vector<MetricsArchive::Parameter>& params() const;
+  const std::vector<Column>& columns() const;
+  const qint32* counts(const int column) const;
+  const double* measures(const int column) const;
+
+  // Formats the open archive as a metrics JSON string, in the structure
+  // produced by System::metricsAsJSON extended by the run's "seed" and
+  // "parameters" (see the Usage documentation). The "algorithm" is taken from
+  // the parameter of that name, if any. Measure values that are not finite
+  // are written as null.
+  QString toJSON() const;
+
+  // Converts the archive at binaryPath to a metrics JSON file at jsonPath.
+  // Returns false if the archive cannot be read or the file cannot be written.
+  static bool convertToJSON(const QString binaryPath, const QString jsonPath);
+
+ private:
+  // Reads a value (resp., string) at the given position of the mapped header,
+  // advancing the position. Both return false if doing so would read past the
+  // given end of the header.
+  template<class T>
+  bool read(quint64& pos, const quint64 end, T& value) const;
+  bool readString(quint64& pos, const quint64 end, QString& value) const;
+
+  // Closes the archive and records the given error message; returns false.
+  bool fail(const QString message);
+
+  QFile* _file;
+  const uchar* _data;
+  quint64 _size;
+  quint64 _seed;
+  std::vector<MetricsArchive::Parameter> _params;
+  std::vector<Column> _columns;
+  QString _error;
+};
+
+#endif  // AMOEBOTSIM_CORE_METRICSARCHIVE_H_
@@ -0,0 +1,185 @@
+/* Copyright (C) 2021 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+#include "core/metricssocket.h"
+
+#include <cerrno>
+#include <cstring>
+
+#include <QtEndian>
+
+#ifdef Q_OS_UNIX
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// Appends the little-endian representation of the given value to the buffer.
+template<class T>
+void append(QByteArray& buffer, const T value) {
+  const T le = qToLittleEndian(value);
+  buffer.append(reinterpret_cast<const char*>(&le), sizeof(T));
+}
+
+// Appends the given double as the little-endian representation of its bits.
+void appendDouble(QByteArray& buffer, const double value) {
+  quint64 bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  append<quint64>(buffer, bits);
+}
+
+// The number of values frames after which the names are sent again.
+const quint32 namesInterval = 256;
+
+}  // namespace
+
+MetricsSocket::MetricsSocket()
+  : _socket(-1),
+    _namesDue(false),
+    _sequence(0),
+    _numDropped(0) {}
+
+MetricsSocket::~MetricsSocket() {
+  close();
+}
+
+bool MetricsSocket::open(const QString socketPath,
+                         const std::vector<QString>& names, QString& error) {
+  close();
+
+#ifdef Q_OS_UNIX
+  sockaddr_un address;
+  std::memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  const QByteArray path = socketPath.toUtf8();
+  if (path.isEmpty() || path.size() >= int(sizeof(address.sun_path))) {
+    error = "invalid socket path " + socketPath;
+    return false;
+  }
+  std::memcpy(address.sun_path, path.constData(), path.size());
+
+  _socket = socket(AF_UNIX, SOCK_DGRAM, 0);
+  if (_socket == -1) {
+    error = "could not create socket";
+    return false;
+  }
+  fcntl(_socket, F_SETFL, fcntl(_socket, F_GETFL) | O_NONBLOCK);
+  _address = QByteArray(reinterpret_cast<const char*>(&address),
+                        sizeof(address));
+
+  _names.clear();
+  _names.append('N');
+  append<quint16>(_names, names.size());
+  for (size_t i = 0; i < names.size(); ++i) {
+    const QByteArray name = names[i].toUtf8();
+    append<quint16>(_names, name.size());
+    _names.append(name);
+    _indices[names[i]] = i;
+  }
+  _namesDue = true;
+  _rounds.assign(names.size(), 0);
+  _values.assign(names.size(), 0.0);
+  _isPending.assign(names.size(), false);
+  _sequence = 0;
+  _numDropped = 0;
+
+  return true;
+#else
+  Q_UNUSED(socketPath);
+  Q_UNUSED(names);
+  error = "metric sockets require a POSIX system";
+  return false;
+#endif
+}
+
+void MetricsSocket::close() {
+  if (_socket != -1) {
+#ifdef Q_OS_UNIX
+    ::close(_socket);
+#endif
+    _socket = -1;
+  }
+  _indices.clear();
+  _pending.clear();
+}
+
+bool MetricsSocket::isOpen() const {
+  return _socket != -1;
+}
+
+void MetricsSocket::write(const unsigned int round, const QString& name,
+                          const double value) {
+  if (_socket == -1) {
+    return;
+  }
+
+  const auto it = _indices.find(name);
+  if (it == _indices.end()) {
+    return;  // Metrics added after opening are not streamed.
+  }
+  const int i = it->second;
+  _rounds[i] = round;
+  _values[i] = value;
+  if (!_isPending[i]) {
+    _isPending[i] = true;
+    _pending.push_back(i);
+  }
+}
+
+void MetricsSocket::send() {
+  if (_socket == -1 || _pending.empty()) {
+    return;
+  }
+
+  _frame.clear();
+  _frame.append('V');
+  append<quint32>(_frame, _sequence);
+  append<quint32>(_frame, _numDropped);
+  append<quint16>(_frame, _pending.size());
+  for (const quint16 i : _pending) {
+    append<quint16>(_frame, i);
+    append<quint32>(_frame, _rounds[i]);
+    appendDouble(_frame, _values[i]);
+    _isPending[i] = false;
+  }
+  _pending.clear();
+
+  if (_sequence % namesInterval == 0) {
+    _namesDue = true;
+  }
+  if (_namesDue) {
+    _namesDue = !sendFrame(_names);
+  }
+  if (_namesDue || !sendFrame(_frame)) {
+    ++_numDropped;
+  }
+  ++_sequence;
+}
+
+quint32 MetricsSocket::numDropped() const {
+  return _numDropped;
+}
+
+bool MetricsSocket::sendFrame(const QByteArray& frame) {
+#ifdef Q_OS_UNIX
+  const sockaddr* address = reinterpret_cast<const sockaddr*>(
+      _address.constData());
+  if (sendto(_socket, frame.constData(), frame.size(), 0, address,
+             _address.size()) == frame.size()) {
+    return true;
+  }
+
+  // A full receive queue (EAGAIN or ENOBUFS) only drops this frame. A missing
+  // receiver may be replaced by one that has not seen the names yet.
+  if (errno != EAGAIN && errno != EWOULDBLOCK && errno != ENOBUFS) {
+    _namesDue = true;
+  }
+#else
+  Q_UNUSED(frame);
+#endif
+  return false;
+}
@@ -0,0 +1,83 @@
+/* Copyright (C) 2021 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+// Defines a stream that pushes metric values to a local process (e.g., a live
+// plot) over a Unix domain datagram socket, once per round. Values recorded
+// during a round are collected and sent as one frame after the round; a metric
+// recorded several times in between (e.g., on an activation schedule) is sent
+// with its latest value only. Frames are sent without waiting: if the receiver
+// is not keeping up or not listening, the frame is dropped and the simulation
+// continues, so a slow plot only sees fewer samples.
+//
+// Every datagram is one frame; all numbers are little-endian:
+// - A names frame lists the metrics, the counts first, then the measures:
+//   'N' (uint8), the number of metrics (uint16), and for each metric the
+//   length (uint16) and bytes of its name in UTF-8. Metrics are referred to by
+//   their position in this list. A names frame is sent before the first values
+//   frame, after a receiver was missing, and every 256 values frames, so
+//   receivers may start at any time.
+// - A values frame holds the values recorded since the previous one: 'V'
+//   (uint8), the frame's sequence number (uint32), the number of frames
+//   dropped so far (uint32), the number of values (uint16), and for each value
+//   the metric's position (uint16), the round in which it was recorded
+//   (uint32), and the value (float64).
+
+#ifndef AMOEBOTSIM_CORE_METRICSSOCKET_H_
+#define AMOEBOTSIM_CORE_METRICSSOCKET_H_
+
+#include <map>
+#include <vector>
+
+#include <QByteArray>
+#include <QString>
+#include <QtGlobal>
+
+class MetricsSocket {
+ public:
+  // Constructs a closed stream.
+  MetricsSocket();
+  ~MetricsSocket();
+
+  // Opens the stream to the socket a receiver binds at the given path, for the
+  // metrics with the given names, and closes any stream opened before. The
+  // receiver does not have to exist yet. Returns false and describes the
+  // problem in error if no socket can be created for the path.
+  bool open(const QString socketPath, const std::vector<QString>& names,
+            QString& error);
+  void close();
+  bool isOpen() const;
+
+  // Notes the given value of the named metric for the next frame, if the
+  // stream is open.
+  void write(const unsigned int round, const QString& name, const double value);
+
+  // Sends the values noted since the last frame, if any, without blocking.
+  void send();
+
+  // Returns the number of frames dropped since the stream was opened.
+  quint32 numDropped() const;
+
+ private:
+  // Sends the given frame, returning false if it was dropped.
+  bool sendFrame(const QByteArray& frame);
+
+  int _socket;
+  QByteArray _address;
+  std::map<QString, int> _indices;
+  QByteArray _names;
+  bool _namesDue;
+
+  // The latest value of each metric and the metrics having one not sent yet,
+  // in the order they were first noted.
+  std::vector<quint32> _rounds;
+  std::vector<double> _values;
+  std::vector<bool> _isPending;
+  std::vector<quint16> _pending;
+
+  QByteArray _frame;
+  quint32 _sequence;
+  quint32 _numDropped;
+};
+
+#endif  // AMOEBOTSIM_CORE_METRICSSOCKET_H_
@@ -0,0 +1,94 @@
+/* Copyright (C) 2021 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+#include "core/metricsstream.h"
+
+#include "core/jsonformat.h"
+
+MetricsStream::MetricsStream()
+  : _file(nullptr),
+    _format(Format::NDJSON) {}
+
+MetricsStream::~MetricsStream() {
+  close();
+}
+
+bool MetricsStream::open(const QString filePath, const Format format) {
+  close();
+
+  _file = new QFile(filePath);
+  if (!_file->open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+    delete _file;
+    _file = nullptr;
+    return false;
+  }
+
+  _format = format;
+  if (_format == Format::CSV) {
+    _file->write("round,activation,metric,value\n");
+  }
+
+  return true;
+}
+
+void MetricsStream::close() {
+  if (_file != nullptr) {
+    _file->close();
+    delete _file;
+    _file = nullptr;
+  }
+}
+
+bool MetricsStream::isOpen() const {
+  return _file != nullptr;
+}
+
+void MetricsStream::write(const unsigned int round,
+                          const unsigned int activation, const QString& name,
+                          const double value) {
+  if (_file == nullptr) {
+    return;
+  }
+
+  QString record;
+  if (_format == Format::NDJSON) {
+    record = "{\"round\" : " + QString::number(round) + ", \"activation\" : " +
+             QString::number(activation) + ", \"metric\" : " +
+             jsonString(name) + ", \"value\" : " + jsonNumber(value) + "}\n";
+  } else {
+    record = QString::number(round) + "," + QString::number(activation) +
+             "," + csvString(name) + "," + QString::number(value) + "\n";
+  }
+  _file->write(record.toUtf8());
+}
+
+void MetricsStream::flush() {
+  if (_file != nullptr) {
+    _file->flush();
+  }
+}
+
+QString MetricsStream::filePath() const {
+  return (_file != nullptr) ? _file->fileName() : "";
+}
+
+QString MetricsStream::formatName(const Format format) {
+  switch (format) {
+    case Format::NDJSON: return "ndjson";
+    case Format::CSV:    return "csv";
+  }
+
+  return "";
+}
+
+bool MetricsStream::formatFromName(const QString name, Format& format) {
+  for (auto f : {Format::NDJSON, Format::CSV}) {
+    if (QString::compare(formatName(f), name) == 0) {
+      format = f;
+      return true;
+    }
+  }
+
+  return false;
+}
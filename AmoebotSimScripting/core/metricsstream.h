@@ -0,0 +1,60 @@
+/* Copyright (C) 2021 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+// Defines a stream that appends metric values to a file as they are recorded,
+// so that exporting the metrics of a long run never has to serialize their
+// entire histories at once. Every record is one line holding the round and
+// activation at which a value was recorded, the metric's name, and the value:
+// - NDJSON writes one JSON object per line, e.g.,
+//   {"round" : 12, "activation" : 2400, "metric" : "Perimeter", "value" : 58}
+//   Values that are not finite (e.g., NaN) are written as null.
+// - CSV writes a header line "round,activation,metric,value" followed by one
+//   comma-separated record per line, with the metric's name quoted (and any
+//   quotes in it doubled).
+
+#ifndef AMOEBOTSIM_CORE_METRICSSTREAM_H_
+#define AMOEBOTSIM_CORE_METRICSSTREAM_H_
+
+#include <QFile>
+#include <QString>
+
+class MetricsStream {
+ public:
+  enum class Format {
+    NDJSON,
+    CSV
+  };
+
+  // Constructs a closed stream.
+  MetricsStream();
+  ~MetricsStream();
+
+  // Opens the stream on the file at the given path, replacing its contents, and
+  // closes any file it previously had open. Returns false if the file cannot be
+  // opened, in which case the stream is left closed.
+  bool open(const QString filePath, const Format format);
+  void close();
+  bool isOpen() const;
+
+  // Appends a record of the given value of the named metric, if the stream is
+  // open. Records are buffered; flush pushes them to disk.
+  void write(const unsigned int round, const unsigned int activation,
+             const QString& name, const double value);
+  void flush();
+
+  // Returns the file path of the open stream, or an empty string if closed.
+  QString filePath() const;
+
+  // Returns the name of the given format as used in scripts ("ndjson" or
+  // "csv"), and the format with the given name, respectively. formatFromName
+  // returns false if the name is not recognized.
+  static QString formatName(const Format format);
+  static bool formatFromName(const QString name, Format& format);
+
+ private:
+  QFile* _file;
+  Format _format;
+};
+
+#endif  // AMOEBOTSIM_CORE_METRICSSTREAM_H_
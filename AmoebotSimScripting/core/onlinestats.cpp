@@ -0,0 +1,194 @@
+/* Copyright (C) 2021 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+#include "core/onlinestats.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <QtGlobal>
+
+#include "core/jsonformat.h"
+
+OnlineStats::OnlineStats(const double alpha, const unsigned int maxLag)
+  : _alpha(alpha),
+    _maxLag(maxLag),
+    _n(0),
+    _mean(0),
+    _m2(0),
+    _min(0),
+    _max(0),
+    _ewma(0),
+    _shift(0),
+    _sum(0),
+    _lagProducts(maxLag, 0.0),
+    _heads(maxLag, 0.0) {
+  Q_ASSERT(0 < alpha && alpha <= 1);
+}
+
+void OnlineStats::push(const double x) {
+  ++_n;
+  if (_n == 1) {
+    _min = _max = _ewma = _shift = x;
+  } else {
+    _min = std::min(_min, x);
+    _max = std::max(_max, x);
+    _ewma += _alpha * (x - _ewma);
+  }
+
+  // Welford's update of the mean and the sum of squared deviations.
+  const double delta = x - _mean;
+  _mean += delta / _n;
+  _m2 += delta * (x - _mean);
+
+  const double y = x - _shift;
+  _sum += y;
+  if (_n <= _maxLag) {
+    for (unsigned int k = _n; k <= _maxLag; ++k) {
+      _heads[k - 1] += y;
+    }
+  }
+  for (unsigned int k = 1; k <= _recent.size(); ++k) {
+    _lagProducts[k - 1] += y * _recent[k - 1];
+  }
+  _recent.push_front(y);
+  if (_recent.size() > _maxLag) {
+    _recent.pop_back();
+  }
+}
+
+unsigned long long OnlineStats::count() const {
+  return _n;
+}
+
+double OnlineStats::mean() const {
+  return _mean;
+}
+
+double OnlineStats::variance() const {
+  return (_n > 1) ? _m2 / (_n - 1) : 0.0;
+}
+
+double OnlineStats::stdDev() const {
+  return std::sqrt(variance());
+}
+
+double OnlineStats::min() const {
+  return _min;
+}
+
+double OnlineStats::max() const {
+  return _max;
+}
+
+double OnlineStats::ewma() const {
+  return _ewma;
+}
+
+double OnlineStats::alpha() const {
+  return _alpha;
+}
+
+unsigned int OnlineStats::maxLag() const {
+  return _maxLag;
+}
+
+double OnlineStats::autocorrelation(const unsigned int lag) const {
+  Q_ASSERT(1 <= lag && lag <= _maxLag);
+
+  if (_n <= lag || _m2 <= 0) {
+    return 0.0;
+  }
+
+  // sum_{t>lag} (y_t - ybar) * (y_{t-lag} - ybar), normalized by the sum of
+  // squared deviations.
+  double tail = 0;
+  for (unsigned int k = 0; k < lag; ++k) {
+    tail += _recent[k];
+  }
+  const double ybar = _sum / _n;
+  const double cov = _lagProducts[lag - 1] -
+                     ybar * ((_sum - _heads[lag - 1]) + (_sum - tail)) +
+                     (_n - lag) * ybar * ybar;
+
+  return cov / _m2;
+}
+
+double OnlineStats::effectiveSampleSize() const {
+  double sumRho = 0;
+  for (unsigned int k = 1; k <= _maxLag; ++k) {
+    const double rho = autocorrelation(k);
+    if (rho <= 0) {
+      break;
+    }
+    sumRho += rho;
+  }
+
+  return _n / (1 + 2 * sumRho);
+}
+
+QString OnlineStats::toJSON() const {
+  QString json = "{\"count\" : " + QString::number(_n) + ", ";
+  json += "\"mean\" : " + jsonNumber(mean()) + ", ";
+  json += "\"variance\" : " + jsonNumber(variance()) + ", ";
+  json += "\"min\" : " + jsonNumber(min()) + ", ";
+  json += "\"max\" : " + jsonNumber(max()) + ", ";
+  json += "\"ewma\" : " + jsonNumber(ewma()) + ", ";
+  json += "\"autocorrelation\" : [";
+  for (unsigned int k = 1; k <= _maxLag; ++k) {
+    json += jsonNumber(autocorrelation(k)) + ", ";
+  }
+  if (_maxLag > 0) {
+    json.chop(2);  // Remove the last ", ".
+  }
+  json += "], \"ess\" : " + jsonNumber(effectiveSampleSize()) + "}";
+
+  return json;
+}
+
+void OnlineStats::save(QDataStream& out) const {
+  out << _alpha << static_cast<quint32>(_maxLag) << static_cast<quint64>(_n)
+      << _mean << _m2 << _min << _max << _ewma << _shift << _sum;
+  for (unsigned int k = 0; k < _maxLag; ++k) {
+    out << _lagProducts[k] << _heads[k];
+  }
+  out << static_cast<quint32>(_recent.size());
+  for (const double y : _recent) {
+    out << y;
+  }
+}
+
+std::unique_ptr<OnlineStats> OnlineStats::load(QDataStream& in) {
+  double alpha;
+  quint32 maxLag;
+  in >> alpha >> maxLag;
+  if (in.status() != QDataStream::Ok || !(0 < alpha && alpha <= 1)) {
+    return nullptr;
+  }
+
+  std::unique_ptr<OnlineStats> stats(new OnlineStats(alpha, maxLag));
+  quint64 n;
+  in >> n >> stats->_mean >> stats->_m2 >> stats->_min >> stats->_max
+     >> stats->_ewma >> stats->_shift >> stats->_sum;
+  stats->_n = n;
+  for (unsigned int k = 0; k < maxLag; ++k) {
+    in >> stats->_lagProducts[k] >> stats->_heads[k];
+  }
+  quint32 numRecent;
+  in >> numRecent;
+  if (numRecent > maxLag) {
+    return nullptr;
+  }
+  for (unsigned int i = 0; i < numRecent; ++i) {
+    double y;
+    in >> y;
+    stats->_recent.push_back(y);
+  }
+
+  if (in.status() != QDataStream::Ok) {
+    return nullptr;
+  }
+
+  return stats;
+}
@@ -0,0 +1,79 @@
+/* Copyright (C) 2021 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+// Defines streaming summary statistics of a sequence of values, maintained in
+// O(maxLag) memory and O(maxLag) time per value without storing the sequence:
+// - the mean and variance, using Welford's numerically stable update;
+// - the minimum and maximum;
+// - an exponentially weighted moving average with smoothing factor alpha;
+// - the autocorrelation at lags 1, ..., maxLag; and
+// - the effective sample size n / (1 + 2 * sum_k rho_k), summing the
+//   autocorrelations rho_k up to (but excluding) the first non-positive one,
+//   which estimates how many independent samples the sequence is worth.
+
+#ifndef AMOEBOTSIM_CORE_ONLINESTATS_H_
+#define AMOEBOTSIM_CORE_ONLINESTATS_H_
+
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include <QDataStream>
+#include <QString>
+
+class OnlineStats {
+ public:
+  // Constructs empty statistics with the given EWMA smoothing factor, which
+  // must lie in (0,1], and maximum autocorrelation lag.
+  OnlineStats(const double alpha = 0.1, const unsigned int maxLag = 10);
+
+  // Adds the given value to the sequence.
+  void push(const double x);
+
+  // Functions for querying the statistics. variance is the unbiased sample
+  // variance. autocorrelation returns the sample autocorrelation at the given
+  // lag in [1, maxLag], or 0 if it is not defined yet. All functions return 0
+  // for sequences too short to define them.
+  unsigned long long count() const;
+  double mean() const;
+  double variance() const;
+  double stdDev() const;
+  double min() const;
+  double max() const;
+  double ewma() const;
+  double alpha() const;
+  unsigned int maxLag() const;
+  double autocorrelation(const unsigned int lag) const;
+  double effectiveSampleSize() const;
+
+  // Formats the statistics as a JSON object; see the Usage documentation.
+  QString toJSON() const;
+
+  // Functions for checkpointing the statistics (see amoebotsystem.h). save
+  // writes their parameters and complete state to the given stream, and load
+  // reads statistics written by save, returning null if the stream is
+  // malformed.
+  void save(QDataStream& out) const;
+  static std::unique_ptr<OnlineStats> load(QDataStream& in);
+
+ private:
+  const double _alpha;
+  const unsigned int _maxLag;
+
+  unsigned long long _n;
+  double _mean, _m2, _min, _max, _ewma;
+
+  // The autocovariances are computed from sums of the values shifted by the
+  // first value, which avoids cancellation for values far from zero. For each
+  // lag k, _lagProducts[k-1] sums y_t * y_{t-k} and _heads[k-1] sums the first
+  // k shifted values. _recent holds the last maxLag shifted values, newest
+  // first; the sum of its first k entries is that of the last k values.
+  double _shift;
+  double _sum;
+  std::vector<double> _lagProducts;
+  std::vector<double> _heads;
+  std::deque<double> _recent;
+};
+
+#endif  // AMOEBOTSIM_CORE_ONLINESTATS_H_
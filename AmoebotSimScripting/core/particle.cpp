@@ -6,9 +6,10 @@
 
 #include <QtGlobal>
 
-Particle::Particle(const Node& head, int globalTailDir)
+Particle::Particle(const Node& head, int globalTailDir, const Lattice& lattice)
   : head(head),
-    globalTailDir(globalTailDir) {
+    globalTailDir(globalTailDir),
+    lattice(lattice) {
   Q_ASSERT(-1 <= globalTailDir && globalTailDir < 6);
 }
 
@@ -24,7 +25,7 @@ Node Particle::tail() const {
   Q_ASSERT(isExpanded());
   Q_ASSERT(-1 <= globalTailDir && globalTailDir < 6);
 
-  return head.nodeInDir(globalTailDir);
+  return lattice.nodeInDir(head, globalTailDir);
 }
 
 int Particle::headMarkColor() const {
@@ -12,13 +12,16 @@
 
 #include <QString>
 
+#include "core/lattice.h"
 #include "core/node.h"
 
 class Particle {
  public:
-  // Constructs a new particle with a node position for its head and a global
-  // compass direction from its head to its tail (-1 if contracted).
-  Particle(const Node& head = Node(), int globalTailDir = -1);
+  // Constructs a new particle with a node position for its head, a global
+  // compass direction from its head to its tail (-1 if contracted), and the
+  // lattice it lives on.
+  Particle(const Node& head = Node(), int globalTailDir = -1,
+           const Lattice& lattice = Lattice());
 
   // Functions for checking whether the particle is contracted or expanded.
   bool isContracted() const;
@@ -54,6 +57,7 @@ class Particle {
 
   Node head;
   int globalTailDir;
+  Lattice lattice;
 };
 
 #endif  // AMOEBOTSIM_CORE_PARTICLE_H_
@@ -0,0 +1,201 @@
+/* Copyright (C) 2021 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+#include "core/replaysystem.h"
+
+#include <QDateTime>
+#include <QtGlobal>
+
+#include "core/jsonformat.h"
+
+ReplayParticle::ReplayParticle(const quint32 id, const ParticleRecord& record,
+                               const Lattice& lattice)
+  : Particle(record.head, record.globalTailDir, lattice),
+    id(id),
+    state(record.state),
+    direction(record.direction) {}
+
+int ReplayParticle::headMarkColor() const {
+  static const int palette[] = {0xff0000, 0x0000ff, 0x00ff00, 0x000000,
+                                0xff9000, 0xffff00, 0x00ffff, 0x9000ff,
+                                0xff00ff, 0x808080};
+  static const int paletteSize = sizeof(palette) / sizeof(palette[0]);
+
+  return (state < 0) ? -1 : palette[state % paletteSize];
+}
+
+int ReplayParticle::tailMarkColor() const {
+  return headMarkColor();
+}
+
+int ReplayParticle::headMarkGlobalDir() const {
+  return direction;
+}
+
+QString ReplayParticle::inspectionText() const {
+  QString text;
+  text += "Global Info:\n";
+  text += "  id: " + QString::number(id) + "\n";
+  text += "  head: (" + QString::number(head.x) + ", "
+                      + QString::number(head.y) + ")\n";
+  text += "  globalTailDir: " + QString::number(globalTailDir) + "\n\n";
+  text += "Recorded Info:\n";
+  text += "  state: " + QString::number(state) + "\n";
+  text += "  direction: " + QString::number(direction) + "\n";
+
+  return text;
+}
+
+ReplaySystem::ReplaySystem()
+  : _speed(1) {
+  _counts.push_back(new Count("# Rounds"));
+}
+
+ReplaySystem::~ReplaySystem() {
+  for (auto o : _objects) {
+    delete o;
+  }
+  for (auto c : _counts) {
+    delete c;
+  }
+}
+
+bool ReplaySystem::open(const QString filePath, QString& error) {
+  if (!_reader.open(filePath)) {
+    error = _reader.error();
+    return false;
+  }
+  update();
+
+  return true;
+}
+
+void ReplaySystem::seek(const unsigned int round) {
+  _reader.seek(round);
+  update();
+}
+
+void ReplaySystem::setSpeed(const unsigned int rounds) {
+  Q_ASSERT(rounds >= 1);
+  _speed = rounds;
+}
+
+unsigned int ReplaySystem::speed() const {
+  return _speed;
+}
+
+unsigned int ReplaySystem::firstRound() const {
+  return _reader.firstRound();
+}
+
+unsigned int ReplaySystem::lastRound() const {
+  return _reader.lastRound();
+}
+
+unsigned int ReplaySystem::round() const {
+  return _reader.round();
+}
+
+void ReplaySystem::activate() {
+  // Rounds are replayed as deltas; the particles are only rebuilt once.
+  bool advanced = false;
+  for (unsigned int i = 0; i < _speed && _reader.next(); ++i) {
+    advanced = true;
+  }
+  if (advanced) {
+    update();
+  }
+}
+
+void ReplaySystem::activateParticleAt(Node) {}
+
+unsigned int ReplaySystem::size() const {
+  return _particles.size();
+}
+
+unsigned int ReplaySystem::numObjects() const {
+  return _objects.size();
+}
+
+const Particle& ReplaySystem::at(int i) const {
+  return _particles.at(i);
+}
+
+const std::deque<Object*>& ReplaySystem::getObjects() const {
+  return _objects;
+}
+
+const std::vector<Count*>& ReplaySystem::getCounts() const {
+  return _counts;
+}
+
+const std::vector<Measure*>& ReplaySystem::getMeasures() const {
+  return _measures;
+}
+
+Count& ReplaySystem::getCount(QString name) const {
+  for (const auto& c : _counts) {
+    if (QString::compare(c->_name, name) == 0) {
+      return *c;
+    }
+  }
+  Q_ASSERT(false);  // Requested count does not exist.
+}
+
+Measure& ReplaySystem::getMeasure(QString) const {
+  Q_ASSERT(false);  // Replays have no measures.
+}
+
+const QString ReplaySystem::metricsAsJSON() const {
+  QString json = "{\"title\" : \"AmoebotSim Metrics JSON\", ";
+  json += "\"datetime\" : \"" +
+          QDateTime::currentDateTime().toString("yyyy-MM-dd HH:mm:ss") + "\", ";
+  json += "\"algorithm\" : \"replay\", ";
+
+  // The recorded run counted one more round at the end of each round, so the
+  // "# Rounds" history of the replayed span is the sequence of shown rounds.
+  json += "\"counts\" : [{\"name\" : " + jsonString("# Rounds") + ", ";
+  json += "\"historyPolicy\" : \"" +
+          History<int>::policyName(History<int>::Policy::Unbounded) + "\", ";
+  json += "\"history\" : [";
+  for (unsigned int r = firstRound(); r < round(); ++r) {
+    json += QString::number(r) + ", ";
+  }
+  if (round() > firstRound()) {
+    json.chop(2);  // Remove the last ", ".
+  }
+  json += "]}], \"measures\" : []}";
+
+  return json;
+}
+
+bool ReplaySystem::hasTerminated() const {
+  return _reader.round() >= _reader.lastRound();
+}
+
+void ReplaySystem::update() {
+  _particles.clear();
+  _particles.reserve(_reader.particles().size());
+  for (const auto& p : _reader.particles()) {
+    _particles.emplace_back(p.first, p.second, _reader.lattice());
+  }
+  getCount("# Rounds")._value = _reader.round();
+
+  // Objects only change at keyframes, so they are rebuilt only if they differ
+  // from the ones shown.
+  const std::vector<Node>& objects = _reader.objects();
+  bool changed = (objects.size() != _objects.size());
+  for (unsigned int i = 0; i < objects.size() && !changed; ++i) {
+    changed = (_objects[i]->_node != objects[i]);
+  }
+  if (changed) {
+    for (auto o : _objects) {
+      delete o;
+    }
+    _objects.clear();
+    for (const auto& node : objects) {
+      _objects.push_back(new Object(node));
+    }
+  }
+}
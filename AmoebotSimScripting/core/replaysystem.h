@@ -0,0 +1,114 @@
+/* Copyright (C) 2021 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+// Defines a system that plays back a recorded trajectory (see trajectory.h)
+// instead of running an algorithm. Each activation advances the playback by a
+// configurable number of rounds, so the simulator's start, stop, and step
+// controls and its step duration drive the playback like a live run, and seek
+// jumps to any recorded round via the nearest keyframe. No algorithm code runs
+// during a replay: particles only carry their recorded state, which determines
+// their color (see ReplayParticle), and objects and metrics other than the
+// number of rounds are not part of trajectories.
+
+#ifndef AMOEBOTSIM_CORE_REPLAYSYSTEM_H_
+#define AMOEBOTSIM_CORE_REPLAYSYSTEM_H_
+
+#include <deque>
+#include <vector>
+
+#include <QString>
+
+#include "core/lattice.h"
+#include "core/metric.h"
+#include "core/node.h"
+#include "core/object.h"
+#include "core/particle.h"
+#include "core/system.h"
+#include "core/trajectory.h"
+
+class ReplayParticle : public Particle {
+ public:
+  // Constructs a particle with the given id and recorded position and state on
+  // the given lattice.
+  ReplayParticle(const quint32 id, const ParticleRecord& record,
+                 const Lattice& lattice);
+
+  // Colors the particle by its recorded state using a fixed palette, starting
+  // with the colors compression uses for its states (red, blue, green, black).
+  // Negative states are drawn without color.
+  int headMarkColor() const override;
+  int tailMarkColor() const override;
+
+  // Draws the particle's recorded direction marker at its head.
+  int headMarkGlobalDir() const override;
+
+  // Returns the particle's id, recorded state, and recorded direction.
+  QString inspectionText() const override;
+
+  const quint32 id;
+  const int state;
+  const int direction;
+};
+
+class ReplaySystem : public System {
+ public:
+  // Constructs a system with no trajectory loaded.
+  ReplaySystem();
+  ~ReplaySystem();
+
+  // Loads the trajectory at the given path and shows its first round on the
+  // lattice it was recorded on. Returns false and describes the problem in
+  // error if the file is not a trajectory.
+  bool open(const QString filePath, QString& error);
+
+  // Functions for controlling the playback. seek shows the given round, clamped
+  // to the recorded ones. setSpeed sets the number of rounds each activation
+  // advances the playback by. firstRound, lastRound, and round return the
+  // first, last, and currently shown round.
+  void seek(const unsigned int round);
+  void setSpeed(const unsigned int rounds);
+  unsigned int speed() const;
+  unsigned int firstRound() const;
+  unsigned int lastRound() const;
+  unsigned int round() const;
+
+  // Advances the playback by speed rounds. Activating single particles has no
+  // meaning in a replay and does nothing.
+  void activate() final;
+  void activateParticleAt(Node node) final;
+
+  unsigned int size() const final;
+  unsigned int numObjects() const final;
+  const Particle& at(int i) const final;
+  const std::deque<Object*>& getObjects() const final;
+
+  // Metrics functions. A replay has the single count "# Rounds", holding the
+  // currently shown round, and no measures; metricsAsJSON lists the rounds
+  // from the first recorded one up to the shown one as its history.
+  // Functions for scheduling, streaming, or monitoring metrics, checkpoints,
+  // recording, exports, telemetry, and layouts are only offered by
+  // AmoebotSystem (see amoebotsystem.h).
+  const std::vector<Count*>& getCounts() const final;
+  const std::vector<Measure*>& getMeasures() const final;
+  Count& getCount(QString name) const final;
+  Measure& getMeasure(QString name) const final;
+  const QString metricsAsJSON() const final;
+
+  // A replay terminates once it shows the last recorded round.
+  bool hasTerminated() const final;
+
+ private:
+  // Rebuilds the particles and objects from the reader's current
+  // configuration.
+  void update();
+
+  TrajectoryReader _reader;
+  unsigned int _speed;
+  std::vector<ReplayParticle> _particles;
+  std::deque<Object*> _objects;
+  std::vector<Count*> _counts;
+  std::vector<Measure*> _measures;
+};
+
+#endif  // AMOEBOTSIM_CORE_REPLAYSYSTEM_H_
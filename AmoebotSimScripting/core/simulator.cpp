@@ -4,6 +4,8 @@
 
 #include "core/simulator.h"
 
+#include <algorithm>
+
 #include <QCoreApplication>
 #include <QDateTime>
 #include <QDir>
@@ -12,7 +14,9 @@
 #include <QTextStream>
 #include <QtGlobal>
 
+#include "core/amoebotsystem.h"
 #include "core/metric.h"
+#include "core/replaysystem.h"
 
 Simulator::Simulator() {
   stepTimer.setInterval(100);
@@ -35,6 +39,12 @@ std::shared_ptr<System> Simulator::getSystem() const {
   return system;
 }
 
+bool Simulator::hasFinished(const System& system) {
+  const auto amoebotSystem = dynamic_cast<const AmoebotSystem*>(&system);
+  return system.hasTerminated() ||
+         (amoebotSystem != nullptr && amoebotSystem->hasConverged());
+}
+
 void Simulator::start() {
   stepTimer.start();
   emit started();
@@ -49,7 +59,7 @@ void Simulator::step() {
   QMutexLocker locker(&system->mutex);
   system->activate();
 
-  if (system->hasTerminated()) {
+  if (hasFinished(*system)) {
     stop();
   }
 }
@@ -66,7 +76,7 @@ void Simulator::setStepDuration(int ms) {
 
 void Simulator::runUntilTermination() {
   QMutexLocker locker(&system->mutex);
-  while (!system->hasTerminated()) {
+  while (!hasFinished(*system)) {
     system->activate();
   }
 }
@@ -83,22 +93,36 @@ int Simulator::numObjects() const {
 
 QVariant Simulator::metrics() const {
   QMutexLocker locker(&system->mutex);
+  const auto amoebotSystem = dynamic_cast<AmoebotSystem*>(system.get());
+  if (amoebotSystem != nullptr) {
+    amoebotSystem->flushMeasures(false);
+  }
   QList<QVariant> metricsData;
   for (const auto& c : system->getCounts()) {
     metricsData.push_back(QVariant({c->_name, c->_value}));
   }
   for (const auto& m : system->getMeasures()) {
-    if (m->_history.empty()) {
-      metricsData.push_back(QVariant({m->_name, 0.0}));
-    } else {
-      metricsData.push_back(QVariant({m->_name, m->_history.back()}));
-    }
+    metricsData.push_back(QVariant({m->_name, m->value()}));
   }
   return QVariant::fromValue(metricsData);
 }
 
 void Simulator::exportMetrics() {
-  QMutexLocker locker(&system->mutex);
+  QString json;
+  {
+    QMutexLocker locker(&system->mutex);
+    // A metrics stream already holds every recorded value; exporting then only
+    // needs to flush it.
+    const auto amoebotSystem = dynamic_cast<AmoebotSystem*>(system.get());
+    if (amoebotSystem != nullptr) {
+      if (amoebotSystem->flushMetricsStream()) {
+        return;
+      }
+      amoebotSystem->flushMeasures(true);
+    }
+    json = system->metricsAsJSON();
+  }
+
   QDir metricsDir(QCoreApplication::applicationDirPath());
   #ifdef Q_OS_MACOS
     metricsDir.cd("../../..");  // Escape the macOS application bundle.
@@ -113,10 +137,47 @@ void Simulator::exportMetrics() {
     return;
   }
   QTextStream outStream(&outFile);
-  outStream << system->metricsAsJSON();
+  outStream << json;
   outFile.close();
 }
 
+void Simulator::openReplay(const QString filePath) {
+  auto replay = std::make_shared<ReplaySystem>();
+  QString error;
+  if (!replay->open(filePath, error)) {
+    emit log("Could not open replay: " + error, true);
+    return;
+  }
+  setSystem(replay);
+}
+
+void Simulator::seekReplay(int round) {
+  auto replay = std::dynamic_pointer_cast<ReplaySystem>(system);
+  if (replay != nullptr) {
+    QMutexLocker locker(&system->mutex);
+    replay->seek(std::max(round, 0));
+  }
+}
+
+void Simulator::setReplaySpeed(int rounds) {
+  auto replay = std::dynamic_pointer_cast<ReplaySystem>(system);
+  if (replay != nullptr) {
+    QMutexLocker locker(&system->mutex);
+    replay->setSpeed(std::max(rounds, 1));
+  }
+}
+
+QVariant Simulator::replayInfo() const {
+  QList<QVariant> info;
+  auto replay = std::dynamic_pointer_cast<ReplaySystem>(system);
+  if (replay != nullptr) {
+    QMutexLocker locker(&system->mutex);
+    info = {replay->firstRound(), replay->lastRound(), replay->round(),
+            replay->speed()};
+  }
+  return QVariant::fromValue(info);
+}
+
 void Simulator::saveScreenshotSetup(const QString filePath) {
   emit systemChanged(system);
   emit saveScreenshot(filePath);
@@ -23,6 +23,10 @@ class Simulator : public QObject {
   void setSystem(std::shared_ptr<System> _system);
   std::shared_ptr<System> getSystem() const;
 
+  // Checks whether the given system has terminated or, if it runs an algorithm
+  // (see amoebotsystem.h), its monitored measures have converged.
+  static bool hasFinished(const System& system);
+
  signals:
   void systemChanged(std::shared_ptr<System> _system);
   void stepDurationChanged(int ms);
@@ -31,12 +35,17 @@ class Simulator : public QObject {
   void started();
   void stopped();
 
+  // Reports messages (e.g., failures to open a replay) to the GUI.
+  void log(const QString msg, const bool isError);
+
  public slots:
   // Responds to control flow signals from the GUI and scripts. Start, stop, and
   // step are self-explanatory. stepForParticleAt executes one activation for
   // the specific particle at the given node. setStepDuration updates the delay
   // in milliseconds between particle activations. runUntilTermination activates
-  // particles repeatedly until the hasTerminated condition is satisfied.
+  // particles repeatedly until the hasTerminated condition is satisfied or the
+  // system's monitored measures have converged (see amoebotsystem.h); running
+  // and stepping stop in either case as well.
   void start();
   void stop();
   void step();
@@ -49,11 +58,25 @@ class Simulator : public QObject {
   int numObjects() const;
   QVariant metrics() const;
 
-  // Responds to the exportMetrics signal from the GUI and scripts by creating
-  // an output file with a unique timestamp (to avoid accidental overwrites) and
-  // writing the metrics JSON to it.
+  // Responds to the exportMetrics signal from the GUI and scripts. If the
+  // system is streaming its metrics (see amoebotsystem.h), the stream is
+  // flushed. Otherwise, an output file with a unique timestamp (to avoid
+  // accidental overwrites) is created and the metrics JSON is written to it;
+  // the system is only locked while the JSON is generated, not while written.
   void exportMetrics();
 
+  // Responds to replay requests from the GUI and scripts (see replaysystem.h).
+  // openReplay replaces the current system by a replay of the trajectory at
+  // the given path, logging an error if it cannot be opened. seekReplay jumps
+  // to the given round and setReplaySpeed sets the number of rounds every step
+  // advances the replay by; both do nothing unless a replay is shown.
+  // replayInfo returns the first, last, and current round of the replay and
+  // its speed as a list, which is empty if no replay is shown.
+  void openReplay(const QString filePath);
+  void seekReplay(int round);
+  void setReplaySpeed(int rounds);
+  QVariant replayInfo() const;
+
   // Emits a signal that updates the system visually, followed by a signal that
   // takes a screenshot of the result.
   void saveScreenshotSetup(const QString filePath);
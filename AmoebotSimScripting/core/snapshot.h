@@ -0,0 +1,37 @@
+/* Copyright (C) 2021 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+// Defines an immutable copy of a particle system's configuration. Snapshots
+// are plain arrays of particle records, so taking one is a single linear copy
+// and, once taken, a snapshot can be shared by any number of threads without
+// locking while the live system keeps changing (see AmoebotSystem's parallel
+// measures).
+
+#ifndef AMOEBOTSIM_CORE_SNAPSHOT_H_
+#define AMOEBOTSIM_CORE_SNAPSHOT_H_
+
+#include <vector>
+
+#include "core/node.h"
+
+// The position of a particle, given by its head and global tail direction (-1
+// if contracted), its algorithm-specific state (see
+// AmoebotParticle::stateCode), and the global direction of its direction
+// marker (see AmoebotParticle::headMarkGlobalDir; -1 if it has none).
+struct ParticleRecord {
+  Node head;
+  int globalTailDir;
+  int state;
+  int direction;
+};
+
+struct Snapshot {
+  // The number of completed rounds and activations when the snapshot was
+  // taken, and the records of all particles in the system's particle order.
+  unsigned int round;
+  unsigned int activation;
+  std::vector<ParticleRecord> particles;
+};
+
+#endif  // AMOEBOTSIM_CORE_SNAPSHOT_H_
@@ -0,0 +1,68 @@
+/* Copyright (C) 2021 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+// Defines an exporter that writes the configuration of an AmoebotSystem as a
+// NumPy archive (.npz), so that snapshots can be analyzed with
+// numpy.load(filePath) without parsing any text. An archive holds one array
+// per attribute, with one entry per particle in the system's particle order:
+// - "x", "y" (int32): the coordinates of the particle's head.
+// - "tail_dir" (int8): the global direction from head to tail, -1 if
+//   contracted.
+// - "state" (int32): the algorithm-specific state (see
+//   AmoebotParticle::stateCode).
+// - "direction" (int8): the global direction of the particle's direction
+//   marker (see AmoebotParticle::headMarkGlobalDir), -1 if it has none.
+// - "round" (uint32): a single entry holding the number of completed rounds.
+// The exporter copies the particles into these arrays once and writes each of
+// them in a single block, stored uncompressed, so exporting costs about as
+// much as copying the configuration twice.
+
+#ifndef AMOEBOTSIM_CORE_SNAPSHOTEXPORTER_H_
+#define AMOEBOTSIM_CORE_SNAPSHOTEXPORTER_H_
+
+#include <vector>
+
+#include <QString>
+#include <QtGlobal>
+
+#include "core/systemobserver.h"
+
+// AmoebotSystem must be forward declared to avoid a cyclic dependency.
+class AmoebotSystem;
+
+class SnapshotExporter : public SystemObserver {
+ public:
+  // Constructs an exporter of the given system that does not export
+  // periodically.
+  SnapshotExporter(AmoebotSystem& system);
+  ~SnapshotExporter();
+
+  // Writes the system's current configuration, labeled with its number of
+  // completed rounds, to the archive at the given path, replacing its contents.
+  // Returns false and describes the problem in error if the file cannot be
+  // written.
+  bool exportSnapshot(const QString filePath, QString& error);
+
+  // Exports the configuration after every rounds-th round to the file
+  // <pathPrefix>_<round>.npz; 0 rounds stops periodic exports.
+  void setInterval(const QString pathPrefix, const unsigned int rounds);
+
+  // Event handler; see systemobserver.h.
+  void onRound(const unsigned int round) override;
+
+ private:
+  AmoebotSystem& _system;
+  QString _pathPrefix;
+  unsigned int _interval;
+
+  // Staging arrays, kept between exports so that periodic exports do not
+  // allocate.
+  std::vector<qint32> _x;
+  std::vector<qint32> _y;
+  std::vector<qint8> _tailDir;
+  std::vector<qint32> _state;
+  std::vector<qint8> _direction;
+};
+
+#endif  // AMOEBOTSIM_CORE_SNAPSHOTEXPORTER_H_
@@ -0,0 +1,21 @@
+/* Copyright (C) 2021 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+#include "core/systemobserver.h"
+
+SystemObserver::~SystemObserver() {}
+
+void SystemObserver::onInsert(const AmoebotParticle&) {}
+
+void SystemObserver::onRemove(const AmoebotParticle&) {}
+
+void SystemObserver::onMove(const AmoebotParticle&, const Node&, const int) {}
+
+void SystemObserver::onStateChange(const AmoebotParticle&, const int,
+                                   const int) {}
+
+void SystemObserver::onDirectionChange(const AmoebotParticle&, const int,
+                                       const int) {}
+
+void SystemObserver::onRound(const unsigned int) {}
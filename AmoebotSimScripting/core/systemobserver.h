@@ -0,0 +1,49 @@
+/* Copyright (C) 2021 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+// Defines an interface for objects that follow the events changing an
+// AmoebotSystem, such as measures that keep running totals instead of scanning
+// all particles whenever they are calculated. Observers are registered with
+// AmoebotSystem::addObserver and override only the events they care about; the
+// default implementations do nothing. A system without observers does not pay
+// for any notifications beyond an emptiness check.
+
+#ifndef AMOEBOTSIM_CORE_SYSTEMOBSERVER_H_
+#define AMOEBOTSIM_CORE_SYSTEMOBSERVER_H_
+
+#include "core/node.h"
+
+// AmoebotParticle must be forward declared to avoid a cyclic dependency.
+class AmoebotParticle;
+
+class SystemObserver {
+ public:
+  virtual ~SystemObserver();
+
+  // Called after the given particle is inserted into the system and just before
+  // it is removed from the system (and deleted), respectively.
+  virtual void onInsert(const AmoebotParticle& particle);
+  virtual void onRemove(const AmoebotParticle& particle);
+
+  // Called after the given particle moves (expands, contracts, or takes part
+  // in a handover) with the head and global tail direction it had before.
+  virtual void onMove(const AmoebotParticle& particle, const Node& oldHead,
+                      const int oldTailDir);
+
+  // Called after the given particle's algorithm-specific state changes. States
+  // are encoded as integers by the algorithm (e.g., by casting its State enum).
+  virtual void onStateChange(const AmoebotParticle& particle,
+                             const int oldState, const int newState);
+
+  // Called after the global direction of the given particle's direction marker
+  // changes (see AmoebotParticle::headMarkGlobalDir; -1 if it has none).
+  virtual void onDirectionChange(const AmoebotParticle& particle,
+                                 const int oldDir, const int newDir);
+
+  // Called after the system completes a round with the number of rounds
+  // completed so far.
+  virtual void onRound(const unsigned int round);
+};
+
+#endif  // AMOEBOTSIM_CORE_SYSTEMOBSERVER_H_
@@ -0,0 +1,228 @@
+/* Copyright (C) 2021 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+#include "core/telemetrypublisher.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#include <QByteArray>
+#include <QDateTime>
+
+#ifdef Q_OS_UNIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "core/amoebotparticle.h"
+#include "core/amoebotsystem.h"
+
+static_assert(sizeof(TelemetryHeader) == 88 &&
+              sizeof(TelemetryMetric) == 64,
+              "the telemetry layout is fixed; see telemetrypublisher.h");
+
+namespace {
+
+// Copies the given name into the given metric entry, truncating it (at a
+// character boundary) to leave room for the terminating zero.
+void setName(TelemetryMetric& metric, const QString& name) {
+  const QByteArray utf8 = name.toUtf8();
+  const int size = utf8.size();
+  int length = std::min(size, int(sizeof(metric.name)) - 1);
+  if (length < size) {
+    while (length > 0 && (uchar(utf8[length]) & 0xc0) == 0x80) {
+      --length;
+    }
+  }
+  std::memset(metric.name, 0, sizeof(metric.name));
+  std::memcpy(metric.name, utf8.constData(), length);
+}
+
+}  // namespace
+
+TelemetryPublisher::TelemetryPublisher(AmoebotSystem& system)
+  : _system(system),
+    _interval(0),
+    _segment(nullptr),
+    _metrics(maxMetrics),
+    _image(maxImageSize * maxImageSize),
+    _cellCounts(maxImageSize * maxImageSize) {}
+
+TelemetryPublisher::~TelemetryPublisher() {
+  close();
+}
+
+bool TelemetryPublisher::open(const QString name, const unsigned int rounds,
+                              QString& error) {
+  close();
+
+#ifdef Q_OS_UNIX
+  // POSIX names start with their only slash.
+  const QString segmentName = name.startsWith('/') ? name : "/" + name;
+  if (segmentName.size() < 2 || segmentName.indexOf('/', 1) != -1) {
+    error = "invalid segment name " + name;
+    return false;
+  }
+
+  const QByteArray path = segmentName.toUtf8();
+  const int fd = shm_open(path.constData(), O_CREAT | O_RDWR, 0644);
+  if (fd == -1) {
+    error = "could not create segment " + segmentName;
+    return false;
+  }
+  void* mapping = MAP_FAILED;
+  if (ftruncate(fd, segmentSize()) == 0) {
+    mapping = mmap(nullptr, segmentSize(), PROT_READ | PROT_WRITE, MAP_SHARED,
+                   fd, 0);
+  }
+  ::close(fd);
+  if (mapping == MAP_FAILED) {
+    shm_unlink(path.constData());
+    error = "could not map segment " + segmentName;
+    return false;
+  }
+
+  std::memset(mapping, 0, segmentSize());
+  _segment = static_cast<TelemetryHeader*>(mapping);
+  std::memcpy(_segment->magic, "AMBTELEM", sizeof(_segment->magic));
+  _segment->version = 1;
+  _segment->active = 1;
+  _name = segmentName;
+  _interval = rounds;
+  if (_interval > 0) {
+    _system.addObserver(this);
+  }
+  publish();
+
+  return true;
+#else
+  Q_UNUSED(name);
+  Q_UNUSED(rounds);
+  error = "shared memory telemetry requires a POSIX system";
+  return false;
+#endif
+}
+
+void TelemetryPublisher::close() {
+  if (!isOpen()) {
+    return;
+  }
+  if (_interval > 0) {
+    _system.removeObserver(this);
+  }
+
+#ifdef Q_OS_UNIX
+  const quint32 sequence = _segment->sequence.load(std::memory_order_relaxed);
+  _segment->sequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  _segment->active = 0;
+  _segment->sequence.store(sequence + 2, std::memory_order_release);
+
+  munmap(_segment, segmentSize());
+  shm_unlink(_name.toUtf8().constData());
+#endif
+  _segment = nullptr;
+  _name.clear();
+  _interval = 0;
+}
+
+bool TelemetryPublisher::isOpen() const {
+  return _segment != nullptr;
+}
+
+void TelemetryPublisher::publish() {
+  if (!isOpen()) {
+    return;
+  }
+
+  // Metrics. Measures that have not been recorded yet are published as NaN;
+  // lazy measures are not calculated for monitors.
+  const std::vector<Count*>& counts = _system.getCounts();
+  const std::vector<Measure*>& measures = _system.getMeasures();
+  const int numCounts = std::min(int(counts.size()), maxMetrics);
+  const int numMeasures = std::min(int(measures.size()),
+                                   maxMetrics - numCounts);
+  for (int i = 0; i < numCounts; ++i) {
+    setName(_metrics[i], counts[i]->_name);
+    _metrics[i].value = counts[i]->_value;
+  }
+  for (int i = 0; i < numMeasures; ++i) {
+    const Measure* m = measures[i];
+    setName(_metrics[numCounts + i], m->_name);
+    _metrics[numCounts + i].value = m->_history.empty()
+        ? std::numeric_limits<double>::quiet_NaN() : m->_history.back();
+  }
+
+  // Occupancy image, with cells just large enough for the bounding box of the
+  // particles' heads to fit into the image.
+  const std::vector<AmoebotParticle*>& particles = _system.particles;
+  int minX = 0, maxX = -1, minY = 0, maxY = -1;
+  if (!particles.empty()) {
+    minX = maxX = particles.front()->head.x;
+    minY = maxY = particles.front()->head.y;
+    for (const AmoebotParticle* p : particles) {
+      minX = std::min(minX, p->head.x);
+      maxX = std::max(maxX, p->head.x);
+      minY = std::min(minY, p->head.y);
+      maxY = std::max(maxY, p->head.y);
+    }
+  }
+  const long long span = std::max(0LL, std::max(
+      static_cast<long long>(maxX) - minX + 1,
+      static_cast<long long>(maxY) - minY + 1));
+  const int cellSize = std::max(1LL, (span + maxImageSize - 1) / maxImageSize);
+  const int width = particles.empty() ? 0 : (maxX - minX) / cellSize + 1;
+  const int height = particles.empty() ? 0 : (maxY - minY) / cellSize + 1;
+  std::fill(_cellCounts.begin(), _cellCounts.begin() + width * height, 0);
+  for (const AmoebotParticle* p : particles) {
+    const int col = (p->head.x - minX) / cellSize;
+    const int row = (maxY - p->head.y) / cellSize;
+    ++_cellCounts[row * width + col];
+  }
+  const long long cellArea = static_cast<long long>(cellSize) * cellSize;
+  for (int i = 0; i < width * height; ++i) {
+    _image[i] = static_cast<uchar>(std::min(255LL,
+                                            _cellCounts[i] * 255 / cellArea));
+  }
+
+  // Copy everything into the segment under the sequence lock.
+  char* base = reinterpret_cast<char*>(_segment);
+  const quint32 sequence = _segment->sequence.load(std::memory_order_relaxed);
+  _segment->sequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  _segment->numCounts = numCounts;
+  _segment->numMeasures = numMeasures;
+  _segment->imageWidth = width;
+  _segment->imageHeight = height;
+  _segment->originX = minX;
+  _segment->originY = maxY;
+  _segment->cellSize = cellSize;
+  _segment->round = _system.getCount("# Rounds")._value;
+  _segment->activation = _system.getCount("# Activations")._value;
+  _segment->numParticles = particles.size();
+  _segment->time = _system.getTime();
+  _segment->publishedAt = QDateTime::currentMSecsSinceEpoch();
+  std::memcpy(base + sizeof(TelemetryHeader), _metrics.data(),
+              (numCounts + numMeasures) * sizeof(TelemetryMetric));
+  std::memcpy(base + sizeof(TelemetryHeader) +
+              maxMetrics * sizeof(TelemetryMetric), _image.data(),
+              width * height);
+
+  _segment->sequence.store(sequence + 2, std::memory_order_release);
+}
+
+void TelemetryPublisher::onRound(const unsigned int round) {
+  if (round % _interval == 0) {
+    publish();
+  }
+}
+
+size_t TelemetryPublisher::segmentSize() {
+  return sizeof(TelemetryHeader) + maxMetrics * sizeof(TelemetryMetric) +
+         maxImageSize * maxImageSize;
+}
@@ -0,0 +1,107 @@
+/* Copyright (C) 2021 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+// Defines a publisher that keeps the latest state of an AmoebotSystem in a
+// POSIX shared memory segment, so that external monitors (e.g.,
+// tools/telemetry.py) can follow a long run without the GUI and without
+// communicating with the simulator at all. The segment holds a TelemetryHeader
+// followed by maxMetrics TelemetryMetric entries (the counts, then the
+// measures) and a maxImageSize x maxImageSize occupancy image, all in the
+// machine's byte order. The image covers the bounding box of the particles'
+// heads with square cells of cellSize x cellSize nodes; its rows run from the
+// largest y-coordinate down, and each pixel holds the fraction of its cell's
+// nodes occupied by heads, scaled to 0-255.
+//
+// Writers and readers synchronize with a sequence lock: the publisher makes
+// the sequence odd before it changes the segment and even again afterwards.
+// Readers copy the segment and use the copy only if the sequence was the same
+// even number before and after copying; otherwise, they retry. Readers never
+// block the publisher, and publishing copies prepared data into the segment,
+// so the simulation does not wait for its monitors.
+
+#ifndef AMOEBOTSIM_CORE_TELEMETRYPUBLISHER_H_
+#define AMOEBOTSIM_CORE_TELEMETRYPUBLISHER_H_
+
+#include <atomic>
+#include <vector>
+
+#include <QString>
+#include <QtGlobal>
+
+#include "core/systemobserver.h"
+
+// AmoebotSystem must be forward declared to avoid a cyclic dependency.
+class AmoebotSystem;
+
+// The layout of the start of the segment. Offsets are fixed so that readers in
+// other languages can decode the segment without this header.
+struct TelemetryHeader {
+  char magic[8];                   // "AMBTELEM".
+  quint32 version;                 // The layout's version, currently 1.
+  std::atomic<quint32> sequence;   // Odd while the segment is being written.
+  quint32 active;                  // 0 once the publisher has stopped.
+  quint32 numCounts;
+  quint32 numMeasures;
+  quint32 imageWidth;
+  quint32 imageHeight;
+  qint32 originX;                  // The node of the image's top left cell.
+  qint32 originY;
+  qint32 cellSize;
+  quint64 round;
+  quint64 activation;
+  quint64 numParticles;
+  double time;                     // Simulated time; see AmoebotSystem.
+  qint64 publishedAt;              // Milliseconds since the Unix epoch.
+};
+
+// A count or measure, with its name in UTF-8, truncated and zero-terminated.
+// Measures that have not been recorded yet (e.g., lazy ones) have value NaN.
+struct TelemetryMetric {
+  char name[56];
+  double value;
+};
+
+class TelemetryPublisher : public SystemObserver {
+ public:
+  static const int maxMetrics = 64;
+  static const int maxImageSize = 256;
+
+  // Constructs a publisher of the given system without a segment.
+  TelemetryPublisher(AmoebotSystem& system);
+  ~TelemetryPublisher();
+
+  // Creates (or takes over) the shared memory segment with the given name,
+  // publishes the system's current state to it, and publishes again after
+  // every rounds-th round. Closes any segment opened before. Returns false and
+  // describes the problem in error if the segment cannot be created.
+  bool open(const QString name, const unsigned int rounds, QString& error);
+
+  // Marks the segment inactive and removes its name; monitors that mapped the
+  // segment keep the last state published.
+  void close();
+  bool isOpen() const;
+
+  // Writes the system's current state to the segment, if open.
+  void publish();
+
+  // Event handler; see systemobserver.h.
+  void onRound(const unsigned int round) override;
+
+  // Returns the size of the segment in bytes.
+  static size_t segmentSize();
+
+ private:
+  AmoebotSystem& _system;
+  QString _name;
+  unsigned int _interval;
+  TelemetryHeader* _segment;
+
+  // Staging buffers, filled before the segment is locked so that readers retry
+  // as rarely as possible.
+  std::vector<TelemetryMetric> _metrics;
+  std::vector<uchar> _image;
+  std::vector<int> _cellCounts;
+};
+
+#endif  // AMOEBOTSIM_CORE_TELEMETRYPUBLISHER_H_
@@ -0,0 +1,604 @@
+/* Copyright (C) 2021 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+#include "core/trajectory.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <QtEndian>
+
+#include "core/amoebotparticle.h"
+#include "core/amoebotsystem.h"
+
+namespace {
+
+// Appends the little-endian representation of the given value to the buffer.
+template<class T>
+void append(QByteArray& buffer, const T value) {
+  const T le = qToLittleEndian(value);
+  buffer.append(reinterpret_cast<const char*>(&le), sizeof(T));
+}
+
+void appendVarint(QByteArray& buffer, quint64 value) {
+  while (value >= 0x80) {
+    buffer.append(static_cast<char>((value & 0x7f) | 0x80));
+    value >>= 7;
+  }
+  buffer.append(static_cast<char>(value));
+}
+
+// Zigzag encoding maps signed values of small magnitude to small varints.
+void appendSigned(QByteArray& buffer, const qint64 value) {
+  appendVarint(buffer, (static_cast<quint64>(value) << 1) ^
+                       static_cast<quint64>(value >> 63));
+}
+
+void appendRecord(QByteArray& buffer, const Trajectory::Record type) {
+  buffer.append(static_cast<char>(type));
+}
+
+}  // namespace
+
+const char Trajectory::magic[8] = {'A', 'M', 'B', 'T', 'R', 'A', 'J', 'C'};
+const char Trajectory::trailerMagic[8] = {'A', 'M', 'B', 'T', 'R', 'I', 'D',
+                                          'X'};
+
+TrajectoryRecorder::TrajectoryRecorder(AmoebotSystem& system)
+  : _system(system),
+    _file(nullptr),
+    _written(0),
+    _keyframeInterval(0),
+    _round(0),
+    _nextId(0) {}
+
+TrajectoryRecorder::~TrajectoryRecorder() {
+  close();
+}
+
+bool TrajectoryRecorder::open(const QString filePath,
+                              const unsigned int keyframeInterval) {
+  Q_ASSERT(keyframeInterval >= 1);
+
+  close();
+  _file = new QFile(filePath);
+  if (!_file->open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+    delete _file;
+    _file = nullptr;
+    return false;
+  }
+
+  _buffer.clear();
+  _written = 0;
+  _keyframeInterval = keyframeInterval;
+  _round = _system.getCount("# Rounds")._value;
+  _ids.clear();
+  _nextId = 0;
+  _index.clear();
+
+  _buffer.append(Trajectory::magic, sizeof(Trajectory::magic));
+  append<quint32>(_buffer, Trajectory::version);
+  append<quint32>(_buffer, keyframeInterval);
+  append<qint32>(_buffer, _system.lattice.width());
+  append<qint32>(_buffer, _system.lattice.height());
+  for (const auto p : _system.particles) {
+    _ids[p] = _nextId++;
+  }
+  writeKeyframe(_round);
+  _system.addObserver(this);
+
+  return true;
+}
+
+void TrajectoryRecorder::close() {
+  if (_file == nullptr) {
+    return;
+  }
+  _system.removeObserver(this);
+
+  const quint64 indexOffset = _written + _buffer.size();
+  appendRecord(_buffer, Trajectory::Record::Index);
+  appendVarint(_buffer, _round);
+  appendVarint(_buffer, _index.size());
+  for (const auto& keyframe : _index) {
+    appendVarint(_buffer, keyframe.first);
+    appendVarint(_buffer, keyframe.second);
+  }
+  append<quint64>(_buffer, indexOffset);
+  _buffer.append(Trajectory::trailerMagic, sizeof(Trajectory::trailerMagic));
+  flush();
+
+  _file->close();
+  delete _file;
+  _file = nullptr;
+  _ids.clear();
+}
+
+bool TrajectoryRecorder::isOpen() const {
+  return _file != nullptr;
+}
+
+void TrajectoryRecorder::flush() {
+  if (_file != nullptr && !_buffer.isEmpty()) {
+    _file->write(_buffer);
+    _file->flush();
+    _written += _buffer.size();
+    _buffer.clear();
+  }
+}
+
+void TrajectoryRecorder::onInsert(const AmoebotParticle& particle) {
+  const quint32 id = _nextId++;
+  _ids[&particle] = id;
+  appendRecord(_buffer, Trajectory::Record::Insert);
+  appendVarint(_buffer, id);
+  appendSigned(_buffer, particle.head.x);
+  appendSigned(_buffer, particle.head.y);
+  appendVarint(_buffer, particle.globalTailDir + 1);
+  appendSigned(_buffer, particle.stateCode());
+  appendVarint(_buffer, particle.headMarkGlobalDir() + 1);
+}
+
+void TrajectoryRecorder::onRemove(const AmoebotParticle& particle) {
+  auto it = _ids.find(&particle);
+  Q_ASSERT(it != _ids.end());
+
+  appendRecord(_buffer, Trajectory::Record::Remove);
+  appendVarint(_buffer, it->second);
+  _ids.erase(it);
+}
+
+void TrajectoryRecorder::onMove(const AmoebotParticle& particle,
+                                const Node& oldHead, const int) {
+  appendRecord(_buffer, Trajectory::Record::Move);
+  appendVarint(_buffer, _ids.at(&particle));
+
+  // Every movement shifts the head by at most one node, so it fits one byte
+  // together with the new tail direction.
+  int headDir = (particle.head == oldHead) ? 6 : -1;
+  for (int dir = 0; dir < 6 && headDir == -1; ++dir) {
+    if (particle.lattice.nodeInDir(oldHead, dir) == particle.head) {
+      headDir = dir;
+    }
+  }
+  if (headDir != -1) {
+    _buffer.append(static_cast<char>(7 * headDir + particle.globalTailDir + 1));
+  } else {
+    _buffer.append(static_cast<char>(255));
+    appendSigned(_buffer, particle.head.x);
+    appendSigned(_buffer, particle.head.y);
+    appendVarint(_buffer, particle.globalTailDir + 1);
+  }
+}
+
+void TrajectoryRecorder::onStateChange(const AmoebotParticle& particle,
+                                       const int, const int newState) {
+  appendRecord(_buffer, Trajectory::Record::State);
+  appendVarint(_buffer, _ids.at(&particle));
+  appendSigned(_buffer, newState);
+}
+
+void TrajectoryRecorder::onDirectionChange(const AmoebotParticle& particle,
+                                           const int, const int newDir) {
+  appendRecord(_buffer, Trajectory::Record::Direction);
+  appendVarint(_buffer, _ids.at(&particle));
+  appendVarint(_buffer, newDir + 1);
+}
+
+void TrajectoryRecorder::onRound(const unsigned int round) {
+  _round = round;
+  appendRecord(_buffer, Trajectory::Record::Round);
+  appendVarint(_buffer, round);
+  if (round % _keyframeInterval == 0) {
+    writeKeyframe(round);
+  } else if (_buffer.size() >= blockSize) {
+    flush();
+  }
+}
+
+void TrajectoryRecorder::writeKeyframe(const unsigned int round) {
+  _index.push_back({round, _written + _buffer.size()});
+  appendRecord(_buffer, Trajectory::Record::Keyframe);
+  appendVarint(_buffer, round);
+  appendVarint(_buffer, _system.particles.size());
+  for (const auto p : _system.particles) {
+    appendVarint(_buffer, _ids.at(p));
+    appendSigned(_buffer, p->head.x);
+    appendSigned(_buffer, p->head.y);
+    appendVarint(_buffer, p->globalTailDir + 1);
+    appendSigned(_buffer, p->stateCode());
+    appendVarint(_buffer, p->headMarkGlobalDir() + 1);
+  }
+  appendVarint(_buffer, _system.objects.size());
+  for (const auto o : _system.objects) {
+    appendSigned(_buffer, o->_node.x);
+    appendSigned(_buffer, o->_node.y);
+  }
+
+  // Keyframes are where readers of an unfinished file can start, so they are
+  // written out right away.
+  flush();
+}
+
+TrajectoryReader::TrajectoryReader()
+  : _file(nullptr),
+    _data(nullptr),
+    _size(0),
+    _end(0),
+    _lastRound(0),
+    _round(0),
+    _pos(0) {}
+
+TrajectoryReader::~TrajectoryReader() {
+  close();
+}
+
+bool TrajectoryReader::open(const QString filePath) {
+  close();
+  _error = "";
+
+  _file = new QFile(filePath);
+  if (!_file->open(QIODevice::ReadOnly)) {
+    return fail("could not open " + filePath);
+  }
+  _size = _file->size();
+  _data = (_size > 0) ? _file->map(0, _size) : nullptr;
+  if (_data == nullptr) {
+    return fail("could not map " + filePath);
+  }
+
+  if (_size < static_cast<quint64>(Trajectory::headerSize) ||
+      std::memcmp(_data, Trajectory::magic, sizeof(Trajectory::magic)) != 0) {
+    return fail("not a trajectory");
+  }
+  const quint32 fileVersion = qFromLittleEndian<quint32>(_data + 8);
+  if (fileVersion != Trajectory::version) {
+    return fail("unsupported trajectory version " +
+                QString::number(fileVersion));
+  }
+  const qint32 torusWidth = qFromLittleEndian<qint32>(_data + 16);
+  const qint32 torusHeight = qFromLittleEndian<qint32>(_data + 20);
+  if (torusWidth != 0 || torusHeight != 0) {
+    if (torusWidth < 3 || torusHeight < 3) {
+      return fail("malformed trajectory lattice");
+    }
+    _lattice = Lattice(torusWidth, torusHeight);
+  }
+
+  // Use the index if the recorder closed the file, and rebuild it otherwise.
+  _end = _size;
+  const quint64 trailer = _size - Trajectory::trailerSize;
+  if (_size >= static_cast<quint64>(Trajectory::headerSize +
+                                    Trajectory::trailerSize) &&
+      std::memcmp(_data + trailer + 8, Trajectory::trailerMagic,
+                  sizeof(Trajectory::trailerMagic)) == 0) {
+    _end = trailer;
+    if (!readIndex(qFromLittleEndian<quint64>(_data + trailer))) {
+      return fail("malformed trajectory index");
+    }
+  } else {
+    scan();
+  }
+  if (_index.empty()) {
+    return fail("trajectory has no keyframes");
+  }
+
+  seek(firstRound());
+
+  return true;
+}
+
+void TrajectoryReader::close() {
+  if (_file != nullptr) {
+    if (_data != nullptr) {
+      _file->unmap(const_cast<uchar*>(_data));
+    }
+    _file->close();
+    delete _file;
+  }
+  _file = nullptr;
+  _data = nullptr;
+  _size = 0;
+  _end = 0;
+  _lattice = Lattice();
+  _lastRound = 0;
+  _index.clear();
+  _round = 0;
+  _pos = 0;
+  _particles.clear();
+  _objects.clear();
+}
+
+QString TrajectoryReader::error() const {
+  return _error;
+}
+
+unsigned int TrajectoryReader::firstRound() const {
+  return _index.empty() ? 0 : _index.front().first;
+}
+
+unsigned int TrajectoryReader::lastRound() const {
+  return _lastRound;
+}
+
+const Lattice& TrajectoryReader::lattice() const {
+  return _lattice;
+}
+
+void TrajectoryReader::seek(const unsigned int round) {
+  Q_ASSERT(!_index.empty());
+
+  const unsigned int target = std::min(std::max(round, firstRound()),
+                                       lastRound());
+  auto keyframe = std::upper_bound(
+      _index.begin(), _index.end(), target,
+      [](const unsigned int r, const std::pair<unsigned int, quint64>& k) {
+        return r < k.first;
+      });
+  --keyframe;
+
+  // Replaying forward from the current round is cheaper than reloading the
+  // keyframe if no later keyframe lies in between.
+  if (_round > target || _round < keyframe->first || _particles.empty()) {
+    Trajectory::Record type;
+    unsigned int keyframeRound;
+    _pos = readRecord(keyframe->second, true, type, keyframeRound);
+  }
+  while (_round < target && next()) {}
+}
+
+bool TrajectoryReader::next() {
+  if (_round >= _lastRound) {
+    return false;
+  }
+
+  Trajectory::Record type;
+  unsigned int round;
+  while (_pos != 0 && _pos < _end) {
+    _pos = readRecord(_pos, true, type, round);
+    if (_pos != 0 && type == Trajectory::Record::Round) {
+      return true;
+    }
+  }
+
+  // The index promised more rounds than the records hold.
+  _lastRound = _round;
+  return false;
+}
+
+unsigned int TrajectoryReader::round() const {
+  return _round;
+}
+
+const std::map<quint32, ParticleRecord>& TrajectoryReader::particles() const {
+  return _particles;
+}
+
+const std::vector<Node>& TrajectoryReader::objects() const {
+  return _objects;
+}
+
+quint64 TrajectoryReader::readRecord(const quint64 offset, const bool apply,
+                                     Trajectory::Record& type,
+                                     unsigned int& round) {
+  quint64 pos = offset;
+  if (pos >= _end ||
+      _data[pos] > static_cast<uchar>(Trajectory::Record::Index)) {
+    return 0;
+  }
+  type = static_cast<Trajectory::Record>(_data[pos++]);
+
+  quint64 id, value, direction, count;
+  qint64 x, y, state;
+  switch (type) {
+    case Trajectory::Record::Insert:
+      if (!readVarint(pos, id) || !readSigned(pos, x) || !readSigned(pos, y) ||
+          !readVarint(pos, value) || !readSigned(pos, state) ||
+          !readVarint(pos, direction) || value > 6 || direction > 6) {
+        return 0;
+      }
+      if (apply) {
+        _particles[id] = {Node(x, y), static_cast<int>(value) - 1,
+                          static_cast<int>(state),
+                          static_cast<int>(direction) - 1};
+      }
+      break;
+    case Trajectory::Record::Remove:
+      if (!readVarint(pos, id)) {
+        return 0;
+      }
+      if (apply) {
+        _particles.erase(id);
+      }
+      break;
+    case Trajectory::Record::Move: {
+      if (!readVarint(pos, id) || pos >= _end) {
+        return 0;
+      }
+      const uchar code = _data[pos++];
+      if (code == 255) {
+        if (!readSigned(pos, x) || !readSigned(pos, y) ||
+            !readVarint(pos, value) || value > 6) {
+          return 0;
+        }
+      } else if (code >= 7 * 7) {
+        return 0;
+      }
+      if (apply) {
+        auto it = _particles.find(id);
+        if (it == _particles.end()) {
+          return 0;
+        } else if (code == 255) {
+          it->second.head = Node(x, y);
+          it->second.globalTailDir = static_cast<int>(value) - 1;
+        } else {
+          if (code / 7 != 6) {
+            it->second.head = _lattice.nodeInDir(it->second.head, code / 7);
+          }
+          it->second.globalTailDir = code % 7 - 1;
+        }
+      }
+      break;
+    }
+    case Trajectory::Record::State:
+      if (!readVarint(pos, id) || !readSigned(pos, state)) {
+        return 0;
+      }
+      if (apply) {
+        auto it = _particles.find(id);
+        if (it == _particles.end()) {
+          return 0;
+        }
+        it->second.state = state;
+      }
+      break;
+    case Trajectory::Record::Direction:
+      if (!readVarint(pos, id) || !readVarint(pos, direction) ||
+          direction > 6) {
+        return 0;
+      }
+      if (apply) {
+        auto it = _particles.find(id);
+        if (it == _particles.end()) {
+          return 0;
+        }
+        it->second.direction = static_cast<int>(direction) - 1;
+      }
+      break;
+    case Trajectory::Record::Round:
+      if (!readVarint(pos, value)) {
+        return 0;
+      }
+      round = value;
+      if (apply) {
+        _round = round;
+      }
+      break;
+    case Trajectory::Record::Keyframe:
+      if (!readVarint(pos, value) || !readVarint(pos, count)) {
+        return 0;
+      }
+      round = value;
+      if (apply) {
+        _particles.clear();
+        _round = round;
+      }
+      for (quint64 i = 0; i < count; ++i) {
+        if (!readVarint(pos, id) || !readSigned(pos, x) ||
+            !readSigned(pos, y) || !readVarint(pos, value) ||
+            !readSigned(pos, state) || !readVarint(pos, direction) ||
+            value > 6 || direction > 6) {
+          return 0;
+        }
+        if (apply) {
+          _particles[id] = {Node(x, y), static_cast<int>(value) - 1,
+                            static_cast<int>(state),
+                            static_cast<int>(direction) - 1};
+        }
+      }
+      if (!readVarint(pos, count)) {
+        return 0;
+      }
+      if (apply) {
+        _objects.clear();
+      }
+      for (quint64 i = 0; i < count; ++i) {
+        if (!readSigned(pos, x) || !readSigned(pos, y)) {
+          return 0;
+        }
+        if (apply) {
+          _objects.push_back(Node(x, y));
+        }
+      }
+      break;
+    case Trajectory::Record::Index:
+      if (!readVarint(pos, value) || !readVarint(pos, count)) {
+        return 0;
+      }
+      round = value;
+      for (quint64 i = 0; i < 2 * count; ++i) {
+        if (!readVarint(pos, value)) {
+          return 0;
+        }
+      }
+      break;
+  }
+
+  return pos;
+}
+
+bool TrajectoryReader::readIndex(const quint64 offset) {
+  quint64 pos = offset;
+  quint64 lastRound, numKeyframes, round, keyframeOffset;
+  if (pos >= _end ||
+      _data[pos++] != static_cast<uchar>(Trajectory::Record::Index) ||
+      !readVarint(pos, lastRound) || !readVarint(pos, numKeyframes)) {
+    return false;
+  }
+  for (quint64 i = 0; i < numKeyframes; ++i) {
+    if (!readVarint(pos, round) || !readVarint(pos, keyframeOffset) ||
+        keyframeOffset < static_cast<quint64>(Trajectory::headerSize) ||
+        keyframeOffset >= offset) {
+      return false;
+    }
+    _index.push_back({round, keyframeOffset});
+  }
+
+  // The records end where the index starts.
+  _end = offset;
+  _lastRound = lastRound;
+
+  return true;
+}
+
+void TrajectoryReader::scan() {
+  quint64 pos = Trajectory::headerSize;
+  Trajectory::Record type;
+  unsigned int round;
+  while (pos < _end) {
+    const quint64 next = readRecord(pos, false, type, round);
+    if (next == 0 || type == Trajectory::Record::Index) {
+      break;
+    } else if (type == Trajectory::Record::Round) {
+      _lastRound = round;
+    } else if (type == Trajectory::Record::Keyframe) {
+      _index.push_back({round, pos});
+      _lastRound = std::max(_lastRound, round);
+    }
+    pos = next;
+  }
+
+  // Ignore everything from the first record that is cut off or malformed.
+  _end = pos;
+}
+
+bool TrajectoryReader::readVarint(quint64& pos, quint64& value) const {
+  value = 0;
+  for (int shift = 0; shift < 64 && pos < _end; shift += 7) {
+    const uchar byte = _data[pos++];
+    value |= static_cast<quint64>(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+bool TrajectoryReader::readSigned(quint64& pos, qint64& value) const {
+  quint64 zigzag;
+  if (!readVarint(pos, zigzag)) {
+    return false;
+  }
+  value = static_cast<qint64>(zigzag >> 1) ^ -static_cast<qint64>(zigzag & 1);
+
+  return true;
+}
+
+bool TrajectoryReader::fail(const QString message) {
+  close();
+  _error = message;
+
+  return false;
+}
@@ -0,0 +1,224 @@
+/* Copyright (C) 2021 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+// Defines a compact, append-only file format for the full trajectory of a run
+// and a recorder and reader for it. Instead of storing the configuration every
+// round, the recorder follows the system's events (see systemobserver.h) and
+// logs each as a small delta record, adding a full keyframe of the
+// configuration every keyframeInterval rounds. A reader reconstructs the
+// configuration at any recorded round by loading the nearest keyframe at or
+// before it and replaying the deltas from there.
+//
+// The configuration at round r is the one at the moment the system completed
+// its r-th round, i.e., the one its measures of that round were calculated on.
+// Particles are identified by ids that are assigned in order of insertion and
+// never reused, so they are stable for a particle's whole lifetime.
+//
+// Fixed-size integers are little-endian; all others are stored as LEB128
+// varints, and signed ones (coordinates and states) are zigzag-encoded first. A
+// trajectory file consists of:
+// - A header: the magic bytes "AMBTRAJC", the format version (u32), the
+//   keyframe interval (u32), and the torus width and height (i32 each; 0 on
+//   the plane).
+// - A sequence of records, each starting with its type (u8):
+//   - Insert: the new particle's id, head x and y, global tail direction + 1
+//     (0 if contracted), state, and global direction of its direction marker
+//     + 1 (0 if it has none; see AmoebotParticle::headMarkGlobalDir).
+//   - Remove: the id of the removed particle.
+//   - Move (expansions, contractions, and handovers): the particle's id and a
+//     byte 7 * d + t + 1, where d is the global direction from its old head to
+//     its new one (6 if the head did not move) and t its new global tail
+//     direction. Heads that moved farther (e.g., by reinsertion) use the byte
+//     255 followed by the new head x and y and t + 1.
+//   - State: the particle's id and new state.
+//   - Direction: the particle's id and new marker direction + 1.
+//   - Round: the number of completed rounds.
+//   - Keyframe: the number of completed rounds, the number of particles, and
+//     each particle's id, head x and y, tail direction + 1, state, and marker
+//     direction + 1, in the system's particle order, followed by the number of
+//     objects and each object's x and y. Every keyframe follows the Round
+//     record of its round, and the first keyframe records the configuration
+//     the recorder started from.
+//   - Index: the last completed round, the number of keyframes, and each
+//     keyframe's round and byte offset in the file.
+// - A trailer written when the recorder closes: the byte offset of the Index
+//   record (u64) and the magic bytes "AMBTRIDX". Files of runs that ended
+//   without closing their recorder lack both; readers then rebuild the index
+//   by scanning the records, ignoring a final record that was cut off.
+
+#ifndef AMOEBOTSIM_CORE_TRAJECTORY_H_
+#define AMOEBOTSIM_CORE_TRAJECTORY_H_
+
+#include <map>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+#include <QtGlobal>
+
+#include "core/lattice.h"
+#include "core/snapshot.h"
+#include "core/systemobserver.h"
+
+// AmoebotSystem must be forward declared to avoid a cyclic dependency.
+class AmoebotSystem;
+
+class Trajectory {
+ public:
+  enum class Record : quint8 {
+    Insert = 0,
+    Remove = 1,
+    Move = 2,
+    State = 3,
+    Direction = 4,
+    Round = 5,
+    Keyframe = 6,
+    Index = 7
+  };
+
+  // The magic bytes and version identifying the format, and the magic bytes
+  // ending the trailer.
+  static const char magic[8];
+  static const char trailerMagic[8];
+  static const quint32 version = 3;
+
+  // Sizes of the header and trailer in bytes.
+  static const int headerSize = 24;
+  static const int trailerSize = 16;
+};
+
+class TrajectoryRecorder : public SystemObserver {
+ public:
+  // Constructs a recorder of the given system that is not recording yet.
+  TrajectoryRecorder(AmoebotSystem& system);
+  ~TrajectoryRecorder();
+
+  // Functions for recording. open creates the file at the given path
+  // (replacing its contents), writes the header and a keyframe of the system's
+  // current configuration, and starts following the system's events; it
+  // returns false if the file cannot be opened. close writes the index and
+  // trailer and closes the file. isOpen checks whether the recorder is
+  // recording.
+  bool open(const QString filePath, const unsigned int keyframeInterval = 100);
+  void close();
+  bool isOpen() const;
+
+  // Writes the records buffered so far to the file.
+  void flush();
+
+  // Event handlers; see systemobserver.h.
+  void onInsert(const AmoebotParticle& particle) override;
+  void onRemove(const AmoebotParticle& particle) override;
+  void onMove(const AmoebotParticle& particle, const Node& oldHead,
+              const int oldTailDir) override;
+  void onStateChange(const AmoebotParticle& particle, const int oldState,
+                     const int newState) override;
+  void onDirectionChange(const AmoebotParticle& particle, const int oldDir,
+                         const int newDir) override;
+  void onRound(const unsigned int round) override;
+
+ private:
+  // Appends a keyframe of the system's current configuration for the given
+  // round and notes it in the index.
+  void writeKeyframe(const unsigned int round);
+
+  // Records are collected in a buffer and written in blocks of about this
+  // many bytes, so that recording costs few system calls.
+  static const int blockSize = 1 << 16;
+
+  AmoebotSystem& _system;
+  QFile* _file;
+  QByteArray _buffer;
+  quint64 _written;
+  unsigned int _keyframeInterval;
+  unsigned int _round;
+
+  std::unordered_map<const AmoebotParticle*, quint32> _ids;
+  quint32 _nextId;
+
+  // The round and byte offset of every keyframe written so far.
+  std::vector<std::pair<unsigned int, quint64>> _index;
+};
+
+class TrajectoryReader {
+ public:
+  // Constructs a reader with no trajectory open.
+  TrajectoryReader();
+  ~TrajectoryReader();
+
+  // Memory-maps and validates the trajectory at the given path, closing any
+  // trajectory previously open, and positions the reader at its first round.
+  // Returns false if the file cannot be mapped or is not a trajectory; error
+  // then describes the problem. close unmaps the file.
+  bool open(const QString filePath);
+  void close();
+  QString error() const;
+
+  // Functions for the recorded rounds and the lattice they were recorded on.
+  // firstRound and lastRound return the first and last round that can be
+  // reconstructed. lattice returns the lattice the trajectory was recorded on.
+  unsigned int firstRound() const;
+  unsigned int lastRound() const;
+  const Lattice& lattice() const;
+
+  // Functions for moving through the trajectory. seek reconstructs the
+  // configuration at the given round (clamped to the recorded rounds) from the
+  // nearest keyframe at or before it. next advances to the following round by
+  // replaying its deltas, returning false if the reader is at the last round.
+  // round returns the round the reader is at.
+  void seek(const unsigned int round);
+  bool next();
+  unsigned int round() const;
+
+  // Returns the particles of the current configuration, ordered by id, and
+  // the objects as of the keyframe the configuration was reconstructed from.
+  // Objects are only recorded in keyframes, since they rarely change.
+  const std::map<quint32, ParticleRecord>& particles() const;
+  const std::vector<Node>& objects() const;
+
+ private:
+  // Parses the record at the given offset, returning the offset following it,
+  // or 0 if the record is cut off or malformed. type is set to the record's
+  // type and, for Round, Keyframe, and Index records, round to its round. If
+  // apply is true, the record is applied to the configuration; a keyframe then
+  // replaces it.
+  quint64 readRecord(const quint64 offset, const bool apply,
+                     Trajectory::Record& type, unsigned int& round);
+
+  // Parses the index record at the given offset. Returns false if it is cut
+  // off or malformed.
+  bool readIndex(const quint64 offset);
+
+  // Rebuilds the index by scanning all records, for files without a trailer.
+  void scan();
+
+  // Functions for reading varints (see above) at the given position, which
+  // they advance. Both return false if the varint extends past _end.
+  bool readVarint(quint64& pos, quint64& value) const;
+  bool readSigned(quint64& pos, qint64& value) const;
+
+  // Closes the trajectory and records the given error message; returns false.
+  bool fail(const QString message);
+
+  QFile* _file;
+  const uchar* _data;
+  quint64 _size;
+  quint64 _end;
+  QString _error;
+
+  Lattice _lattice;
+  unsigned int _lastRound;
+  std::vector<std::pair<unsigned int, quint64>> _index;
+
+  // The configuration at _round and the offset of the first record after it.
+  unsigned int _round;
+  quint64 _pos;
+  std::map<quint32, ParticleRecord> _particles;
+  std::vector<Node> _objects;
+};
+
+#endif  // AMOEBOTSIM_CORE_TRAJECTORY_H_
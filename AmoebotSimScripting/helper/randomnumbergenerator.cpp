@@ -5,3 +5,5 @@
 #include "helper/randomnumbergenerator.h"
 
 std::mt19937 RandomNumberGenerator::rng;
+uint32_t RandomNumberGenerator::_seed = std::mt19937::default_seed;
+bool RandomNumberGenerator::_seeded = false;
@@ -8,12 +8,27 @@
 #include <algorithm>
 #include <chrono>
 #include <random>
+#include <sstream>
+#include <string>
 
 class RandomNumberGenerator
 {
 public:
     RandomNumberGenerator();
 
+    // Returns the seed of the generator shared by all particles and systems.
+    // setSeed reseeds it, e.g., to reproduce a previous run; seeds set before
+    // the first system is created are kept instead of drawing a random one.
+    static uint32_t getSeed();
+    static void setSeed(const uint32_t seed);
+
+    // Returns the full internal state of the shared generator in its textual
+    // representation. setGeneratorState restores such a state, after which the
+    // generator continues with exactly the numbers it produced after the state
+    // was taken; it returns false if the state cannot be parsed.
+    static std::string getGeneratorState();
+    static bool setGeneratorState(const std::string& state);
+
 protected:
     static int randInt(const int from, const int toNotIncluding);
     static int randDir();
@@ -26,12 +41,13 @@ protected:
 
 private:
     static std::mt19937 rng;
+    static uint32_t _seed;
+    static bool _seeded;
 };
 
 inline RandomNumberGenerator::RandomNumberGenerator()
 {
-    static bool initialized = false;
-    if(!initialized) {
+    if(!_seeded) {
         uint32_t seed;
         std::random_device device;
         if(device.entropy() == 0) {
@@ -42,9 +58,39 @@ inline RandomNumberGenerator::RandomNumberGenerator()
                                                          std::numeric_limits<uint32_t>::max());
             seed = dist(device);
         }
-        rng.seed(seed);
-        initialized = true;
+        setSeed(seed);
+    }
+}
+
+inline uint32_t RandomNumberGenerator::getSeed()
+{
+    return _seed;
+}
+
+inline void RandomNumberGenerator::setSeed(const uint32_t seed)
+{
+    rng.seed(seed);
+    _seed = seed;
+    _seeded = true;
+}
+
+inline std::string RandomNumberGenerator::getGeneratorState()
+{
+    std::ostringstream out;
+    out << rng;
+    return out.str();
+}
+
+inline bool RandomNumberGenerator::setGeneratorState(const std::string& state)
+{
+    std::istringstream in(state);
+    std::mt19937 restored;
+    in >> restored;
+    if(in.fail()) {
+        return false;
     }
+    rng = restored;
+    return true;
 }
 
 inline int RandomNumberGenerator::randInt(const int from, const int toNotIncluding)
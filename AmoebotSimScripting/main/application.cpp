@@ -27,6 +27,7 @@ Application::Application(int argc, char *argv[])
   connect(vis, &VisItem::beforeRendering,
           [this, qmlRoot](){
             QMetaObject::invokeMethod(qmlRoot, "setMetrics", Q_ARG(QVariant, sim.metrics()));
+            QMetaObject::invokeMethod(qmlRoot, "setReplay", Q_ARG(QVariant, sim.replayInfo()));
           }
   );
   connect(vis, &VisItem::inspectParticle,
@@ -34,6 +35,11 @@ Application::Application(int argc, char *argv[])
             QMetaObject::invokeMethod(qmlRoot, "inspectParticle", Q_ARG(QVariant, text));
           }
   );
+  connect(vis, &VisItem::log,
+          [qmlRoot](const QString msg, const bool isError){
+            QMetaObject::invokeMethod(qmlRoot, "log", Q_ARG(QVariant, msg), Q_ARG(QVariant, isError));
+          }
+  );
 
   // Populate algorithm selection combo box with algorithm names and set its
   // initial value.
@@ -73,6 +79,17 @@ Application::Application(int argc, char *argv[])
           }
   );
   connect(vis, &VisItem::stepForParticleAt, &sim, &Simulator::stepForParticleAt);
+  connect(&sim, &Simulator::log,
+          [qmlRoot](const QString msg, const bool isError){
+            QMetaObject::invokeMethod(qmlRoot, "log", Q_ARG(QVariant, msg), Q_ARG(QVariant, isError));
+          }
+  );
+
+  // setup connections between the replay controls and Simulator
+  qmlRoot->findChild<QObject*>("replayFileDialog")->setProperty("executableDir", QDir::currentPath());
+  connect(qmlRoot, SIGNAL(openReplay(QString)), &sim, SLOT(openReplay(QString)));
+  connect(qmlRoot, SIGNAL(seekReplay(int)), &sim, SLOT(seekReplay(int)));
+  connect(qmlRoot, SIGNAL(setReplaySpeed(int)), &sim, SLOT(setReplaySpeed(int)));
   connect(slider, SIGNAL(stepDurationChanged(int)), &sim, SLOT(setStepDuration(int)));
   connect(&sim, &Simulator::stepDurationChanged,
           [slider](const int& ms){
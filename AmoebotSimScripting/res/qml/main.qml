@@ -31,6 +31,10 @@ ApplicationWindow {
 
   signal runScript(string scriptPath)
 
+  signal openReplay(string trajectoryPath)
+  signal seekReplay(int round)
+  signal setReplaySpeed(int rounds)
+
   signal start()
   signal stop()
   signal step()
@@ -59,6 +63,21 @@ ApplicationWindow {
     metricList.model = metricInfo
   }
 
+  function setReplay(replayInfo) {
+    replayControls.visible = (replayInfo.length > 0)
+    if (replayInfo.length > 0) {
+      timelineSlider.minimumValue = replayInfo[0]
+      timelineSlider.maximumValue = replayInfo[1]
+      if (!timelineSlider.pressed) {
+        timelineSlider.value = replayInfo[2]
+      }
+      replayRoundText.text = replayInfo[2] + " / " + replayInfo[1]
+      if (!replaySpeedBox.activeFocus) {
+        replaySpeedBox.value = replayInfo[3]
+      }
+    }
+  }
+
   function setResolution(_width, _height) {
     if (_width < appWindow.minimumWidth) {
       appWindow.width = appWindow.minimumWidth
@@ -262,6 +281,31 @@ ApplicationWindow {
       }
     }
 
+    A_Button {
+      id: openReplayButton
+      text: "Open Replay"
+      Layout.preferredWidth: parent.width
+
+      onClicked: {
+        replayFileDialog.open()
+      }
+    }
+
+    FileDialog {
+      id: replayFileDialog
+      objectName: "replayFileDialog"
+      title: "Choose trajectory file"
+      nameFilters: [ "Trajectory files (*.traj)", "All files (*)" ]
+      selectedNameFilter: "Trajectory files (*.traj)"
+
+      property string executableDir: ""
+
+      onAccepted: {
+        vis.forceActiveFocus()
+        openReplay(fileUrl.toString().replace("file:///" + executableDir + "/", ""))
+      }
+    }
+
     ScrollView {
       id: metricView
       Layout.preferredWidth: parent.width
@@ -297,6 +341,82 @@ ApplicationWindow {
       color: "transparent"
     }
 
+    ColumnLayout {
+      id: replayControls
+      visible: false
+      spacing: 5
+      Layout.preferredWidth: parent.width
+
+      RowLayout {
+        Rectangle {
+          Layout.preferredWidth: 130
+          Text {
+            anchors.left: parent.left
+            text: "Round:"
+          }
+        }
+
+        Rectangle {
+          Layout.preferredWidth: 130
+          Text {
+            id: replayRoundText
+            anchors.left: parent.left
+            text: ""
+          }
+        }
+      }
+
+      // Dragging the timeline seeks to the round under the handle; otherwise,
+      // the handle follows the playback.
+      Slider {
+        id: timelineSlider
+        Layout.preferredWidth: parent.width
+
+        orientation: Qt.Horizontal
+        stepSize: 1.0
+        updateValueWhileDragging: true
+
+        onValueChanged: {
+          if (pressed) {
+            seekReplay(value)
+          }
+        }
+      }
+
+      RowLayout {
+        spacing: 5
+
+        A_TextField {
+          id: jumpField
+          Layout.preferredWidth: 90
+          placeholderText: "Jump to round"
+          validator: IntValidator { bottom: 0 }
+
+          onAccepted: {
+            seekReplay(parseInt(text))
+            text = ""
+            vis.forceActiveFocus()
+          }
+        }
+
+        Text {
+          text: "Rounds/Step:"
+        }
+
+        SpinBox {
+          id: replaySpeedBox
+          Layout.preferredWidth: 80
+          minimumValue: 1
+          maximumValue: 1000000
+          value: 1
+
+          onValueChanged: {
+            setReplaySpeed(value)
+          }
+        }
+      }
+    }
+
     RowLayout {
       id: stepDurationRow
       Layout.bottomMargin: 15
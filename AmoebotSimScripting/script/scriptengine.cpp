@@ -43,4 +43,7 @@ void ScriptEngine::runScript(const QString scriptFilePath) {
   scriptFile.close();
 
   engine.evaluate(script);
+
+  // Text that scripts wrote to files is complete once they finish.
+  scriptInterface->flushFiles();
 }
@@ -0,0 +1,108 @@
+/* Copyright (C) 2021 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+#include "script/scriptfiles.h"
+
+#include <QFileInfo>
+
+ScriptFiles::ScriptFiles()
+  : _nextHandle(1) {}
+
+ScriptFiles::~ScriptFiles() {
+  flush();
+}
+
+int ScriptFiles::open(const QString filePath) {
+  // Paths are compared by the file they name, so that, e.g., "data.txt" and
+  // "./data.txt" share a handle.
+  const QString path = QFileInfo(filePath).absoluteFilePath();
+  auto it = _handles.find(path);
+  if (it != _handles.end()) {
+    return it->second;
+  }
+
+  std::unique_ptr<OpenFile> openFile(new OpenFile);
+  openFile->handle = _nextHandle;
+  openFile->file.setFileName(path);
+  if (!reopen(*openFile)) {
+    return -1;
+  }
+  openFile->sinceFlush.start();
+
+  const int handle = _nextHandle++;
+  _files[handle] = std::move(openFile);
+  _handles[path] = handle;
+  return handle;
+}
+
+bool ScriptFiles::write(const int handle, const QString text) {
+  auto it = _files.find(handle);
+  if (it == _files.end()) {
+    return false;
+  }
+
+  OpenFile& openFile = *it->second;
+  openFile.buffer.append(text.toUtf8());
+  if (openFile.buffer.size() >= flushSize ||
+      openFile.sinceFlush.elapsed() >= flushInterval) {
+    return flush(openFile);
+  }
+  return true;
+}
+
+bool ScriptFiles::close(const int handle) {
+  auto it = _files.find(handle);
+  if (it == _files.end()) {
+    return false;
+  }
+
+  const bool flushed = flush(*it->second);
+  if (it->second->file.isOpen()) {
+    _recent.erase(it->second->recent);
+  }
+  _handles.erase(it->second->file.fileName());
+  _files.erase(it);
+  return flushed;
+}
+
+bool ScriptFiles::flush() {
+  bool flushed = true;
+  for (auto& entry : _files) {
+    flushed = flush(*entry.second) && flushed;
+  }
+  return flushed;
+}
+
+bool ScriptFiles::reopen(OpenFile& openFile) {
+  if (openFile.file.isOpen()) {
+    _recent.splice(_recent.begin(), _recent, openFile.recent);
+    return true;
+  }
+
+  // Every write is flushed, so a file can be closed without writing anything.
+  if (_recent.size() >= maxOpenFiles) {
+    _files[_recent.back()]->file.close();
+    _recent.pop_back();
+  }
+  if (!openFile.file.open(QFile::WriteOnly | QFile::Append)) {
+    return false;
+  }
+  _recent.push_front(openFile.handle);
+  openFile.recent = _recent.begin();
+  return true;
+}
+
+bool ScriptFiles::flush(OpenFile& openFile) {
+  openFile.sinceFlush.restart();
+  if (openFile.buffer.isEmpty()) {
+    return true;
+  }
+
+  // Text that cannot be written is dropped rather than retried forever.
+  const bool written = reopen(openFile) &&
+                       openFile.file.write(openFile.buffer) ==
+                       openFile.buffer.size() && openFile.file.flush();
+  openFile.buffer.clear();
+  return written;
+}
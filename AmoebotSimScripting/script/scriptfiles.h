@@ -0,0 +1,89 @@
+/* Copyright (C) 2021 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+// Defines the files that scripts write to (see ScriptInterface::openFile).
+// Files collect text in memory, which is written out once enough has
+// accumulated or, when text is written, if a second has passed since the file
+// was last written out, so that scripts logging small values every round do
+// not pay for a system call, let alone opening and closing the file, on every
+// write. Nothing is written out between writes; flush writes out the rest.
+// Files are identified by handles, and a file opened twice keeps its first
+// handle. Files stay open between writes, but at most maxOpenFiles at a time:
+// the least recently written one is closed to make room and reopened when its
+// text is next written out, so that scripts writing to many paths (e.g., one
+// file per run) do not run out of file descriptors.
+
+#ifndef AMOEBOTSIM_SCRIPT_SCRIPTFILES_H_
+#define AMOEBOTSIM_SCRIPT_SCRIPTFILES_H_
+
+#include <list>
+#include <map>
+#include <memory>
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QString>
+
+class ScriptFiles {
+ public:
+  // Constructs a table without open files.
+  ScriptFiles();
+
+  // Flushes and closes all open files.
+  ~ScriptFiles();
+
+  // Opens the file at the given path for appending and returns its handle, or
+  // returns the handle it already has if it is open. Returns -1 if the file
+  // cannot be opened.
+  int open(const QString filePath);
+
+  // Appends the given text, encoded as UTF-8, to the file with the given
+  // handle. Returns false if there is no such file or it cannot be written.
+  bool write(const int handle, const QString text);
+
+  // Flushes and closes the file with the given handle, after which the handle
+  // is invalid. Returns false if there is no such file or it cannot be written.
+  bool close(const int handle);
+
+  // Writes the buffered text of all open files out, keeping them open. Returns
+  // false if some file cannot be written.
+  bool flush();
+
+ private:
+  // A file with its handle, its buffered text, and, while it is open, its
+  // position in _recent.
+  struct OpenFile {
+    int handle;
+    QFile file;
+    QByteArray buffer;
+    QElapsedTimer sinceFlush;
+    std::list<int>::iterator recent;
+  };
+
+  // Opens the given file for appending unless it is open, closing the least
+  // recently used file if maxOpenFiles are open, and marks it as the most
+  // recently used one. Returns false if the file cannot be opened.
+  bool reopen(OpenFile& openFile);
+
+  // Writes the buffered text of the given file out.
+  bool flush(OpenFile& openFile);
+
+  // Buffers are written out once they hold this many bytes or this many
+  // milliseconds have passed since they were last written out.
+  static const int flushSize = 1 << 16;
+  static const int flushInterval = 1000;
+
+  // The maximum number of files kept open at a time.
+  static const unsigned int maxOpenFiles = 32;
+
+  std::map<int, std::unique_ptr<OpenFile>> _files;
+  std::map<QString, int> _handles;
+  int _nextHandle;
+
+  // The handles of the open files, the most recently used one first.
+  std::list<int> _recent;
+};
+
+#endif  // AMOEBOTSIM_SCRIPT_SCRIPTFILES_H_
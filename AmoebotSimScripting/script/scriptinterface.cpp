@@ -4,12 +4,17 @@
 
 #include "script/scriptinterface.h"
 
+#include <QColor>
 #include <QDateTime>
-#include <QFile>
-#include <QTextStream>
+#include <QMutexLocker>
 
 #include "alg/shapeformation.h"
+#include "core/frameencoder.h"
+#include "core/latticelayout.h"
+#include "core/latticerenderer.h"
+#include "core/metricsarchive.h"
 #include "core/node.h"
+#include "helper/randomnumbergenerator.h"
 
 ScriptInterface::ScriptInterface(ScriptEngine &engine, Simulator& sim,
                                  VisItem *vis)
@@ -27,18 +32,38 @@ void ScriptInterface::runScript(const QString scriptFilePath) {
   engine.runScript(scriptFilePath);
 }
 
-void ScriptInterface::writeToFile(const QString filePath, const QString text) {
-  QFile file(filePath);
+void ScriptInterface::flushFiles() {
+  if (!files.flush()) {
+    log("Could not write to file", true);
+  }
+}
 
-  if (!file.open(QFile::WriteOnly | QFile::Append)) {
+void ScriptInterface::writeToFile(const QString filePath, const QString text) {
+  const int handle = files.open(filePath);
+  if (handle == -1 || !files.write(handle, text)) {
     log("Could not write to file", true);
-    return;
   }
+}
 
-  QTextStream stream(&file);
-  stream << text;
+int ScriptInterface::openFile(const QString filePath) {
+  const int handle = files.open(filePath);
+  if (handle == -1) {
+    log("Could not open file " + filePath, true);
+  }
+  return handle;
+}
 
-  file.close();
+void ScriptInterface::write(const int handle, const QString text) {
+  if (!files.write(handle, text)) {
+    log("Could not write to file with handle " + QString::number(handle),
+        true);
+  }
+}
+
+void ScriptInterface::closeFile(const int handle) {
+  if (!files.close(handle)) {
+    log("Could not close file with handle " + QString::number(handle), true);
+  }
 }
 
 void ScriptInterface::step() {
@@ -68,24 +93,463 @@ int ScriptInterface::getNumObjects() {
 
 void ScriptInterface::exportMetrics() {
   sim.exportMetrics();
-  log("Metrics exported to application directory.");
+  log("Metrics exported.");
 }
 
 QVariant ScriptInterface::getMetric(QString name, bool history) {
+  {
+    QMutexLocker locker(&sim.getSystem()->mutex);
+    flushMeasures();
+  }
   for (const auto& c : sim.getSystem()->getCounts()) {
     if (c->_name == name) {
-      return history ? QVariant::fromValue(c->_history) : c->_value;
+      return history ? QVariant::fromValue(c->_history.values()) : c->_value;
     }
   }
   for (const auto& m : sim.getSystem()->getMeasures()) {
     if (m->_name == name) {
-      return history ? QVariant::fromValue(m->_history) : m->_history.back();
+      return history ? QVariant::fromValue(m->_history.values()) : m->value();
     }
   }
   log("no metrics with given name exist", true);
   return QVariant();
 }
 
+void ScriptInterface::setMetricSchedule(QString name, QString schedule,
+                                        double interval) {
+  Measure* measure = findMeasure(name);
+  Measure::Schedule s;
+  if (measure == nullptr) {
+    return;
+  } else if (!Measure::scheduleFromName(schedule, s)) {
+    log("schedule must be rounds, activations, time, or lazy", true);
+  } else if (s != Measure::Schedule::Lazy && interval <= 0) {
+    log("schedule interval must be positive", true);
+  } else if ((s == Measure::Schedule::Rounds ||
+              s == Measure::Schedule::Activations) &&
+             interval != static_cast<unsigned int>(interval)) {
+    log("round and activation intervals must be integers", true);
+  } else {
+    QMutexLocker locker(&sim.getSystem()->mutex);
+    AmoebotSystem* system = amoebotSystem();
+    if (system != nullptr) {
+      system->setMeasureSchedule(*measure, s, interval);
+    }
+  }
+}
+
+void ScriptInterface::detectConvergence(QStringList names,
+                                        unsigned int window, double threshold) {
+  if (window < 20 || threshold <= 0) {
+    log("convergence window must be at least 20 and threshold positive", true);
+    return;
+  }
+
+  QMutexLocker locker(&sim.getSystem()->mutex);
+  AmoebotSystem* system = amoebotSystem();
+  if (system == nullptr) {
+    return;
+  }
+  std::vector<const Measure*> measures;
+  for (const auto& name : names) {
+    const Measure* measure = nullptr;
+    for (const auto& m : system->getMeasures()) {
+      if (m->_name == name) {
+        measure = m;
+      }
+    }
+    if (measure == nullptr) {
+      log("no measure named " + name + " exists", true);
+      return;
+    } else if (measure->_schedule == Measure::Schedule::Lazy ||
+               !measure->_enabled) {
+      log("measure " + name + " is never recorded", true);
+      return;
+    }
+    measures.push_back(measure);
+  }
+  system->detectConvergence(measures, window, threshold);
+}
+
+double ScriptInterface::getEquilibrationRound() {
+  QMutexLocker locker(&sim.getSystem()->mutex);
+  AmoebotSystem* system = amoebotSystem();
+  if (system == nullptr) {
+    return -1;
+  }
+  system->flushMeasures(true);
+  return system->equilibrationRound();
+}
+
+void ScriptInterface::exportMetricsArchive(const QString filePath,
+                                           QVariantMap params) {
+  std::vector<MetricsArchive::Parameter> parameters;
+  for (auto it = params.constBegin(); it != params.constEnd(); ++it) {
+    parameters.push_back({it.key(), it.value().toString()});
+  }
+
+  QMutexLocker locker(&sim.getSystem()->mutex);
+  flushMeasures();
+  if (!MetricsArchive::write(filePath, *sim.getSystem(), parameters,
+                             RandomNumberGenerator::getSeed())) {
+    log("Could not write metrics archive", true);
+  }
+}
+
+void ScriptInterface::convertMetricsArchive(const QString binaryPath,
+                                            const QString jsonPath) {
+  if (!MetricsArchiveReader::convertToJSON(binaryPath, jsonPath)) {
+    log("Could not convert metrics archive", true);
+  }
+}
+
+void ScriptInterface::setRandomSeed(const uint seed) {
+  RandomNumberGenerator::setSeed(seed);
+}
+
+uint ScriptInterface::getRandomSeed() {
+  return RandomNumberGenerator::getSeed();
+}
+
+void ScriptInterface::setMetricStats(QString name, bool enabled,
+                                     double alpha, int maxLag) {
+  if (enabled && (alpha <= 0 || alpha > 1 || maxLag < 0)) {
+    log("stats need 0 < alpha <= 1 and a non-negative maxLag", true);
+    return;
+  }
+
+  QMutexLocker locker(&sim.getSystem()->mutex);
+  flushMeasures();
+  std::unique_ptr<OnlineStats>* stats = nullptr;
+  for (const auto& c : sim.getSystem()->getCounts()) {
+    if (c->_name == name) {
+      stats = &c->_stats;
+    }
+  }
+  for (const auto& m : sim.getSystem()->getMeasures()) {
+    if (m->_name == name) {
+      stats = &m->_stats;
+    }
+  }
+  if (stats == nullptr) {
+    log("no metrics with given name exist", true);
+  } else if (enabled) {
+    stats->reset(new OnlineStats(alpha, maxLag));
+  } else {
+    stats->reset();
+  }
+}
+
+QVariant ScriptInterface::getMetricStats(QString name) {
+  QMutexLocker locker(&sim.getSystem()->mutex);
+  flushMeasures();
+  const OnlineStats* stats = nullptr;
+  bool found = false;
+  for (const auto& c : sim.getSystem()->getCounts()) {
+    if (c->_name == name) {
+      stats = c->_stats.get();
+      found = true;
+    }
+  }
+  for (const auto& m : sim.getSystem()->getMeasures()) {
+    if (m->_name == name) {
+      stats = m->_stats.get();
+      found = true;
+    }
+  }
+  if (!found) {
+    log("no metrics with given name exist", true);
+    return QVariant();
+  } else if (stats == nullptr) {
+    log("stats are not enabled for this metric; see setMetricStats", true);
+    return QVariant();
+  }
+
+  QVariantList autocorrelation;
+  for (unsigned int k = 1; k <= stats->maxLag(); ++k) {
+    autocorrelation.append(stats->autocorrelation(k));
+  }
+  QVariantMap result;
+  result["count"] = static_cast<double>(stats->count());
+  result["mean"] = stats->mean();
+  result["variance"] = stats->variance();
+  result["stdDev"] = stats->stdDev();
+  result["min"] = stats->min();
+  result["max"] = stats->max();
+  result["ewma"] = stats->ewma();
+  result["autocorrelation"] = autocorrelation;
+  result["ess"] = stats->effectiveSampleSize();
+
+  return result;
+}
+
+void ScriptInterface::streamMetrics(const QString filePath,
+                                    const QString format) {
+  MetricsStream::Format f;
+  if (!MetricsStream::formatFromName(format, f)) {
+    log("metrics stream format must be ndjson or csv", true);
+    return;
+  }
+
+  QMutexLocker locker(&sim.getSystem()->mutex);
+  AmoebotSystem* system = amoebotSystem();
+  if (system == nullptr) {
+    return;
+  }
+  if (!system->openMetricsStream(filePath, f)) {
+    log("Could not open metrics stream file", true);
+  }
+}
+
+void ScriptInterface::stopMetricsStream() {
+  QMutexLocker locker(&sim.getSystem()->mutex);
+  AmoebotSystem* system = amoebotSystem();
+  if (system == nullptr) {
+    return;
+  }
+  system->closeMetricsStream();
+}
+
+void ScriptInterface::streamMetricsToSocket(const QString socketPath) {
+  QMutexLocker locker(&sim.getSystem()->mutex);
+  AmoebotSystem* system = amoebotSystem();
+  if (system == nullptr) {
+    return;
+  }
+  QString error;
+  if (!system->openMetricsSocket(socketPath, error)) {
+    log("Could not open metrics socket: " + error, true);
+  }
+}
+
+void ScriptInterface::stopMetricsSocket() {
+  QMutexLocker locker(&sim.getSystem()->mutex);
+  AmoebotSystem* system = amoebotSystem();
+  if (system == nullptr) {
+    return;
+  }
+  system->closeMetricsSocket();
+}
+
+void ScriptInterface::saveCheckpoint(const QString filePath) {
+  QMutexLocker locker(&sim.getSystem()->mutex);
+  AmoebotSystem* system = amoebotSystem();
+  if (system == nullptr) {
+    return;
+  }
+  QString error;
+  if (!system->saveCheckpoint(filePath, error)) {
+    log("Could not save checkpoint: " + error, true);
+  }
+}
+
+void ScriptInterface::restoreCheckpoint(const QString filePath) {
+  QMutexLocker locker(&sim.getSystem()->mutex);
+  AmoebotSystem* system = amoebotSystem();
+  if (system == nullptr) {
+    return;
+  }
+  QString error;
+  if (!system->loadCheckpoint(filePath, error)) {
+    log("Could not restore checkpoint: " + error, true);
+  }
+}
+
+void ScriptInterface::checkpointEvery(const QString filePath,
+                                      const int rounds) {
+  if (rounds < 0) {
+    log("checkpoint interval must be non-negative", true);
+    return;
+  }
+
+  QMutexLocker locker(&sim.getSystem()->mutex);
+  AmoebotSystem* system = amoebotSystem();
+  if (system == nullptr) {
+    return;
+  }
+  QString error;
+  if (rounds > 0 && !system->saveCheckpoint(filePath, error)) {
+    log("Could not save checkpoint: " + error, true);
+    return;
+  }
+  system->setCheckpointInterval(filePath, rounds);
+}
+
+void ScriptInterface::loadLayout(const QString filePath, const int originX,
+                                 const int originY, QVariantMap colors) {
+  std::map<QRgb, int> colorStates;
+  for (auto it = colors.constBegin(); it != colors.constEnd(); ++it) {
+    const QColor color(it.key());
+    if (!color.isValid()) {
+      log("unknown color " + it.key(), true);
+      return;
+    }
+    colorStates[color.rgb() & 0xffffff] = it.value().toInt();
+  }
+
+  // The file is parsed before the system is locked.
+  LatticeLayout layout;
+  QString error;
+  if (!layout.load(filePath, Node(originX, originY), colorStates, error)) {
+    log("Could not load layout: " + error, true);
+    return;
+  }
+
+  QMutexLocker locker(&sim.getSystem()->mutex);
+  AmoebotSystem* system = amoebotSystem();
+  if (system == nullptr) {
+    return;
+  }
+  if (!system->loadLayout(layout, error)) {
+    log("Could not load layout: " + error, true);
+  }
+}
+
+void ScriptInterface::recordTrajectory(const QString filePath,
+                                       const int keyframeInterval) {
+  if (keyframeInterval < 1) {
+    log("keyframe interval must be positive", true);
+    return;
+  }
+
+  QMutexLocker locker(&sim.getSystem()->mutex);
+  AmoebotSystem* system = amoebotSystem();
+  if (system == nullptr) {
+    return;
+  }
+  if (!system->openTrajectory(filePath, keyframeInterval)) {
+    log("Could not open file " + filePath, true);
+  }
+}
+
+void ScriptInterface::stopTrajectory() {
+  QMutexLocker locker(&sim.getSystem()->mutex);
+  AmoebotSystem* system = amoebotSystem();
+  if (system == nullptr) {
+    return;
+  }
+  system->closeTrajectory();
+}
+
+void ScriptInterface::exportSnapshot(const QString filePath) {
+  QMutexLocker locker(&sim.getSystem()->mutex);
+  AmoebotSystem* system = amoebotSystem();
+  if (system == nullptr) {
+    return;
+  }
+  QString error;
+  if (!system->exportSnapshot(filePath, error)) {
+    log("Could not export snapshot: " + error, true);
+  }
+}
+
+void ScriptInterface::exportSnapshotEvery(const QString pathPrefix,
+                                          const int rounds) {
+  if (rounds < 0) {
+    log("export interval must be non-negative", true);
+    return;
+  }
+
+  QMutexLocker locker(&sim.getSystem()->mutex);
+  AmoebotSystem* system = amoebotSystem();
+  if (system == nullptr) {
+    return;
+  }
+  QString error;
+  const QString filePath = pathPrefix + "_" +
+      QString::number(system->getCount("# Rounds")._value) + ".npz";
+  if (rounds > 0 && !system->exportSnapshot(filePath, error)) {
+    log("Could not export snapshot: " + error, true);
+    return;
+  }
+  system->setSnapshotInterval(pathPrefix, rounds);
+}
+
+void ScriptInterface::publishTelemetry(const QString name, const int rounds) {
+  if (rounds < 0) {
+    log("telemetry interval must be non-negative", true);
+    return;
+  }
+
+  QMutexLocker locker(&sim.getSystem()->mutex);
+  AmoebotSystem* system = amoebotSystem();
+  if (system == nullptr) {
+    return;
+  }
+  QString error;
+  if (!system->openTelemetry(name, rounds, error)) {
+    log("Could not publish telemetry: " + error, true);
+  }
+}
+
+void ScriptInterface::stopTelemetry() {
+  QMutexLocker locker(&sim.getSystem()->mutex);
+  AmoebotSystem* system = amoebotSystem();
+  if (system == nullptr) {
+    return;
+  }
+  system->closeTelemetry();
+}
+
+void ScriptInterface::replayTrajectory(const QString filePath) {
+  sim.openReplay(filePath);
+}
+
+void ScriptInterface::seekReplay(const int round) {
+  if (sim.replayInfo().toList().isEmpty()) {
+    log("no replay is shown", true);
+    return;
+  }
+  sim.seekReplay(round);
+}
+
+void ScriptInterface::setReplaySpeed(const int rounds) {
+  if (sim.replayInfo().toList().isEmpty()) {
+    log("no replay is shown", true);
+    return;
+  } else if (rounds < 1) {
+    log("replay speed must be positive", true);
+    return;
+  }
+  sim.setReplaySpeed(rounds);
+}
+
+void ScriptInterface::setMetricHistory(QString name, QString policy,
+                                       QVariant arg) {
+  QMutexLocker locker(&sim.getSystem()->mutex);
+  for (const auto& c : sim.getSystem()->getCounts()) {
+    if (c->_name == name) {
+      setHistoryPolicy(c->_history, policy, arg);
+      return;
+    }
+  }
+  flushMeasures();
+  for (const auto& m : sim.getSystem()->getMeasures()) {
+    if (m->_name == name) {
+      setHistoryPolicy(m->_history, policy, arg);
+      return;
+    }
+  }
+  log("no metrics with given name exist", true);
+}
+
+void ScriptInterface::setParallelMetrics(bool parallel) {
+  QMutexLocker locker(&sim.getSystem()->mutex);
+  AmoebotSystem* system = amoebotSystem();
+  if (system == nullptr) {
+    return;
+  }
+  system->setParallelMeasures(parallel);
+}
+
+void ScriptInterface::setMetricEnabled(QString name, bool enabled) {
+  Measure* measure = findMeasure(name);
+  if (measure != nullptr) {
+    QMutexLocker locker(&sim.getSystem()->mutex);
+    measure->_enabled = enabled;
+  }
+}
+
 void ScriptInterface::setWindowSize(int width, int height) {
   if(vis != nullptr) {
     vis->setWindowSize(width, height);
@@ -122,7 +586,7 @@ void ScriptInterface::filmSimulation(QString filePath, const int stepLimit) {
   }
 
   int i = 0;
-  while(!sim.getSystem()->hasTerminated() && i < stepLimit) {
+  while(!Simulator::hasFinished(*sim.getSystem()) && i < stepLimit) {
     emit vis->beforeRendering();  // Updates GUI #rounds and #movements labels.
     saveScreenshot(filePath + pad(i,fnameLen) + QString(".png"));
     step();
@@ -130,6 +594,88 @@ void ScriptInterface::filmSimulation(QString filePath, const int stepLimit) {
   }
 }
 
+void ScriptInterface::renderFrame(const QString filePath, const int width,
+                                  const int height) {
+  if (width < 1 || height < 1) {
+    log("image size must be positive", true);
+    return;
+  }
+
+  LatticeRenderer renderer(width, height);
+  QImage image;
+  {
+    QMutexLocker locker(&sim.getSystem()->mutex);
+    renderer.fit(*sim.getSystem());
+    image = renderer.render(*sim.getSystem());
+  }
+  if (!image.save(filePath)) {
+    log("Could not save image " + filePath, true);
+  }
+}
+
+void ScriptInterface::renderSimulation(const QString filePath,
+                                       const int frameRounds,
+                                       const int roundLimit, const int width,
+                                       const int height) {
+  if (width < 1 || height < 1) {
+    log("image size must be positive", true);
+    return;
+  } else if (frameRounds < 1) {
+    log("frame interval must be positive", true);
+    return;
+  } else if (roundLimit < 0) {
+    log("round limit must be non-negative", true);
+    return;
+  }
+
+  const int numFrames = roundLimit / frameRounds + 1;
+  const int fnameLen = QString::number(numFrames - 1).length();
+  std::shared_ptr<System> system = sim.getSystem();
+  LatticeRenderer renderer(width, height);
+  FrameEncoder encoder;
+  unsigned int firstRound;
+  {
+    QMutexLocker locker(&system->mutex);
+    renderer.fit(*system);
+    firstRound = system->getCount("# Rounds")._value;
+  }
+
+  // The system is locked while it runs to the next frame and is drawn, but
+  // not while earlier frames are encoded.
+  for (int frame = 0; frame < numFrames; ++frame) {
+    const unsigned int round = firstRound + frame * frameRounds;
+    QMutexLocker locker(&system->mutex);
+    while (system->getCount("# Rounds")._value < round &&
+           !Simulator::hasFinished(*system)) {
+      system->activate();
+    }
+    if (system->getCount("# Rounds")._value < round) {
+      break;
+    }
+    const QImage image = renderer.render(*system);
+    locker.unlock();
+    encoder.encode(image, filePath + pad(frame, fnameLen) + ".png");
+  }
+
+  const int failures = encoder.waitForDone();
+  if (failures > 0) {
+    log("Could not save " + QString::number(failures) + " frames to " +
+        filePath, true);
+  }
+}
+
+void ScriptInterface::startRecording(const QString filePath, const bool raw) {
+  if (vis != nullptr && !vis->startRecording(filePath, raw)) {
+    log("Could not open file " + filePath, true);
+  }
+}
+
+void ScriptInterface::stopRecording() {
+  if (vis != nullptr) {
+    vis->stopRecording();
+  }
+}
+
 QString ScriptInterface::pad(const int number, const int length) {
   QString str = "" + QString::number(number);
 
@@ -139,3 +685,54 @@ QString ScriptInterface::pad(const int number, const int length) {
 
   return str;
 }
+
+AmoebotSystem* ScriptInterface::amoebotSystem() {
+  AmoebotSystem* system = dynamic_cast<AmoebotSystem*>(sim.getSystem().get());
+  if (system == nullptr) {
+    log("not supported during replay", true);
+  }
+  return system;
+}
+
+void ScriptInterface::flushMeasures() {
+  AmoebotSystem* system = dynamic_cast<AmoebotSystem*>(sim.getSystem().get());
+  if (system != nullptr) {
+    system->flushMeasures(true);
+  }
+}
+
+Measure* ScriptInterface::findMeasure(const QString name) {
+  for (const auto& m : sim.getSystem()->getMeasures()) {
+    if (m->_name == name) {
+      return m;
+    }
+  }
+  log("no measure with given name exists", true);
+  return nullptr;
+}
+
+template<class T>
+void ScriptInterface::setHistoryPolicy(History<T>& history,
+                                       const QString policy,
+                                       const QVariant arg) {
+  if (policy == "unbounded") {
+    history.setUnbounded();
+  } else if (policy == "ring" || policy == "downsampled") {
+    bool ok = false;
+    const int capacity = arg.toInt(&ok);
+    if (!ok || capacity < (policy == "ring" ? 1 : 2)) {
+      log("history capacity must be at least 1 (ring) or 2 (downsampled)",
+          true);
+    } else if (policy == "ring") {
+      history.setRing(capacity);
+    } else {
+      history.setDownsampled(capacity);
+    }
+  } else if (policy == "spill") {
+    if (!history.setSpill(arg.toString())) {
+      log("could not open history spill file", true);
+    }
+  } else {
+    log("history policy must be unbounded, ring, downsampled, or spill", true);
+  }
+}
@@ -9,9 +9,13 @@
 
 #include <QObject>
 #include <QString>
+#include <QStringList>
+#include <QVariantMap>
 
+#include "core/amoebotsystem.h"
 #include "core/simulator.h"
 #include "script/scriptengine.h"
+#include "script/scriptfiles.h"
 #include "ui/visitem.h"
 
 class ScriptInterface : public QObject {
@@ -20,54 +24,223 @@ class ScriptInterface : public QObject {
  public:
   explicit ScriptInterface(ScriptEngine& engine, Simulator& sim, VisItem* vis);
 
+  // Writes the text buffered for all files opened by scripts out; called by the
+  // engine whenever a script finishes.
+  void flushFiles();
+
  public slots:
   // Script commands. log writes a message to the simulator engine, optionally
   // flagging an error. runScript loads a JavaScript script from the provided
   // filepath and executes it. writeToFile appends the specified text to a file
-  // at the given location.
+  // at the given location, keeping the file open for further writes.
   void log(const QString msg, bool error = false);
   void runScript(const QString scriptFilePath);
   void writeToFile(const QString filePath, const QString text);
 
+  // File commands (see scriptfiles.h). openFile opens the file at filePath for
+  // appending and returns its handle, or -1 (and logs an error) if it cannot
+  // be opened; a file that is already open keeps its handle. write appends the
+  // given text to the file with the given handle, and closeFile closes it.
+  // Text is buffered and written out as it accumulates, whenever a script
+  // finishes, and when its file is closed. Errors are logged for unknown
+  // handles and files that cannot be written.
+  int openFile(const QString filePath);
+  void write(const int handle, const QString text);
+  void closeFile(const int handle);
+
   // Simulator flow commands. step executes a single particle activation.
   // setStepDuration sets the simulator's delay between particle activations to
   // the given value; if this value is negative, an error is logged and the step
   // duration is set to 0. runUntilTermination runs the current algorithm
-  // instance until its hasTerminated function returns true.
+  // instance until its hasTerminated function returns true or its monitored
+  // measures converge (see detectConvergence).
   void step();
   void setStepDuration(const int ms);
   void runUntilTermination();
 
   // Simulator metrics commands. getNumParticles and getNumObjects return the
   // number of particles and objects in the given instance, respectively.
-  // exportMetrics writes the metrics to JSON. See simulator.h for further
-  // discussion. getMetric returns either the current value (history = false)
-  // or the historical data (history = true) of the metric with parameter-
-  // defined name.
+  // exportMetrics writes the metrics to JSON, or flushes the metrics stream if
+  // one is open. See simulator.h for further discussion. getMetric returns
+  // either the current value (history = false) or the historical data
+  // (history = true) of the metric with parameter-defined name.
   int getNumParticles();
   int getNumObjects();
   void exportMetrics();
   QVariant getMetric(QString name, bool history = false);
 
+  // Measure scheduling commands. setMetricSchedule sets when the named measure
+  // is recorded: every interval "rounds", "activations", or units of simulated
+  // "time", or "lazy" to calculate it only when its value is requested.
+  // setMetricEnabled enables or disables the named measure; disabled measures
+  // are never calculated. Errors are logged for unknown measures, schedules,
+  // or invalid intervals. setParallelMetrics toggles evaluating the measures
+  // that support it on worker threads against snapshots of the system.
+  void setMetricSchedule(QString name, QString schedule, double interval = 1);
+  void setMetricEnabled(QString name, bool enabled);
+  void setParallelMetrics(bool parallel);
+
+  // Metric statistics commands (see onlinestats.h). setMetricStats starts
+  // (enabled = true) or stops maintaining streaming statistics of the values
+  // the named metric records from now on, using the given EWMA smoothing
+  // factor and maximum autocorrelation lag. getMetricStats returns these
+  // statistics as an object with fields count, mean, variance, stdDev, min,
+  // max, ewma, autocorrelation (an array for lags 1, ..., maxLag), and ess.
+  void setMetricStats(QString name, bool enabled = true, double alpha = 0.1,
+                      int maxLag = 10);
+  QVariant getMetricStats(QString name);
+
+  // Convergence commands (see convergencedetector.h). detectConvergence stops
+  // runs once the named measures have all been stationary over their last
+  // window recordings, judged by a Geweke z-score below threshold; an empty
+  // list stops the detection. getEquilibrationRound returns the round from
+  // which the measures were stationary, or -1 if they have not converged.
+  void detectConvergence(QStringList names, unsigned int window = 200,
+                         double threshold = 2.0);
+  double getEquilibrationRound();
+
+  // Metrics archive commands (see metricsarchive.h). exportMetricsArchive
+  // writes all metric histories to a compact binary file at filePath, together
+  // with the given run parameters (e.g., {algorithm: "compression", n: 100})
+  // and the random seed. convertMetricsArchive converts such a file to
+  // the metrics JSON format. setRandomSeed reseeds the simulator's random
+  // number generator so that runs can be reproduced; getRandomSeed returns the
+  // current seed.
+  void exportMetricsArchive(const QString filePath,
+                            QVariantMap params = QVariantMap());
+  void convertMetricsArchive(const QString binaryPath, const QString jsonPath);
+  void setRandomSeed(const uint seed);
+  uint getRandomSeed();
+
+  // Metrics streaming commands. streamMetrics appends every count and measure
+  // value to the file at filePath as it is recorded, in the given format
+  // ("ndjson" or "csv"); exportMetrics then only flushes this file.
+  // stopMetricsStream writes any outstanding values and closes the file.
+  void streamMetrics(const QString filePath, const QString format = "ndjson");
+  void stopMetricsStream();
+
+  // Metrics socket commands (see metricssocket.h). streamMetricsToSocket sends
+  // the values recorded in each round to the Unix domain datagram socket bound
+  // at socketPath, dropping frames the receiver is not ready for.
+  // stopMetricsSocket sends any outstanding values and closes the socket.
+  void streamMetricsToSocket(const QString socketPath);
+  void stopMetricsSocket();
+
+  // Sets the memory policy of the named metric's history (see history.h):
+  // "unbounded", "ring" or "downsampled" with the capacity given as arg, or
+  // "spill" with the path of the file to spill to given as arg.
+  void setMetricHistory(QString name, QString policy,
+                        QVariant arg = QVariant());
+
+  // Checkpoint commands (see amoebotsystem.h). saveCheckpoint writes the
+  // complete state of the current system, including its metrics and the random
+  // number generator, to the file at filePath. restoreCheckpoint replaces the
+  // current system's state by the one saved at filePath; the system must run
+  // the same algorithm with the same parameters, and the run then continues
+  // exactly as the saved one did. checkpointEvery saves a checkpoint right away
+  // and then after every rounds-th round, replacing the file each time; 0
+  // rounds stops periodic checkpoints. Errors are logged for algorithms
+  // without checkpoint support and for files that cannot be written or do not
+  // fit the current system.
+  void saveCheckpoint(const QString filePath);
+  void restoreCheckpoint(const QString filePath);
+  void checkpointEvery(const QString filePath, const int rounds);
+
+  // Loads the particles and objects of the lattice file at filePath (see
+  // latticelayout.h) into the current system, replacing its particles, with
+  // the file's bottom-left node at (originX, originY). colors maps the colors
+  // of images (e.g., "#ff0000") to particle state codes. Errors are logged for
+  // unreadable files and layouts that do not fit the system or its algorithm.
+  void loadLayout(const QString filePath, const int originX = 0,
+                  const int originY = 0, QVariantMap colors = QVariantMap());
+
+  // Trajectory commands (see trajectory.h). recordTrajectory starts recording
+  // every change of the current system to the file at filePath, with a full
+  // keyframe of the configuration every keyframeInterval rounds, replacing any
+  // recording in progress. stopTrajectory finishes the file.
+  void recordTrajectory(const QString filePath,
+                        const int keyframeInterval = 100);
+  void stopTrajectory();
+
+  // Snapshot export commands (see snapshotexporter.h). exportSnapshot writes
+  // the current configuration as a NumPy archive to the file at filePath.
+  // exportSnapshotEvery does so right away and then after every rounds-th
+  // round, writing to <pathPrefix>_<round>.npz; 0 rounds stops periodic
+  // exports. Errors are logged for files that cannot be written.
+  void exportSnapshot(const QString filePath);
+  void exportSnapshotEvery(const QString pathPrefix, const int rounds);
+
+  // Telemetry commands (see telemetrypublisher.h). publishTelemetry publishes
+  // the current state to the shared memory segment with the given name and
+  // then after every rounds-th round (0 publishes once), replacing any segment
+  // published before. stopTelemetry removes the segment. Errors are logged if
+  // the segment cannot be created.
+  void publishTelemetry(const QString name, const int rounds = 1);
+  void stopTelemetry();
+
+  // Replay commands (see replaysystem.h). replayTrajectory replaces the current
+  // algorithm instance by a replay of the trajectory at filePath, which the
+  // simulator flow commands then play back. seekReplay shows the given round,
+  // and setReplaySpeed sets the number of rounds each step advances the replay
+  // by. Errors are logged if no replay is shown or the speed is not positive.
+  void replayTrajectory(const QString filePath);
+  void seekReplay(const int round);
+  void setReplaySpeed(const int rounds);
+
   // Visualization commands. focusOn centers the window at the given (x,y) node.
   // setZoom sets the zoom level of the window. saveScreenshot saves the current
   // window as a .png in the specified location; if no filepath is provided, a
   // default path is created that ensures no previous screenshots are
   // overwritten. filmSimulation saves a series of screenshots to the specified
-  // location, up to the specified number of steps.
+  // location, up to the specified number of steps. renderFrame and
+  // renderSimulation draw images of the given size with the software renderer
+  // (see latticerenderer.h) instead, which needs no window: renderFrame saves
+  // one image of the current configuration, while renderSimulation runs the
+  // system for up to roundLimit rounds and saves a frame every frameRounds
+  // rounds, encoding frames in the background while the system runs on.
+  // startRecording captures every frame the window renders from then on until
+  // stopRecording, saving them to filePath followed by their number and .png
+  // or, if raw is true, streaming their RGBA pixels into the file at filePath
+  // at the size of the first frame; frames are read back and encoded in the
+  // background, so the simulation is never stalled.
   void setWindowSize(int width = 800, int height = 600);
   void focusOn(int x, int y);
   void setZoom(float zoom);
   void saveScreenshot(QString filePath = "");
   void filmSimulation(QString filePath, const int stepLimit);
+  void renderFrame(const QString filePath, const int width = 1920,
+                   const int height = 1080);
+  void renderSimulation(const QString filePath, const int frameRounds,
+                        const int roundLimit, const int width = 1920,
+                        const int height = 1080);
+  void startRecording(const QString filePath, const bool raw = false);
+  void stopRecording();
 
  private:
   ScriptEngine& engine;
   Simulator& sim;
   VisItem* vis;
+  ScriptFiles files;
 
   // Pads the given number with leading zeroes to achieve the specified length.
   QString pad(const int number, const int length);
+
+  // Applies the given history policy and argument to the given history,
+  // logging an error if they are invalid.
+  template<class T>
+  void setHistoryPolicy(History<T>& history, const QString policy,
+                        const QVariant arg);
+
+  // Returns the current system's measure with the given name, or nullptr (and
+  // logs an error) if there is no such measure.
+  Measure* findMeasure(const QString name);
+
+  // Returns the current system if it runs an algorithm, or nullptr (and logs
+  // an error) if it is a replay, which does not support the calling command.
+  AmoebotSystem* amoebotSystem();
+
+  // Flushes the current system's pending measures, if it has any.
+  void flushMeasures();
 };
 
 #endif  // AMOEBOTSIM_SCRIPT_SCRIPTINTERFACE_H_
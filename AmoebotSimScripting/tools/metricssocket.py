@@ -0,0 +1,87 @@
+# Copyright (C) 2021 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+# The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+# notice can be found at the top of main/main.cpp.
+
+"""Receives the metrics AmoebotSim sends with streamMetricsToSocket().
+
+Run as a script, this prints one CSV line per received frame:
+
+    python3 tools/metricssocket.py /tmp/amoebotsim.sock "% Ordering" ...
+
+Plotting scripts can import it instead; receive(socketPath) yields the values
+of each frame. The frame format is described in core/metricssocket.h.
+"""
+
+import argparse
+import os
+import socket
+import struct
+import sys
+
+VALUES_HEADER = struct.Struct("<cIIH")
+VALUE = struct.Struct("<HId")
+
+
+def receive(socket_path):
+    """Binds the socket and yields a dictionary for every values frame received,
+    mapping metric names to (round, value) pairs, with the number of frames
+    dropped so far under the key None. Frames arriving before the metric names
+    are skipped."""
+    if os.path.exists(socket_path):
+        os.unlink(socket_path)
+    sock = socket.socket(socket.AF_UNIX, socket.SOCK_DGRAM)
+    sock.bind(socket_path)
+    names = None
+    try:
+        while True:
+            frame = sock.recv(65536)
+            if frame[:1] == b"N":
+                count, = struct.unpack_from("<H", frame, 1)
+                names, offset = [], 3
+                for _ in range(count):
+                    length, = struct.unpack_from("<H", frame, offset)
+                    offset += 2
+                    names.append(frame[offset:offset + length].decode("utf-8"))
+                    offset += length
+            elif frame[:1] == b"V" and names is not None:
+                _, _, dropped, count = VALUES_HEADER.unpack_from(frame)
+                values = {None: dropped}
+                for i in range(count):
+                    index, rnd, value = VALUE.unpack_from(
+                        frame, VALUES_HEADER.size + i * VALUE.size)
+                    values[names[index]] = (rnd, value)
+                yield values
+    finally:
+        sock.close()
+        os.unlink(socket_path)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("socket", help="the path given to "
+                        "streamMetricsToSocket()")
+    parser.add_argument("metrics", nargs="*",
+                        help="the metrics to print (default: all received)")
+    args = parser.parse_args()
+
+    columns = args.metrics
+    last = {}
+    try:
+        for values in receive(args.socket):
+            if not columns:
+                columns = sorted(name for name in values if name is not None)
+            if all(name not in values for name in columns):
+                continue
+            if not last:
+                print(",".join(["round"] + columns), flush=True)
+            last.update(values)
+            rnd = max(last[name][0] for name in columns if name in last)
+            print(",".join([str(rnd)] + [
+                repr(last[name][1]) if name in last else ""
+                for name in columns]), flush=True)
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,158 @@
+# Copyright (C) 2021 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+# The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+# notice can be found at the top of main/main.cpp.
+
+"""Reads the telemetry AmoebotSim publishes with publishTelemetry().
+
+Run as a script, this shows the state in the named segment like top:
+
+    python3 tools/telemetry.py amoebotsim [--interval SECONDS] [--image]
+
+Dashboards can import it instead; read(name) returns the latest state as a
+dictionary. The segment layout is described in core/telemetrypublisher.h.
+"""
+
+import argparse
+import math
+import struct
+import sys
+import time
+from multiprocessing import resource_tracker, shared_memory
+
+HEADER = struct.Struct("=8sIIIIIIIiiiQQQdq")
+METRIC = struct.Struct("=56sd")
+MAX_METRICS = 64
+MAX_IMAGE_SIZE = 256
+SEGMENT_SIZE = HEADER.size + MAX_METRICS * METRIC.size + MAX_IMAGE_SIZE ** 2
+
+
+def attach(name):
+    """Maps the named segment for reading without ever removing it."""
+    try:
+        shm = shared_memory.SharedMemory(name=name, track=False)
+    except TypeError:  # Python < 3.13 tracks and unlinks attached segments.
+        shm = shared_memory.SharedMemory(name=name)
+        resource_tracker.unregister(shm._name, "shared_memory")
+    if shm.size < SEGMENT_SIZE or bytes(shm.buf[:8]) != b"AMBTELEM":
+        shm.close()
+        raise ValueError("%s is not an AmoebotSim telemetry segment" % name)
+    return shm
+
+
+def decode(buf):
+    """Returns a consistent copy of the state in the given mapped segment."""
+    while True:
+        before = struct.unpack_from("=I", buf, 12)[0]
+        if before % 2 == 1:
+            time.sleep(0.0001)
+            continue
+        data = bytes(buf[:SEGMENT_SIZE])
+        if struct.unpack_from("=I", buf, 12)[0] == before:
+            break
+
+    (_, version, _, active, num_counts, num_measures, width, height, origin_x,
+     origin_y, cell_size, rounds, activations, num_particles, sim_time,
+     published_at) = HEADER.unpack_from(data)
+    if version != 1:
+        raise ValueError("unsupported telemetry version %d" % version)
+
+    metrics = []
+    for i in range(num_counts + num_measures):
+        name, value = METRIC.unpack_from(data, HEADER.size + i * METRIC.size)
+        metrics.append((name.split(b"\0", 1)[0].decode("utf-8"), value))
+    offset = HEADER.size + MAX_METRICS * METRIC.size
+    return {
+        "active": bool(active),
+        "round": rounds,
+        "activation": activations,
+        "particles": num_particles,
+        "time": sim_time,
+        "published_at": published_at / 1000.0,
+        "counts": dict(metrics[:num_counts]),
+        "measures": dict(metrics[num_counts:]),
+        "image": {
+            "width": width,
+            "height": height,
+            "origin": (origin_x, origin_y),
+            "cell_size": cell_size,
+            "pixels": data[offset:offset + width * height],
+        },
+    }
+
+
+def read(name):
+    """Returns the latest state published to the named segment."""
+    shm = attach(name)
+    try:
+        return decode(shm.buf)
+    finally:
+        shm.close()
+
+
+def thumbnail(image, columns):
+    """Renders the occupancy image as text at most the given columns wide."""
+    width, height, pixels = image["width"], image["height"], image["pixels"]
+    if width == 0:
+        return []
+    step = max(1, math.ceil(width / columns))
+    shades = " .:-=+*#%@"
+    lines = []
+    for top in range(0, height, 2 * step):  # Characters are about 2:1.
+        line = ""
+        for left in range(0, width, step):
+            cells = [pixels[y * width + x]
+                     for y in range(top, min(top + 2 * step, height))
+                     for x in range(left, min(left + step, width))]
+            line += shades[max(cells) * (len(shades) - 1) // 255]
+        lines.append(line.rstrip())
+    return lines
+
+
+def show(state, image, clear):
+    age = time.time() - state["published_at"]
+    lines = ["round %d   activation %d   particles %d   time %.2f   %s" % (
+        state["round"], state["activation"], state["particles"], state["time"],
+        "updated %.1fs ago" % age if state["active"] else "stopped"), ""]
+    for kind in ("counts", "measures"):
+        for name, value in state[kind].items():
+            lines.append("  %-40s %s" % (name, "-" if math.isnan(value)
+                                         else "%.6g" % value))
+        lines.append("")
+    if image:
+        lines += thumbnail(state["image"], 80)
+    sys.stdout.write(("\x1b[H\x1b[2J" if clear else "") + "\n".join(lines) +
+                     "\n")
+    sys.stdout.flush()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("name", help="the segment name given to "
+                        "publishTelemetry()")
+    parser.add_argument("--interval", type=float, default=1.0,
+                        help="seconds between refreshes (default: 1)")
+    parser.add_argument("--image", action="store_true",
+                        help="also show the occupancy image")
+    parser.add_argument("--once", action="store_true",
+                        help="print the state once and exit")
+    args = parser.parse_args()
+
+    try:
+        shm = attach(args.name)
+    except (FileNotFoundError, ValueError) as e:
+        sys.exit("telemetry.py: %s" % e)
+    try:
+        while True:
+            state = decode(shm.buf)
+            show(state, args.image, not args.once)
+            if args.once or not state["active"]:
+                break
+            time.sleep(args.interval)
+    except KeyboardInterrupt:
+        pass
+    finally:
+        shm.close()
+
+
+if __name__ == "__main__":
+    main()
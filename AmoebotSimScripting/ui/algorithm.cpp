@@ -143,12 +143,15 @@ CompressionAlg::CompressionAlg() : Algorithm("Compression", "compression") {
   addParameter("Detach from Line", "1.2");
   addParameter("Adsorption rate ", "8000");
   addParameter("Desorption rate ", "2000");
+  addParameter("Surface Side Length", "50");
+  addParameter("Periodic (0/1)", "0");
 }
 
 void CompressionAlg::instantiate(const int numRedParticles, const int numBlueParticles,
 const int numGreenParticles, const double lambda, const double diffusionRate,
 const double bindingAffinity, const double seperationAffinity, const double convertToStable,
-const double detachFromLine, const int adsorptionRate, const int desorptionRate) {
+const double detachFromLine, const int adsorptionRate, const int desorptionRate,
+const int sideLen, const int periodic) {
     if (numRedParticles <= 0) {
       emit log("# red particles must be > 0", true);
     }
@@ -182,11 +185,18 @@ const double detachFromLine, const int adsorptionRate, const int desorptionRate)
     else if (desorptionRate <= 0) {
       emit log("desorption rate must be > 0", true);
     }
+    else if (sideLen < 3) {
+      emit log("surface side length must be >= 3", true);
+    }
+    else if (periodic != 0 && periodic != 1) {
+      emit log("periodic must be 0 or 1", true);
+    }
     else {
       //emit setSystem(std::make_shared<CompressionSystem>(numRedParticles, numBlueParticles, numGreenParticles));
       emit setSystem(std::make_shared<CompressionSystem>(numRedParticles, numBlueParticles,
       numGreenParticles, lambda, diffusionRate, bindingAffinity, seperationAffinity,
-      convertToStable, detachFromLine, adsorptionRate, desorptionRate));
+      convertToStable, detachFromLine, adsorptionRate, desorptionRate,
+      sideLen, periodic == 1));
     }
   }
 
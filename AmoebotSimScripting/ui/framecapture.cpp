@@ -0,0 +1,162 @@
+/* Copyright (C) 2021 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+#include "ui/framecapture.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <QOpenGLContext>
+
+FrameCapture::FrameCapture(const QString filePath, const bool raw) :
+  filePath(filePath),
+  raw(raw),
+  open(true),
+  glfn(nullptr),
+  usePbos(false),
+  pbos{0, 0},
+  pending{false, false},
+  nextPbo(0),
+  numFrames(0) {
+  if (raw) {
+    open = encoder.openStream(filePath);
+  }
+}
+
+bool FrameCapture::isOpen() const {
+  return open;
+}
+
+QString FrameCapture::path() const {
+  return filePath;
+}
+
+FrameCapture::~FrameCapture() {
+  Q_ASSERT(fbo == nullptr);  // finish must have released the OpenGL objects.
+  encoder.waitForDone();
+}
+
+QRect FrameCapture::begin(QOpenGLFunctions_2_0* functions, const int width,
+                          const int height) {
+  if (glfn == nullptr) {
+    // Pixel buffers are core in OpenGL 2.1; older contexts read back directly.
+    glfn = functions;
+    const QOpenGLContext* context = QOpenGLContext::currentContext();
+    usePbos = context->format().version() >= qMakePair(2, 1) ||
+              context->hasExtension("GL_ARB_pixel_buffer_object");
+    if (usePbos) {
+      glfn->glGenBuffers(2, pbos);
+    }
+  }
+
+  if (raw && fbo != nullptr) {
+    // The stream keeps the size of its first frame, so the frame is scaled to
+    // fit and centered on a black background.
+    const double scale = std::min(double(fbo->width()) / width,
+                                  double(fbo->height()) / height);
+    const int scaledWidth = std::max(1, qRound(width * scale));
+    const int scaledHeight = std::max(1, qRound(height * scale));
+    fbo->bind();
+    if (scaledWidth != fbo->width() || scaledHeight != fbo->height()) {
+      glfn->glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+      glfn->glClear(GL_COLOR_BUFFER_BIT);
+    }
+    return QRect((fbo->width() - scaledWidth) / 2,
+                 (fbo->height() - scaledHeight) / 2, scaledWidth, scaledHeight);
+  } else if (fbo == nullptr || fbo->width() != width ||
+             fbo->height() != height) {
+    // Frames of the old size are collected before the buffers are resized.
+    collect(nextPbo ^ 1);
+    fbo.reset(new QOpenGLFramebufferObject(width, height));
+    if (usePbos) {
+      for (int i = 0; i < 2; ++i) {
+        glfn->glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[i]);
+        glfn->glBufferData(GL_PIXEL_PACK_BUFFER, 4 * width * height, nullptr,
+                           GL_STREAM_READ);
+      }
+      glfn->glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+  }
+
+  fbo->bind();
+  return QRect(0, 0, width, height);
+}
+
+void FrameCapture::end() {
+  const int width = fbo->width();
+  const int height = fbo->height();
+  if (usePbos) {
+    // Start reading this frame back and collect the previous one, whose
+    // transfer had a whole frame to complete.
+    glfn->glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[nextPbo]);
+    glfn->glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE,
+                       nullptr);
+    glfn->glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    pending[nextPbo] = true;
+    nextPbo ^= 1;
+    collect(nextPbo);
+  } else {
+    QImage image(width, height, QImage::Format_RGBA8888);
+    glfn->glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE,
+                       image.bits());
+    submit(image.mirrored());
+  }
+
+  fbo->release();
+}
+
+void FrameCapture::finish() {
+  if (glfn == nullptr) {
+    return;  // Nothing was captured.
+  }
+
+  collect(nextPbo ^ 1);
+  if (usePbos) {
+    glfn->glDeleteBuffers(2, pbos);
+  }
+  fbo = nullptr;
+  glfn = nullptr;
+}
+
+int FrameCapture::waitForDone() {
+  Q_ASSERT(fbo == nullptr);  // finish must have collected the last frame.
+  return encoder.waitForDone();
+}
+
+void FrameCapture::collect(const int pbo) {
+  if (!pending[pbo]) {
+    return;
+  }
+  pending[pbo] = false;
+
+  // OpenGL reads rows from the bottom up, so they are copied in reverse.
+  const int width = fbo->width();
+  const int height = fbo->height();
+  QImage image(width, height, QImage::Format_RGBA8888);
+  glfn->glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[pbo]);
+  const uchar* pixels = static_cast<const uchar*>(
+      glfn->glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY));
+  if (pixels != nullptr) {
+    for (int y = 0; y < height; ++y) {
+      std::memcpy(image.scanLine(height - 1 - y), pixels + 4 * width * y,
+                  4 * width);
+    }
+    glfn->glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+  }
+  glfn->glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+  if (pixels != nullptr) {
+    submit(image);
+  }
+}
+
+void FrameCapture::submit(const QImage& image) {
+  if (raw) {
+    encoder.stream(image);
+  } else {
+    encoder.encode(image, filePath +
+                   QString::number(numFrames).rightJustified(6, '0') + ".png");
+  }
+  ++numFrames;
+}
@@ -0,0 +1,85 @@
+/* Copyright (C) 2021 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+// Defines the capture of rendered frames for movies (see
+// VisItem::startRecording). Frames are drawn into an offscreen framebuffer,
+// whose pixels are read back asynchronously into one of two pixel buffers: a
+// frame's readback is only collected once the next frame has been drawn, so
+// the transfer overlaps with rendering instead of stalling it. Collected
+// frames are handed to a FrameEncoder, which saves them as a numbered .png
+// sequence or streams them as raw RGBA pixels (e.g., into a named pipe read by
+// a video encoder) in the background. A raw stream has no per-frame header, so
+// all of its frames have the size of the first one; frames drawn after the
+// window was resized are scaled to fit, keeping their aspect ratio. Except for
+// waitForDone, all functions must be called by the thread owning the OpenGL
+// context, with the context current.
+
+#ifndef AMOEBOTSIM_UI_FRAMECAPTURE_H_
+#define AMOEBOTSIM_UI_FRAMECAPTURE_H_
+
+#include <memory>
+
+#include <QImage>
+#include <QOpenGLFramebufferObject>
+#include <QOpenGLFunctions_2_0>
+#include <QRect>
+#include <QString>
+
+#include "core/frameencoder.h"
+
+class FrameCapture {
+ public:
+  // Constructs a capture that saves frames to filePath followed by the frame
+  // number and .png or, if raw is true, streams them into the file at
+  // filePath. isOpen checks whether the stream could be opened. Neither needs
+  // an OpenGL context.
+  FrameCapture(const QString filePath, const bool raw);
+  bool isOpen() const;
+  QString path() const;
+
+  // Waits for all frames handed to the encoder to be written.
+  ~FrameCapture();
+
+  // Functions for capturing a frame. begin binds the offscreen framebuffer,
+  // (re)creating it with the given size in pixels if necessary (but only for
+  // the first frame of a raw stream), so that the frame can be drawn into it,
+  // and returns the part of the framebuffer to draw the frame into. end starts
+  // reading the frame back, hands the previous frame to the encoder, and binds
+  // the window's framebuffer again. finish collects the last frame and
+  // releases the OpenGL objects.
+  QRect begin(QOpenGLFunctions_2_0* functions, const int width,
+              const int height);
+  void end();
+  void finish();
+
+  // Waits for all frames handed to the encoder to be written and returns the
+  // number of frames that could not be saved or streamed. Unlike the functions
+  // above, it may be called by any thread once finish was called, so that a
+  // finished recording can be written out without stalling rendering.
+  int waitForDone();
+
+ private:
+  // Copies the frame read back into the given pixel buffer, if any, and hands
+  // it to the encoder.
+  void collect(const int pbo);
+
+  // Hands the given frame to the encoder.
+  void submit(const QImage& image);
+
+  const QString filePath;
+  const bool raw;
+  bool open;
+
+  QOpenGLFunctions_2_0* glfn;
+  std::unique_ptr<QOpenGLFramebufferObject> fbo;
+  bool usePbos;
+  GLuint pbos[2];
+  bool pending[2];
+  int nextPbo;
+
+  FrameEncoder encoder;
+  int numFrames;
+};
+
+#endif  // AMOEBOTSIM_UI_FRAMECAPTURE_H_
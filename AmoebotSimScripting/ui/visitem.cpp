@@ -11,6 +11,7 @@
 #include <QOpenGLFunctions_2_0>
 #include <QQuickWindow>
 #include <QRgb>
+#include <QRunnable>
 
 // visualisation preferences
 static constexpr float targetFramesPerSecond = 60.0f;
@@ -21,9 +22,37 @@ static constexpr float targetFrameDuration = 1000.0f / targetFramesPerSecond;
 // height of a triangle in our equilateral triangular grid if the side length is 1
 static const double triangleHeight = sqrt(3.0 / 4.0);
 
+namespace {
+
+// Waits for a finished recording's frames to be written and logs the number of
+// frames that could not be, so that the render thread does not have to wait.
+class FinishRecordingTask : public QRunnable {
+ public:
+  FinishRecordingTask(VisItem* vis, std::unique_ptr<FrameCapture> capture)
+    : vis(vis),
+      capture(std::move(capture)) {}
+
+  void run() override {
+    const int failures = capture->waitForDone();
+    if (failures > 0) {
+      emit vis->log("Could not save " + QString::number(failures) +
+                    " frames to " + capture->path(), true);
+    }
+    capture = nullptr;
+  }
+
+  VisItem* const vis;
+  std::unique_ptr<FrameCapture> capture;
+};
+
+}  // namespace
+
 VisItem::VisItem(QQuickItem* parent) :
   GLItem(parent),
-  translating(false) {
+  translating(false),
+  recordingChangeRequested(false) {
+  // Recordings are finished in order, one at a time.
+  recordingPool.setMaxThreadCount(1);
   setAcceptedMouseButtons(Qt::LeftButton);
   renderTimer.start(targetFrameDuration);
 }
@@ -75,6 +104,24 @@ void VisItem::saveScreenshot(QString filePath) {
   window()->grabWindow().save(filePath);
 }
 
+bool VisItem::startRecording(const QString filePath, const bool raw) {
+  std::unique_ptr<FrameCapture> capture(new FrameCapture(filePath, raw));
+  if (!capture->isOpen()) {
+    return false;
+  }
+
+  QMutexLocker locker(&recordingMutex);
+  requestedRecording = std::move(capture);
+  recordingChangeRequested = true;
+  return true;
+}
+
+void VisItem::stopRecording() {
+  QMutexLocker locker(&recordingMutex);
+  requestedRecording = nullptr;
+  recordingChangeRequested = true;
+}
+
 void VisItem::initialize() {
   gridTex = std::unique_ptr<QOpenGLTexture>(new QOpenGLTexture(QImage(":/textures/grid.png").mirrored()));
   gridTex->setMinMagFilters(QOpenGLTexture::LinearMipMapLinear, QOpenGLTexture::Linear);
@@ -92,9 +139,23 @@ void VisItem::initialize() {
 }
 
 void VisItem::paint() {
+  updateRecording();
+
+  // A recorded frame is drawn offscreen first; reading it back overlaps with
+  // drawing the same frame to the window.
+  if (recording != nullptr) {
+    drawScene(recording->begin(glfn, width(), height()));
+    recording->end();
+  }
+
+  drawScene(QRect(0, 0, width(), height()));
+}
+
+void VisItem::drawScene(const QRect& viewport) {
   glfn->glUseProgram(0);
 
-  glfn->glViewport(0, 0, width(), height());
+  glfn->glViewport(viewport.x(), viewport.y(), viewport.width(),
+                   viewport.height());
 
   glfn->glDisable(GL_DEPTH_TEST);
   glfn->glDisable(GL_CULL_FACE);
@@ -120,6 +181,8 @@ void VisItem::paint() {
 void VisItem::deinitialize() {
   renderTimer.disconnect();
 
+  finishRecording();
+
   particleTex = nullptr;
   gridTex = nullptr;
 }
@@ -128,6 +191,22 @@ void VisItem::sizeChanged(int width, int height) {
   view.setViewportSize(width, height);
 }
 
+void VisItem::updateRecording() {
+  QMutexLocker locker(&recordingMutex);
+  if (recordingChangeRequested) {
+    finishRecording();
+    recording = std::move(requestedRecording);
+    recordingChangeRequested = false;
+  }
+}
+
+void VisItem::finishRecording() {
+  if (recording != nullptr) {
+    recording->finish();
+    recordingPool.start(new FinishRecordingTask(this, std::move(recording)));
+  }
+}
+
 void VisItem::setupCamera() {
   glfn->glMatrixMode(GL_MODELVIEW);
   glfn->glLoadIdentity();
@@ -8,9 +8,12 @@
 #include <memory>
 
 #include <QMouseEvent>
+#include <QMutex>
 #include <QOpenGLTexture>
 #include <QPointF>
+#include <QRect>
 #include <QString>
+#include <QThreadPool>
 #include <QTimer>
 #include <QWheelEvent>
 
@@ -18,6 +21,7 @@
 #include "core/object.h"
 #include "core/particle.h"
 #include "core/system.h"
+#include "ui/framecapture.h"
 #include "ui/glitem.h"
 #include "ui/view.h"
 
@@ -31,6 +35,10 @@ class VisItem : public GLItem {
   void stepForParticleAt(Node node);
   void inspectParticle(QString text);
 
+  // Reports messages (e.g., frames of a recording that could not be written)
+  // to the GUI. May be emitted by any thread.
+  void log(const QString msg, const bool isError);
+
  public slots:
   void systemChanged(std::shared_ptr<System> _system);
   void focusOnCenterOfMass();
@@ -39,6 +47,18 @@ class VisItem : public GLItem {
   void setZoom(double zoom);
   void saveScreenshot(QString filePath);
 
+  // Functions for recording every rendered frame in the background (see
+  // framecapture.h). startRecording saves the frames to filePath followed by
+  // their number and .png or, if raw is true, streams their RGBA pixels into
+  // the file at filePath (e.g., a named pipe), replacing any recording in
+  // progress; it returns false if the stream cannot be opened. stopRecording
+  // finishes the recording. Both may be called from any thread; the render
+  // thread picks up the change with its next frame. Frames of a finished
+  // recording are written out in the background, and an error is logged if
+  // any of them could not be written.
+  bool startRecording(const QString filePath, const bool raw);
+  void stopRecording();
+
  protected slots:
   virtual void initialize();
   virtual void paint();
@@ -46,6 +66,16 @@ class VisItem : public GLItem {
   virtual void sizeChanged(int width, int height);
 
  protected:
+  // Draws the grid, particles, and objects into the given part of the bound
+  // framebuffer.
+  void drawScene(const QRect& viewport);
+
+  // Starts or stops the recording as requested by startRecording and
+  // stopRecording. finishRecording finishes the recording in progress, if
+  // any, and hands it to recordingPool to be written out.
+  void updateRecording();
+  void finishRecording();
+
   void setupCamera();
 
   void drawGrid();
@@ -77,6 +107,17 @@ class VisItem : public GLItem {
   bool translating;
 
   std::shared_ptr<System> system;
+
+  // The recording in progress, which the render thread owns, and the change
+  // requested of it, which recordingMutex guards.
+  std::unique_ptr<FrameCapture> recording;
+  QMutex recordingMutex;
+  std::unique_ptr<FrameCapture> requestedRecording;
+  bool recordingChangeRequested;
+
+  // Writes out finished recordings. Declared last so that it is destroyed
+  // first, waiting for them while the rest of the item is still intact.
+  QThreadPool recordingPool;
 };
 
 #endif  // AMOEBOTSIM_UI_VISITEM_H_